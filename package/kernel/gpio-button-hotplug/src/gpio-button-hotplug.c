@@ -31,6 +31,11 @@
 #include <linux/gpio/consumer.h>
 
 #define BH_SKB_SIZE	2048
+#define BH_MAX_PENDING	32
+
+/* polled mode: back off after this many polls without button activity */
+#define POLL_IDLE_COUNT		10
+#define POLL_MAX_BACKOFF	8
 
 #define DRV_NAME	"gpio-keys"
 #define PFX	DRV_NAME ": "
@@ -42,7 +47,7 @@ struct bh_event {
 	unsigned long		seen;
 
 	struct sk_buff		*skb;
-	struct work_struct	work;
+	struct list_head	list;
 };
 
 struct bh_map {
@@ -66,6 +71,13 @@ struct gpio_keys_button_data {
 
 extern u64 uevent_next_seqnum(void);
 
+static LIST_HEAD(bh_event_list);
+static DEFINE_SPINLOCK(bh_event_lock);
+static unsigned int bh_event_pending;
+
+static void button_hotplug_work(struct work_struct *work);
+static DECLARE_WORK(bh_event_work, button_hotplug_work);
+
 #define BH_MAP(_code, _name)		\
 	{				\
 		.code = (_code),	\
@@ -172,9 +184,8 @@ static int button_hotplug_fill_event(struct bh_event *event)
 	return ret;
 }
 
-static void button_hotplug_work(struct work_struct *work)
+static void button_hotplug_send_event(struct bh_event *event)
 {
-	struct bh_event *event = container_of(work, struct bh_event, work);
 	int ret = 0;
 
 	event->skb = alloc_skb(BH_SKB_SIZE, GFP_KERNEL);
@@ -201,6 +212,26 @@ static void button_hotplug_work(struct work_struct *work)
 	kfree(event);
 }
 
+/*
+ * Deliver all queued events from a single work run, so a burst of button
+ * activity does not schedule one work item per event.
+ */
+static void button_hotplug_work(struct work_struct *work)
+{
+	struct bh_event *event, *tmp;
+	LIST_HEAD(events);
+
+	spin_lock(&bh_event_lock);
+	list_splice_init(&bh_event_list, &events);
+	bh_event_pending = 0;
+	spin_unlock(&bh_event_lock);
+
+	list_for_each_entry_safe(event, tmp, &events, list) {
+		list_del(&event->list);
+		button_hotplug_send_event(event);
+	}
+}
+
 static int button_hotplug_create_event(const char *name, unsigned int type,
 		unsigned long seen, int pressed)
 {
@@ -218,8 +249,19 @@ static int button_hotplug_create_event(const char *name, unsigned int type,
 	event->seen = seen;
 	event->action = pressed ? "pressed" : "released";
 
-	INIT_WORK(&event->work, (void *)(void *)button_hotplug_work);
-	schedule_work(&event->work);
+	spin_lock(&bh_event_lock);
+	if (bh_event_pending >= BH_MAX_PENDING) {
+		spin_unlock(&bh_event_lock);
+		pr_warn_ratelimited(PFX "too many pending events, dropping %s\n",
+				    name);
+		kfree(event);
+		return -EBUSY;
+	}
+	list_add_tail(&event->list, &bh_event_list);
+	bh_event_pending++;
+	spin_unlock(&bh_event_lock);
+
+	schedule_work(&bh_event_work);
 
 	return 0;
 }
@@ -298,6 +340,8 @@ set_state:
 struct gpio_keys_button_dev {
 	int polled;
 	struct delayed_work work;
+	unsigned int poll_backoff;
+	unsigned int idle_polls;
 
 	struct device *dev;
 	struct gpio_keys_platform_data *pdata;
@@ -307,7 +351,8 @@ struct gpio_keys_button_dev {
 static void gpio_keys_polled_queue_work(struct gpio_keys_button_dev *bdev)
 {
 	struct gpio_keys_platform_data *pdata = bdev->pdata;
-	unsigned long delay = msecs_to_jiffies(pdata->poll_interval);
+	unsigned long delay = msecs_to_jiffies(pdata->poll_interval *
+					       bdev->poll_backoff);
 
 	if (delay >= HZ)
 		delay = round_jiffies_relative(delay);
@@ -318,23 +363,56 @@ static void gpio_keys_polled_poll(struct work_struct *work)
 {
 	struct gpio_keys_button_dev *bdev =
 		container_of(work, struct gpio_keys_button_dev, work.work);
+	bool active = false;
 	int i;
 
 	for (i = 0; i < bdev->pdata->nbuttons; i++) {
 		struct gpio_keys_button_data *bdata = &bdev->data[i];
+		int last_state = bdata->last_state;
+
+		if (!bdata->gpiod || bdata->irq)
+			continue;
 
-		if (bdata->gpiod)
-			gpio_keys_handle_button(bdata);
+		gpio_keys_handle_button(bdata);
+		if (bdata->count || bdata->last_state != last_state)
+			active = true;
 	}
+
+	/*
+	 * Sample at the configured rate while a button is moving, and slow
+	 * down step by step while nothing happens. The debounce threshold
+	 * is counted in polls, so only back off from a stable state.
+	 */
+	if (active) {
+		bdev->idle_polls = 0;
+		bdev->poll_backoff = 1;
+	} else if (++bdev->idle_polls >= POLL_IDLE_COUNT &&
+		   bdev->poll_backoff < POLL_MAX_BACKOFF &&
+		   bdev->pdata->poll_interval * bdev->poll_backoff * 2 <= MSEC_PER_SEC) {
+		bdev->idle_polls = 0;
+		bdev->poll_backoff *= 2;
+	}
+
 	gpio_keys_polled_queue_work(bdev);
 }
 
 static void gpio_keys_polled_close(struct gpio_keys_button_dev *bdev)
 {
 	struct gpio_keys_platform_data *pdata = bdev->pdata;
+	int i;
 
 	cancel_delayed_work_sync(&bdev->work);
 
+	for (i = 0; i < pdata->nbuttons; i++) {
+		struct gpio_keys_button_data *bdata = &bdev->data[i];
+
+		if (!bdata->irq)
+			continue;
+
+		disable_irq(bdata->irq);
+		cancel_delayed_work_sync(&bdata->work);
+	}
+
 	if (pdata->disable)
 		pdata->disable(bdev->dev);
 }
@@ -632,23 +710,69 @@ static int gpio_keys_probe(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Switch a polled button over to edge interrupts if its GPIO controller
+ * provides them, so it no longer needs to be sampled periodically.
+ */
+static bool gpio_keys_polled_try_irq(struct platform_device *pdev,
+				     struct gpio_keys_button_data *bdata)
+{
+	const struct gpio_keys_button *button = bdata->b;
+	int threshold = bdata->threshold;
+	int irq, ret;
+
+	irq = gpiod_to_irq(bdata->gpiod);
+	if (irq <= 0)
+		return false;
+
+	INIT_DELAYED_WORK(&bdata->work, gpio_keys_irq_work_func);
+	bdata->threshold = 0;
+	bdata->software_debounce = button->debounce_interval;
+
+	ret = devm_request_threaded_irq(&pdev->dev, irq, NULL,
+		button_handle_irq,
+		IRQF_ONESHOT | IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+		dev_name(&pdev->dev), bdata);
+	if (ret < 0) {
+		bdata->threshold = threshold;
+		bdata->software_debounce = 0;
+		return false;
+	}
+
+	bdata->irq = irq;
+	schedule_delayed_work(&bdata->work,
+			      msecs_to_jiffies(bdata->software_debounce));
+
+	dev_dbg(&pdev->dev, "button %s uses irq:%d instead of polling\n",
+		button_map[bdata->map_entry].name, irq);
+
+	return true;
+}
+
 static int gpio_keys_polled_probe(struct platform_device *pdev)
 {
 	struct gpio_keys_platform_data *pdata;
 	struct gpio_keys_button_dev *bdev;
-	int ret;
+	int polled = 0;
+	int ret, i;
 
 	ret = gpio_keys_button_probe(pdev, &bdev, 1);
 	if (ret)
 		return ret;
 
 	INIT_DELAYED_WORK(&bdev->work, gpio_keys_polled_poll);
+	bdev->poll_backoff = 1;
 
 	pdata = bdev->pdata;
 	if (pdata->enable)
 		pdata->enable(bdev->dev);
 
-	gpio_keys_polled_queue_work(bdev);
+	for (i = 0; i < pdata->nbuttons; i++)
+		if (!gpio_keys_polled_try_irq(pdev, &bdev->data[i]))
+			polled++;
+
+	if (polled)
+		gpio_keys_polled_queue_work(bdev);
 
 	return ret;
 }
@@ -719,6 +843,7 @@ static void __exit gpio_button_exit(void)
 {
 	platform_driver_unregister(&gpio_keys_driver);
 	platform_driver_unregister(&gpio_keys_polled_driver);
+	flush_work(&bh_event_work);
 }
 
 module_init(gpio_button_init);
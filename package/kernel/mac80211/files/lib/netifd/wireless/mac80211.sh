@@ -495,7 +495,7 @@ mac80211_hostapd_setup_bss() {
 	hostapd_cfg=
 	append hostapd_cfg "$type=$ifname" "$N"
 
-	hostapd_set_bss_options hostapd_cfg "$phy" "$vif" || return 1
+	hostapd_set_bss_options_cached hostapd_cfg "$phy" "$vif" "$radio_md5sum" || return 1
 	json_get_vars wds wds_bridge dtim_period max_listen_int start_disabled
 
 	set_default wds 0
@@ -505,7 +505,10 @@ mac80211_hostapd_setup_bss() {
 		append hostapd_cfg "wds_sta=1" "$N"
 		[ -n "$wds_bridge" ] && append hostapd_cfg "wds_bridge=$wds_bridge" "$N"
 	}
-	[ "$staidx" -gt 0 -o "$start_disabled" -eq 1 ] && append hostapd_cfg "start_disabled=1" "$N"
+	[ "$staidx" -gt 0 -o "$start_disabled" -eq 1 ] && {
+		append hostapd_cfg "start_disabled=1" "$N"
+		start_disabled=1
+	}
 
 	cat >> /var/run/hostapd-$phy.conf <<EOF
 $hostapd_cfg
@@ -513,6 +516,63 @@ bssid=$macaddr
 ${dtim_period:+dtim_period=$dtim_period}
 ${max_listen_int:+max_listen_interval=$max_listen_int}
 EOF
+	NEWAPIDS="${NEWAPIDS}$ifname:$hostapd_bss_id:$macaddr:$start_disabled "
+}
+
+# Work out whether the running hostapd instance can be brought in line with
+# the new config by adding, removing and reloading individual BSSes rather
+# than restarting the whole radio. This needs an unchanged radio section,
+# the same primary BSS and kept BSSes in their old order, with new ones only
+# appended at the end.
+mac80211_hostapd_diff_bss() {
+	local old new found kept_old kept_new
+
+	bss_remove=
+	bss_add=
+	bss_changed=
+
+	[ -n "$OLDAPIDS" ] && [ -n "$OLD_RADIO_MD5" ] || return 1
+	[ "$OLD_RADIO_MD5" = "$radio_md5sum" ] || return 1
+	[ "${OLDAPLIST%% *}" = "${NEWAPLIST%% *}" ] || return 1
+
+	for old in $OLDAPIDS; do
+		found=
+		for new in $NEWAPIDS; do
+			[ "${old%%:*}" = "${new%%:*}" ] || continue
+			found=1
+			[ "$old" = "$new" ] || bss_changed=1
+		done
+		[ -n "$found" ] || append bss_remove "${old%%:*}"
+	done
+
+	for old in $OLDAPLIST; do
+		list_contains bss_remove "$old" || append kept_old "$old"
+	done
+	for new in $NEWAPLIST; do
+		if list_contains OLDAPLIST "$new"; then
+			[ -z "$bss_add" ] || return 1
+			append kept_new "$new"
+		else
+			append bss_add "$new"
+		fi
+	done
+
+	[ "$kept_old" = "$kept_new" ]
+}
+
+mac80211_hostapd_add_bss() {
+	local phy="$1"; shift
+	local ifname bss_file
+
+	for ifname in "$@"; do
+		bss_file="/var/run/hostapd-$ifname.conf"
+		{
+			sed -n '1,/^radio_config_id=/p' "$hostapd_conf_file"
+			echo "interface=$ifname"
+			sed -n "/^bss=$ifname\$/,/^bss=/{/^bss=/!p}" "$hostapd_conf_file"
+		} > "$bss_file"
+		ubus call hostapd config_add "{\"iface\":\"$phy\", \"config\":\"$bss_file\"}" >/dev/null || return 1
+	done
 }
 
 mac80211_get_addr() {
@@ -1133,11 +1193,20 @@ drv_mac80211_setup() {
 	mac80211_prepare_iw_htmode
 	for_each_interface "sta adhoc mesh monitor" mac80211_prepare_vif
 	NEWAPLIST=
+	NEWAPIDS=
 	for_each_interface "ap" mac80211_prepare_vif
 	NEW_MD5=$(test -e "${hostapd_conf_file}" && md5sum ${hostapd_conf_file})
 	OLD_MD5=$(uci -q -P /var/state get wireless._${phy}.md5)
+	OLDAPIDS=$(uci -q -P /var/state get wireless._${phy}.apids)
+	OLD_RADIO_MD5=$(uci -q -P /var/state get wireless._${phy}.radio_md5)
+	local bss_update= bss_remove= bss_add= bss_changed=
 	if [ "${NEWAPLIST}" != "${OLDAPLIST}" ]; then
-		mac80211_vap_cleanup hostapd "${OLDAPLIST}"
+		if [ -n "$NEWAPLIST" ] && mac80211_hostapd_diff_bss; then
+			bss_update=1
+			mac80211_vap_cleanup hostapd "${bss_remove}"
+		else
+			mac80211_vap_cleanup hostapd "${OLDAPLIST}"
+		fi
 	fi
 	[ -n "${NEWAPLIST}" ] && mac80211_iw_interface_add "$phy" "${NEWAPLIST%% *}" __ap
 	local add_ap=0
@@ -1147,7 +1216,13 @@ drv_mac80211_setup() {
 		if [ -n "$(ubus list | grep hostapd.$primary_ap)" ]; then
 			no_reload=0
 			[ "${NEW_MD5}" = "${OLD_MD5}" ] || {
-				ubus call hostapd.$primary_ap reload
+				if [ -n "$bss_update" ]; then
+					mac80211_hostapd_add_bss "$phy" $bss_add && {
+						[ -z "$bss_changed" ] || ubus call hostapd.$primary_ap reload
+					}
+				else
+					ubus call hostapd.$primary_ap reload
+				fi
 				no_reload=$?
 				if [ "$no_reload" != "0" ]; then
 					mac80211_vap_cleanup hostapd "${OLDAPLIST}"
@@ -1173,6 +1248,8 @@ drv_mac80211_setup() {
 	}
 	uci -q -P /var/state set wireless._${phy}.aplist="${NEWAPLIST}"
 	uci -q -P /var/state set wireless._${phy}.md5="${NEW_MD5}"
+	uci -q -P /var/state set wireless._${phy}.apids="${NEWAPIDS}"
+	uci -q -P /var/state set wireless._${phy}.radio_md5="${radio_md5sum}"
 
 	[ "${add_ap}" = 1 ] && sleep 1
 	for_each_interface "ap" mac80211_setup_vif
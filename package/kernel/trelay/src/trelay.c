@@ -19,6 +19,8 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/u64_stats_sync.h>
 
 #define trelay_log(loglevel, tr, fmt, ...) \
 	printk(loglevel "trelay: %s <-> %s: " fmt "\n", \
@@ -27,9 +29,19 @@
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+struct trelay_stats {
+	u64 rx_packets;
+	u64 rx_bytes;
+	u64 tx_packets;
+	u64 tx_bytes;
+	u64 tx_dropped;
+	struct u64_stats_sync syncp;
+};
+
 struct trelay {
 	struct list_head list;
 	struct net_device *dev1, *dev2;
+	struct trelay_stats __percpu *stats;
 	struct dentry *debugfs;
 	int to_remove;
 	char name[];
@@ -37,24 +49,82 @@ struct trelay {
 
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
+	struct trelay_stats *stats;
 	struct net_device *dev;
 	struct sk_buff *skb = *pskb;
+	struct trelay *tr;
+	unsigned int len;
+	int ret;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	tr = rcu_dereference(skb->dev->rx_handler_data);
+	if (!tr)
 		return RX_HANDLER_PASS;
 
 	if (skb->protocol == htons(ETH_P_PAE))
 		return RX_HANDLER_PASS;
 
+	dev = skb->dev == tr->dev1 ? tr->dev2 : tr->dev1;
+
 	skb_push(skb, ETH_HLEN);
 	skb->dev = dev;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+
+	len = skb->len;
+	ret = dev_queue_xmit(skb);
+
+	stats = this_cpu_ptr(tr->stats);
+	u64_stats_update_begin(&stats->syncp);
+	stats->rx_packets++;
+	stats->rx_bytes += len;
+	if (ret == NET_XMIT_SUCCESS || ret == NET_XMIT_CN) {
+		stats->tx_packets++;
+		stats->tx_bytes += len;
+	} else {
+		stats->tx_dropped++;
+	}
+	u64_stats_update_end(&stats->syncp);
 
 	return RX_HANDLER_CONSUMED;
 }
 
+static int trelay_stats_show(struct seq_file *s, void *unused)
+{
+	struct trelay *tr = s->private;
+	u64 rx_packets = 0, rx_bytes = 0, tx_packets = 0, tx_bytes = 0;
+	u64 tx_dropped = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct trelay_stats *stats = per_cpu_ptr(tr->stats, cpu);
+		u64 rxp, rxb, txp, txb, txd;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&stats->syncp);
+			rxp = stats->rx_packets;
+			rxb = stats->rx_bytes;
+			txp = stats->tx_packets;
+			txb = stats->tx_bytes;
+			txd = stats->tx_dropped;
+		} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+		rx_packets += rxp;
+		rx_bytes += rxb;
+		tx_packets += txp;
+		tx_bytes += txb;
+		tx_dropped += txd;
+	}
+
+	seq_printf(s, "rx_packets: %llu\n", rx_packets);
+	seq_printf(s, "rx_bytes: %llu\n", rx_bytes);
+	seq_printf(s, "tx_packets: %llu\n", tx_packets);
+	seq_printf(s, "tx_bytes: %llu\n", tx_bytes);
+	seq_printf(s, "tx_dropped: %llu\n", tx_dropped);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(trelay_stats);
+
 static int trelay_open(struct inode *inode, struct file *file)
 {
 	file->private_data = inode->i_private;
@@ -77,6 +147,7 @@ static int trelay_do_remove(struct trelay *tr)
 
 	trelay_log(KERN_INFO, tr, "stopped");
 
+	free_percpu(tr->stats);
 	kfree(tr);
 
 	return 0;
@@ -156,6 +227,12 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!tr)
 		return -ENOMEM;
 
+	tr->stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->stats) {
+		kfree(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -171,11 +248,16 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!dev1 || !dev2)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
+	/* The rx handler looks up the peer device through tr */
+	strcpy(tr->name, name);
+	tr->dev1 = dev1;
+	tr->dev2 = dev2;
+
+	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, tr);
 	if (ret < 0)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
+	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, tr);
 	if (ret < 0) {
 		netdev_rx_handler_unregister(dev1);
 		goto out;
@@ -184,22 +266,22 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	dev_hold(dev1);
 	dev_hold(dev2);
 
-	strcpy(tr->name, name);
-	tr->dev1 = dev1;
-	tr->dev2 = dev2;
 	list_add_tail(&tr->list, &trelay_devs);
 
 	trelay_log(KERN_INFO, tr, "started");
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &trelay_stats_fops);
 	ret = 0;
 
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
-	if (ret < 0)
+	if (ret < 0) {
+		free_percpu(tr->stats);
 		kfree(tr);
+	}
 
 	return ret;
 }
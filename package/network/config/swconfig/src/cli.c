@@ -42,6 +42,8 @@ enum {
 	CMD_HELP,
 	CMD_SHOW,
 	CMD_PORTMAP,
+	CMD_MIB,
+	CMD_ARL,
 };
 
 static void
@@ -158,15 +160,6 @@ show_attrs(struct switch_dev *dev, struct switch_attr *attr, struct switch_val *
 	}
 }
 
-static void
-show_global(struct switch_dev *dev)
-{
-	struct switch_val val;
-
-	printf("Global attributes:\n");
-	show_attrs(dev, dev->ops, &val);
-}
-
 static void
 show_port(struct switch_dev *dev, int port)
 {
@@ -178,31 +171,180 @@ show_port(struct switch_dev *dev, int port)
 }
 
 static void
-show_vlan(struct switch_dev *dev, int vlan, bool all)
+show_vlan(struct switch_dev *dev, int vlan)
 {
 	struct switch_val val;
-	struct switch_attr *attr;
 
 	val.port_vlan = vlan;
 
-	if (all) {
-		attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_VLAN, "ports");
-		if (swlib_get_attr(dev, attr, &val) < 0)
-			return;
+	printf("VLAN %d:\n", vlan);
+	show_attrs(dev, dev->vlan_ops, &val);
+}
 
-		if (!val.len)
-			return;
+static int
+count_attrs(const struct switch_attr *attr)
+{
+	int n = 0;
+
+	for (; attr; attr = attr->next)
+		if (attr->type != SWITCH_TYPE_NOVAL)
+			n++;
+
+	return n;
+}
+
+static struct switch_val *
+queue_attrs(struct switch_val *val, struct switch_attr *attr, int port_vlan)
+{
+	for (; attr; attr = attr->next) {
+		if (attr->type == SWITCH_TYPE_NOVAL)
+			continue;
+		val->attr = attr;
+		val->port_vlan = port_vlan;
+		val++;
 	}
 
-	printf("VLAN %d:\n", vlan);
-	show_attrs(dev, dev->vlan_ops, &val);
+	return val;
+}
+
+static void
+print_vals(struct switch_val *val, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++, val++) {
+		printf("\t%s: ", val->attr->name);
+		if (val->err < 0)
+			printf("???");
+		else
+			print_attr_val(val->attr, val);
+		putchar('\n');
+		swlib_free_attr_val(val);
+	}
+}
+
+/* fetch the whole switch state with batched requests */
+static void
+show_all(struct switch_dev *dev)
+{
+	struct switch_attr *vlan_ports;
+	struct switch_val *vals, *val;
+	int n_global = count_attrs(dev->ops);
+	int n_port = count_attrs(dev->port_ops);
+	int n_vlan = count_attrs(dev->vlan_ops);
+	int n_active = 0;
+	int *active;
+	int i;
+
+	vals = calloc(n_global + dev->ports * n_port +
+		      dev->vlans * (n_vlan + 1) + 1, sizeof(*vals));
+	active = calloc(dev->vlans + 1, sizeof(*active));
+	if (!vals || !active)
+		goto out;
+
+	val = queue_attrs(vals, dev->ops, 0);
+	for (i = 0; i < dev->ports; i++)
+		val = queue_attrs(val, dev->port_ops, i);
+	swlib_get_attrs(dev, vals, val - vals);
+
+	printf("Global attributes:\n");
+	print_vals(vals, n_global);
+	for (i = 0, val = vals + n_global; i < dev->ports; i++, val += n_port) {
+		printf("Port %d:\n", i);
+		print_vals(val, n_port);
+	}
+
+	/* only show VLANs that have ports assigned */
+	vlan_ports = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_VLAN, "ports");
+	if (!vlan_ports)
+		goto out;
+
+	memset(vals, 0, dev->vlans * sizeof(*vals));
+	for (i = 0; i < dev->vlans; i++) {
+		vals[i].attr = vlan_ports;
+		vals[i].port_vlan = i;
+	}
+	swlib_get_attrs(dev, vals, dev->vlans);
+	for (i = 0; i < dev->vlans; i++) {
+		if (vals[i].err >= 0 && vals[i].len)
+			active[n_active++] = i;
+		swlib_free_attr_val(&vals[i]);
+	}
+
+	memset(vals, 0, n_active * n_vlan * sizeof(*vals));
+	for (i = 0, val = vals; i < n_active; i++)
+		val = queue_attrs(val, dev->vlan_ops, active[i]);
+	swlib_get_attrs(dev, vals, val - vals);
+
+	for (i = 0, val = vals; i < n_active; i++, val += n_vlan) {
+		printf("VLAN %d:\n", active[i]);
+		print_vals(val, n_vlan);
+	}
+
+out:
+	free(active);
+	free(vals);
+}
+
+static void
+show_mib(struct switch_dev *dev, int port)
+{
+	struct switch_mib mib;
+	uint64_t *row;
+	int i, j;
+
+	memset(&mib, 0, sizeof(mib));
+	if (swlib_get_port_mibs(dev, &mib) < 0) {
+		fprintf(stderr, "Failed to read the port counters\n");
+		return;
+	}
+
+	for (i = 0; i < mib.ports; i++) {
+		if (port >= 0 && port != i)
+			continue;
+
+		printf("Port %d:\n", i);
+		row = &mib.values[i * mib.n_counters];
+		for (j = 0; j < mib.n_counters; j++)
+			printf("\t%-12s: %" PRIu64 "\n", mib.names[j], row[j]);
+	}
+
+	swlib_free_port_mibs(&mib);
+}
+
+static void
+show_arl(struct switch_dev *dev, int port)
+{
+	struct switch_arl arl;
+	struct switch_arl_entry *e;
+	int i;
+
+	memset(&arl, 0, sizeof(arl));
+	if (swlib_get_arl(dev, &arl, 0) < 0) {
+		fprintf(stderr, "Failed to read the address table\n");
+		return;
+	}
+
+	for (i = 0; i < arl.n_entries; i++) {
+		e = &arl.entries[i];
+		if (port >= 0 && !(e->portmap & (1 << port)))
+			continue;
+
+		printf("MAC %02x:%02x:%02x:%02x:%02x:%02x vid %u ports 0x%02x age %u%s\n",
+			e->mac[0], e->mac[1], e->mac[2],
+			e->mac[3], e->mac[4], e->mac[5],
+			e->vid, e->portmap, e->age,
+			(e->flags & SWITCH_ARL_F_STATIC) ? " static" : "");
+	}
+
+	swlib_free_arl(&arl);
 }
 
 static void
 print_usage(void)
 {
 	printf("swconfig list\n");
-	printf("swconfig dev <dev> [port <port>|vlan <vlan>] (help|set <key> <value>|get <key>|load <config>|show)\n");
+	printf("swconfig dev <dev> [port <port>|vlan <vlan>] (help|set <key> <value>|get <key>|load <config>|show|mib|arl)\n");
 	exit(1);
 }
 
@@ -291,6 +433,10 @@ int main(int argc, char **argv)
 			cmd = CMD_PORTMAP;
 		} else if (!strcmp(arg, "show")) {
 			cmd = CMD_SHOW;
+		} else if (!strcmp(arg, "mib")) {
+			cmd = CMD_MIB;
+		} else if (!strcmp(arg, "arl")) {
+			cmd = CMD_ARL;
 		} else {
 			print_usage();
 		}
@@ -365,18 +511,20 @@ int main(int argc, char **argv)
 	case CMD_PORTMAP:
 		swlib_print_portmap(dev, csegment);
 		break;
+	case CMD_MIB:
+		show_mib(dev, cport);
+		break;
+	case CMD_ARL:
+		show_arl(dev, cport);
+		break;
 	case CMD_SHOW:
 		if (cport >= 0 || cvlan >= 0) {
 			if (cport >= 0)
 				show_port(dev, cport);
 			else
-				show_vlan(dev, cvlan, false);
+				show_vlan(dev, cvlan);
 		} else {
-			show_global(dev);
-			for (i=0; i < dev->ports; i++)
-				show_port(dev, i);
-			for (i=0; i < dev->vlans; i++)
-				show_vlan(dev, i, true);
+			show_all(dev);
 		}
 		break;
 	}
@@ -21,6 +21,7 @@
 #include <errno.h>
 #include <stdint.h>
 #include <getopt.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <linux/switch.h>
@@ -41,6 +42,7 @@ static struct nl_cache *cache;
 static struct genl_family *family;
 static struct nlattr *tb[SWITCH_ATTR_MAX + 1];
 static int refcount = 0;
+static int multi_unsupported = 0;
 
 static struct nla_policy port_policy[SWITCH_ATTR_MAX] = {
 	[SWITCH_PORT_ID] = { .type = NLA_U32 },
@@ -86,13 +88,12 @@ wait_handler(struct nl_msg *msg, void *arg)
 
 /* helper function for performing netlink requests */
 static int
-swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
+swlib_call_flags(int cmd, int flags, int (*call)(struct nl_msg *, void *),
 		int (*data)(struct nl_msg *, void *), void *arg)
 {
 	struct nl_msg *msg;
 	struct nl_cb *cb = NULL;
 	int finished;
-	int flags = 0;
 	int err = 0;
 
 	msg = nlmsg_alloc();
@@ -101,9 +102,6 @@ swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
 		exit(1);
 	}
 
-	if (!data)
-		flags |= NLM_F_DUMP;
-
 	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, genl_family_get_id(family), 0, flags, cmd, 0);
 	if (data) {
 		err = data(msg, arg);
@@ -128,10 +126,10 @@ swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
 	if (call)
 		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, call, arg);
 
-	if (data)
-		nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, wait_handler, &finished);
-	else
+	if (flags & NLM_F_DUMP)
 		nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, wait_handler, &finished);
+	else
+		nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, wait_handler, &finished);
 
 	err = nl_recvmsgs(handle, cb);
 	if (err < 0) {
@@ -149,6 +147,13 @@ nla_put_failure:
 	return err;
 }
 
+static int
+swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
+		int (*data)(struct nl_msg *, void *), void *arg)
+{
+	return swlib_call_flags(cmd, data ? 0 : NLM_F_DUMP, call, data, arg);
+}
+
 static int
 send_attr(struct nl_msg *msg, void *arg)
 {
@@ -243,6 +248,19 @@ out:
 	return err;
 }
 
+static void
+store_attr_val(struct nl_msg *msg, struct switch_val *val)
+{
+	if (tb[SWITCH_ATTR_OP_VALUE_INT])
+		val->value.i = nla_get_u32(tb[SWITCH_ATTR_OP_VALUE_INT]);
+	else if (tb[SWITCH_ATTR_OP_VALUE_STR])
+		val->value.s = strdup(nla_get_string(tb[SWITCH_ATTR_OP_VALUE_STR]));
+	else if (tb[SWITCH_ATTR_OP_VALUE_PORTS])
+		val->err = store_port_val(msg, tb[SWITCH_ATTR_OP_VALUE_PORTS], val);
+	else if (tb[SWITCH_ATTR_OP_VALUE_LINK])
+		val->err = store_link_val(msg, tb[SWITCH_ATTR_OP_VALUE_LINK], val);
+}
+
 static int
 store_val(struct nl_msg *msg, void *arg)
 {
@@ -257,14 +275,7 @@ store_val(struct nl_msg *msg, void *arg)
 		goto error;
 	}
 
-	if (tb[SWITCH_ATTR_OP_VALUE_INT])
-		val->value.i = nla_get_u32(tb[SWITCH_ATTR_OP_VALUE_INT]);
-	else if (tb[SWITCH_ATTR_OP_VALUE_STR])
-		val->value.s = strdup(nla_get_string(tb[SWITCH_ATTR_OP_VALUE_STR]));
-	else if (tb[SWITCH_ATTR_OP_VALUE_PORTS])
-		val->err = store_port_val(msg, tb[SWITCH_ATTR_OP_VALUE_PORTS], val);
-	else if (tb[SWITCH_ATTR_OP_VALUE_LINK])
-		val->err = store_link_val(msg, tb[SWITCH_ATTR_OP_VALUE_LINK], val);
+	store_attr_val(msg, val);
 
 	val->err = 0;
 	return 0;
@@ -429,27 +440,30 @@ enum {
 	CMD_SPEED,
 };
 
-int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+int swlib_parse_attr_string(struct switch_dev *dev, struct switch_attr *a,
+		int port_vlan, const char *str, struct switch_val *val)
 {
 	struct switch_port *ports;
 	struct switch_port_link *link;
-	struct switch_val val;
 	char *ptr;
 	int cmd = CMD_NONE;
 
-	memset(&val, 0, sizeof(val));
-	val.port_vlan = port_vlan;
+	memset(val, 0, sizeof(*val));
+	val->attr = a;
+	val->port_vlan = port_vlan;
 	switch(a->type) {
 	case SWITCH_TYPE_INT:
-		val.value.i = atoi(str);
+		val->value.i = atoi(str);
 		break;
 	case SWITCH_TYPE_STRING:
-		val.value.s = (char *)str;
+		val->value.s = strdup(str);
 		break;
 	case SWITCH_TYPE_PORTS:
-		ports = alloca(sizeof(struct switch_port) * dev->ports);
-		memset(ports, 0, sizeof(struct switch_port) * dev->ports);
-		val.len = 0;
+		ports = swlib_alloc(sizeof(struct switch_port) * dev->ports);
+		if (!ports)
+			return -1;
+		val->value.ports = ports;
+		val->len = 0;
 		ptr = (char *)str;
 		while(ptr && *ptr)
 		{
@@ -460,30 +474,30 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 				break;
 
 			if (!isdigit(*ptr))
-				return -1;
+				goto error;
 
-			if (val.len >= dev->ports)
-				return -1;
+			if (val->len >= dev->ports)
+				goto error;
 
-			ports[val.len].flags = 0;
-			ports[val.len].id = strtoul(ptr, &ptr, 10);
+			ports[val->len].flags = 0;
+			ports[val->len].id = strtoul(ptr, &ptr, 10);
 			while(*ptr && !isspace(*ptr)) {
 				if (*ptr == 't')
-					ports[val.len].flags |= SWLIB_PORT_FLAG_TAGGED;
+					ports[val->len].flags |= SWLIB_PORT_FLAG_TAGGED;
 				else
-					return -1;
+					goto error;
 
 				ptr++;
 			}
 			if (*ptr)
 				ptr++;
-			val.len++;
+			val->len++;
 		}
-		val.value.ports = ports;
 		break;
 	case SWITCH_TYPE_LINK:
-		link = malloc(sizeof(struct switch_port_link));
-		memset(link, 0, sizeof(struct switch_port_link));
+		link = swlib_alloc(sizeof(struct switch_port_link));
+		if (!link)
+			return -1;
 		ptr = (char *)str;
 		for (ptr = strtok(ptr," "); ptr; ptr = strtok(NULL, " ")) {
 			switch (cmd) {
@@ -521,19 +535,517 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 				break;
 			}
 		}
-		val.value.link = link;
+		val->value.link = link;
 		break;
 	case SWITCH_TYPE_NOVAL:
 		if (str && !strcmp(str, "0"))
-			return 0;
+			return 1;
 
 		break;
 	default:
 		return -1;
 	}
-	return swlib_set_attr(dev, a, &val);
+	return 0;
+
+error:
+	swlib_free_attr_val(val);
+	return -1;
+}
+
+int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+{
+	struct switch_val val;
+	int ret;
+
+	ret = swlib_parse_attr_string(dev, a, port_vlan, str, &val);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	ret = swlib_set_attr(dev, a, &val);
+	swlib_free_attr_val(&val);
+
+	return ret;
+}
+
+void
+swlib_free_attr_val(struct switch_val *val)
+{
+	if (!val->attr)
+		return;
+
+	switch(val->attr->type) {
+	case SWITCH_TYPE_STRING:
+		free(val->value.s);
+		break;
+	case SWITCH_TYPE_PORTS:
+		free(val->value.ports);
+		break;
+	case SWITCH_TYPE_LINK:
+		free(val->value.link);
+		break;
+	default:
+		break;
+	}
+	memset(&val->value, 0, sizeof(val->value));
+}
+
+/* batched requests, see SWITCH_CMD_GET_MULTI/SWITCH_CMD_SET_MULTI */
+struct multi_arg {
+	struct switch_dev *dev;
+	struct switch_val *vals;
+	int n;
+	int pos;
+	int end;
+	int set;
+	int apply;
+};
+
+/* worst case netlink footprint of one entry in a batched request */
+static int
+multi_entry_size(struct switch_val *val, int set)
+{
+	int size = NLA_HDRLEN + 3 * NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t));
+
+	if (!set)
+		return size;
+
+	switch(val->attr->type) {
+	case SWITCH_TYPE_INT:
+		size += NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t));
+		break;
+	case SWITCH_TYPE_STRING:
+		if (val->value.s)
+			size += NLA_ALIGN(NLA_HDRLEN + strlen(val->value.s) + 1);
+		break;
+	case SWITCH_TYPE_PORTS:
+		size += NLA_HDRLEN + val->len *
+			(2 * NLA_HDRLEN + NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t)));
+		break;
+	case SWITCH_TYPE_LINK:
+		size += 3 * NLA_HDRLEN + NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t));
+		break;
+	default:
+		break;
+	}
+
+	return size;
 }
 
+static int
+send_multi(struct nl_msg *msg, void *arg)
+{
+	struct multi_arg *m = arg;
+	struct nlattr *list, *op;
+	int i;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, m->dev->id);
+	if (m->apply && m->end == m->n)
+		NLA_PUT_FLAG(msg, SWITCH_ATTR_OP_APPLY);
+
+	list = nla_nest_start(msg, SWITCH_ATTR_OP_LIST);
+	if (!list)
+		goto nla_put_failure;
+
+	for (i = m->pos; i < m->end; i++) {
+		struct switch_val *val = &m->vals[i];
+
+		op = nla_nest_start(msg, SWITCH_ATTR_OP);
+		if (!op)
+			goto nla_put_failure;
+
+		if ((m->set ? send_attr_val(msg, val) : send_attr(msg, val)) < 0)
+			goto nla_put_failure;
+
+		nla_nest_end(msg, op);
+	}
+	nla_nest_end(msg, list);
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static int
+store_multi_val(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct multi_arg *m = arg;
+	struct switch_val *val;
+	int idx;
+
+	if (nla_parse(tb, SWITCH_ATTR_MAX - 1, genlmsg_attrdata(gnlh, 0),
+			genlmsg_attrlen(gnlh, 0), NULL) < 0)
+		goto done;
+
+	if (!tb[SWITCH_ATTR_OP_INDEX])
+		goto done;
+
+	idx = m->pos + nla_get_u32(tb[SWITCH_ATTR_OP_INDEX]);
+	if (idx >= m->end)
+		goto done;
+
+	val = &m->vals[idx];
+	if (tb[SWITCH_ATTR_OP_ERROR]) {
+		val->err = -nla_get_u32(tb[SWITCH_ATTR_OP_ERROR]);
+		goto done;
+	}
+
+	val->err = 0;
+	store_attr_val(msg, val);
+
+done:
+	return NL_SKIP;
+}
+
+/* split the batch into requests that fit into a default sized message */
+static int
+swlib_call_multi(int cmd, struct multi_arg *m)
+{
+	int budget = getpagesize() - 256;
+	int size;
+	int err;
+
+	m->pos = 0;
+	do {
+		size = 0;
+		for (m->end = m->pos; m->end < m->n; m->end++) {
+			size += multi_entry_size(&m->vals[m->end], m->set);
+			if (size > budget && m->end > m->pos)
+				break;
+		}
+
+		err = swlib_call(cmd, m->set ? NULL : store_multi_val,
+				send_multi, m);
+		if (err < 0)
+			return err;
+
+		m->pos = m->end;
+	} while (m->pos < m->n);
+
+	return 0;
+}
+
+int
+swlib_get_attrs(struct switch_dev *dev, struct switch_val *vals, int n)
+{
+	struct multi_arg m = {
+		.dev = dev,
+		.vals = vals,
+		.n = n,
+	};
+	int err;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		memset(&vals[i].value, 0, sizeof(vals[i].value));
+		vals[i].len = 0;
+		vals[i].err = -EINVAL;
+	}
+
+	if (!multi_unsupported) {
+		err = swlib_call_multi(SWITCH_CMD_GET_MULTI, &m);
+		if (err == -NLE_OPNOTSUPP)
+			multi_unsupported = 1;
+	}
+
+	/*
+	 * Entries the batch could not deliver (e.g. values too big for a
+	 * single message) are retried on their own, the single get supports
+	 * multipart replies.
+	 */
+	for (i = 0; i < n; i++) {
+		if (!vals[i].err)
+			continue;
+
+		vals[i].err = swlib_get_attr(dev, vals[i].attr, &vals[i]);
+	}
+
+	return 0;
+}
+
+int
+swlib_set_attrs(struct switch_dev *dev, struct switch_val *vals, int n,
+		int apply)
+{
+	struct multi_arg m = {
+		.dev = dev,
+		.vals = vals,
+		.n = n,
+		.set = 1,
+		.apply = apply,
+	};
+	struct switch_attr *attr;
+	struct switch_val val;
+	int ret = 0;
+	int err;
+	int i;
+
+	if (!multi_unsupported) {
+		err = swlib_call_multi(SWITCH_CMD_SET_MULTI, &m);
+		if (err != -NLE_OPNOTSUPP)
+			return err;
+
+		multi_unsupported = 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		err = swlib_set_attr(dev, vals[i].attr, &vals[i]);
+		if (err < 0 && !ret)
+			ret = err;
+	}
+
+	if (!apply)
+		return ret;
+
+	attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_GLOBAL, "apply");
+	if (!attr)
+		return ret;
+
+	memset(&val, 0, sizeof(val));
+	err = swlib_set_attr(dev, attr, &val);
+	if (err < 0 && !ret)
+		ret = err;
+
+	return ret;
+}
+
+
+struct mib_arg {
+	struct switch_dev *dev;
+	struct switch_mib *mib;
+	int delta;
+	int seen;
+	uint32_t generation;
+};
+
+static int
+send_mib_req(struct nl_msg *msg, void *arg)
+{
+	struct mib_arg *a = arg;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, a->dev->id);
+	if (a->delta)
+		NLA_PUT_U32(msg, SWITCH_ATTR_MIB_SINCE, a->mib->generation);
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static int
+store_mib_names(struct switch_mib *mib, int ports, struct nlattr *nla)
+{
+	struct nlattr *p;
+	int remaining;
+	int n = 0;
+
+	swlib_free_port_mibs(mib);
+
+	nla_for_each_nested(p, nla, remaining)
+		n++;
+
+	mib->names = swlib_alloc(n * sizeof(*mib->names) + 1);
+	mib->values = swlib_alloc(ports * n * sizeof(*mib->values) + 1);
+	if (!mib->names || !mib->values)
+		return -1;
+
+	nla_for_each_nested(p, nla, remaining)
+		mib->names[mib->n_counters++] = strdup(nla_get_string(p));
+	mib->ports = ports;
+
+	return 0;
+}
+
+static int
+store_port_mib(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct mib_arg *a = arg;
+	struct switch_mib *mib = a->mib;
+	uint32_t *idx;
+	uint64_t *row;
+	int port, n, i;
+
+	if (nla_parse(tb, SWITCH_ATTR_MAX - 1, genlmsg_attrdata(gnlh, 0),
+			genlmsg_attrlen(gnlh, 0), NULL) < 0)
+		goto done;
+
+	if (tb[SWITCH_ATTR_MIB_NAMES]) {
+		store_mib_names(mib, a->dev->ports, tb[SWITCH_ATTR_MIB_NAMES]);
+		goto done;
+	}
+
+	if (!tb[SWITCH_ATTR_OP_PORT] || !tb[SWITCH_ATTR_MIB_VALUES] ||
+	    !mib->values)
+		goto done;
+
+	port = nla_get_u32(tb[SWITCH_ATTR_OP_PORT]);
+	if (port >= mib->ports)
+		goto done;
+
+	/* resume from the oldest snapshot seen in this dump */
+	if (tb[SWITCH_ATTR_MIB_GENERATION]) {
+		uint32_t gen = nla_get_u32(tb[SWITCH_ATTR_MIB_GENERATION]);
+
+		if (!a->seen || (int32_t)(gen - a->generation) < 0)
+			a->generation = gen;
+		a->seen = 1;
+	}
+
+	row = &mib->values[port * mib->n_counters];
+	n = nla_len(tb[SWITCH_ATTR_MIB_VALUES]) / sizeof(uint64_t);
+	if (!tb[SWITCH_ATTR_MIB_INDEX]) {
+		if (n > mib->n_counters)
+			n = mib->n_counters;
+		memcpy(row, nla_data(tb[SWITCH_ATTR_MIB_VALUES]),
+		       n * sizeof(uint64_t));
+		goto done;
+	}
+
+	idx = nla_data(tb[SWITCH_ATTR_MIB_INDEX]);
+	if (nla_len(tb[SWITCH_ATTR_MIB_INDEX]) / sizeof(uint32_t) < n)
+		goto done;
+
+	for (i = 0; i < n; i++) {
+		if (idx[i] >= mib->n_counters)
+			continue;
+		memcpy(&row[idx[i]],
+		       (char *) nla_data(tb[SWITCH_ATTR_MIB_VALUES]) +
+		       i * sizeof(uint64_t), sizeof(uint64_t));
+	}
+
+done:
+	return NL_SKIP;
+}
+
+int
+swlib_get_port_mibs(struct switch_dev *dev, struct switch_mib *mib)
+{
+	struct mib_arg arg = {
+		.dev = dev,
+		.mib = mib,
+		.delta = !!mib->values,
+	};
+	int err;
+
+	err = swlib_call_flags(SWITCH_CMD_GET_PORT_MIB, NLM_F_DUMP,
+			store_port_mib, send_mib_req, &arg);
+	if (err < 0)
+		return err;
+
+	if (!mib->values)
+		return -EINVAL;
+
+	if (arg.seen)
+		mib->generation = arg.generation;
+
+	return 0;
+}
+
+void
+swlib_free_port_mibs(struct switch_mib *mib)
+{
+	int i;
+
+	for (i = 0; i < mib->n_counters; i++)
+		free(mib->names[i]);
+	free(mib->names);
+	free(mib->values);
+	memset(mib, 0, sizeof(*mib));
+}
+
+struct arl_arg {
+	struct switch_dev *dev;
+	struct switch_arl *arl;
+	int limit;
+	int size;
+};
+
+static int
+send_arl_req(struct nl_msg *msg, void *arg)
+{
+	struct arl_arg *a = arg;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, a->dev->id);
+	NLA_PUT(msg, SWITCH_ATTR_ARL_CURSOR, sizeof(a->arl->cursor),
+		&a->arl->cursor);
+	if (a->limit > 0)
+		NLA_PUT_U32(msg, SWITCH_ATTR_ARL_LIMIT, a->limit);
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static int
+store_arl(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct arl_arg *a = arg;
+	struct switch_arl *arl = a->arl;
+	struct switch_arl_entry *e;
+	int n;
+
+	if (nla_parse(tb, SWITCH_ATTR_MAX - 1, genlmsg_attrdata(gnlh, 0),
+			genlmsg_attrlen(gnlh, 0), NULL) < 0)
+		goto done;
+
+	if (tb[SWITCH_ATTR_ARL_ENTRIES]) {
+		n = nla_len(tb[SWITCH_ATTR_ARL_ENTRIES]) / sizeof(*e);
+		if (arl->n_entries + n > a->size) {
+			a->size = (arl->n_entries + n) * 2;
+			e = realloc(arl->entries, a->size * sizeof(*e));
+			if (!e)
+				goto done;
+			arl->entries = e;
+		}
+		memcpy(&arl->entries[arl->n_entries],
+		       nla_data(tb[SWITCH_ATTR_ARL_ENTRIES]), n * sizeof(*e));
+		arl->n_entries += n;
+	}
+
+	if (tb[SWITCH_ATTR_ARL_CURSOR] &&
+	    nla_len(tb[SWITCH_ATTR_ARL_CURSOR]) == sizeof(arl->cursor))
+		memcpy(&arl->cursor, nla_data(tb[SWITCH_ATTR_ARL_CURSOR]),
+		       sizeof(arl->cursor));
+
+	if (tb[SWITCH_ATTR_ARL_END])
+		arl->complete = 1;
+
+done:
+	return NL_SKIP;
+}
+
+int
+swlib_get_arl(struct switch_dev *dev, struct switch_arl *arl, int limit)
+{
+	struct arl_arg arg = {
+		.dev = dev,
+		.arl = arl,
+		.limit = limit,
+	};
+
+	free(arl->entries);
+	arl->entries = NULL;
+	arl->n_entries = 0;
+	if (arl->complete) {
+		memset(&arl->cursor, 0, sizeof(arl->cursor));
+		arl->complete = 0;
+	}
+
+	return swlib_call_flags(SWITCH_CMD_GET_ARL, NLM_F_DUMP,
+			store_arl, send_arl_req, &arg);
+}
+
+void
+swlib_free_arl(struct switch_arl *arl)
+{
+	free(arl->entries);
+	memset(arl, 0, sizeof(*arl));
+}
 
 struct attrlist_arg {
 	int id;
@@ -51,6 +51,8 @@ Usage of the library functions:
 
   switch_set_attr() and switch_get_attr() can alter or request the values
   of attributes.
+  swlib_set_attrs() and swlib_get_attrs() do the same for a whole batch
+  of values with a single netlink request.
 
 Usage of the switch_attr struct:
 
@@ -167,6 +169,24 @@ struct switch_portmap {
 	char *segment;
 };
 
+struct switch_mib {
+	uint32_t generation;
+	int n_counters;
+	char **names;
+	int ports;
+	/* ports * n_counters values, grouped by port */
+	uint64_t *values;
+};
+
+struct switch_arl {
+	struct switch_arl_entry *entries;
+	int n_entries;
+	/* where the next swlib_get_arl call resumes */
+	struct switch_arl_entry cursor;
+	/* set once the end of the table was reached */
+	int complete;
+};
+
 struct switch_port_link {
 	int link:1;
 	int duplex:1;
@@ -259,6 +279,82 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *attr,
 int swlib_get_attr(struct switch_dev *dev, struct switch_attr *attr,
 		struct switch_val *val);
 
+/**
+ * swlib_parse_attr_string: convert a string into an attribute value
+ * @dev: switch device struct
+ * @attr: switch attribute struct
+ * @port_vlan: port or vlan (if applicable)
+ * @str: string value
+ * @val: attribute value pointer, to be released with swlib_free_attr_val()
+ * returns 0 on success, 1 if there is nothing to set
+ */
+int swlib_parse_attr_string(struct switch_dev *dev, struct switch_attr *attr,
+		int port_vlan, const char *str, struct switch_val *val);
+
+/**
+ * swlib_free_attr_val: free the data referenced by an attribute value
+ * @val: attribute value filled by swlib_parse_attr_string() or swlib_get_attrs()
+ */
+void swlib_free_attr_val(struct switch_val *val);
+
+/**
+ * swlib_set_attrs: set several attributes with a single request
+ * @dev: switch device struct
+ * @vals: attribute values, ->attr and ->port_vlan set up for each entry
+ * @n: number of entries
+ * @apply: activate the changes in the hardware afterwards
+ * returns 0 on success
+ *
+ * the kernel validates all entries before changing anything and applies the
+ * config once; older kernels are handled with one request per attribute
+ */
+int swlib_set_attrs(struct switch_dev *dev, struct switch_val *vals, int n,
+		int apply);
+
+/**
+ * swlib_get_attrs: get several attributes with a single request
+ * @dev: switch device struct
+ * @vals: attribute values, ->attr and ->port_vlan set up for each entry
+ * @n: number of entries
+ * returns 0 on success, ->err holds the result of each entry
+ */
+int swlib_get_attrs(struct switch_dev *dev, struct switch_val *vals, int n);
+
+/**
+ * swlib_get_port_mibs: read the counters of all ports with a single dump
+ * @dev: switch device struct
+ * @mib: counter table, zero initialized before the first call
+ * returns 0 on success
+ *
+ * once the table is filled, further calls only transfer the counters that
+ * changed since mib->generation and update the table in place
+ */
+int swlib_get_port_mibs(struct switch_dev *dev, struct switch_mib *mib);
+
+/**
+ * swlib_free_port_mibs: free the counter table filled by swlib_get_port_mibs
+ * @mib: counter table
+ */
+void swlib_free_port_mibs(struct switch_mib *mib);
+
+/**
+ * swlib_get_arl: read the next part of the address table
+ * @dev: switch device struct
+ * @arl: table state, zero initialized to start from the beginning
+ * @limit: maximum number of entries to read, 0 for the rest of the table
+ * returns 0 on success
+ *
+ * arl->entries is replaced with the entries read by this call. Once
+ * arl->complete is set, the next call starts over from the beginning.
+ */
+int swlib_get_arl(struct switch_dev *dev, struct switch_arl *arl, int limit);
+
+/**
+ * swlib_free_arl: free the entries read by swlib_get_arl
+ * @arl: table state
+ */
+void swlib_free_arl(struct switch_arl *arl);
+
 /**
  * swlib_apply_from_uci: set up the switch from a uci configuration
  * @dev: switch device struct
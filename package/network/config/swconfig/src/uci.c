@@ -113,6 +113,9 @@ int swlib_apply_from_uci(struct switch_dev *dev, struct uci_package *p)
 	struct uci_option *o;
 	struct uci_ptr ptr;
 	struct switch_val val;
+	struct switch_val *vals;
+	struct swlib_setting *st;
+	int n_vals;
 	int i;
 
 	settings = NULL;
@@ -224,30 +227,53 @@ found:
 		swlib_map_settings(dev, SWLIB_ATTR_GROUP_PORT, port_n, s);
 	}
 
+	n_vals = ARRAY_SIZE(early_settings);
+	for (st = settings; st; st = st->next)
+		n_vals++;
+
+	vals = calloc(n_vals, sizeof(*vals));
+	if (!vals)
+		return -1;
+
+	n_vals = 0;
 	for (i = 0; i < ARRAY_SIZE(early_settings); i++) {
-		struct swlib_setting *st = &early_settings[i];
+		st = &early_settings[i];
 		if (!st->attr || !st->val)
 			continue;
-		swlib_set_attr_string(dev, st->attr, st->port_vlan, st->val);
-
+		if (!swlib_parse_attr_string(dev, st->attr, st->port_vlan,
+				st->val, &vals[n_vals]))
+			n_vals++;
 	}
 
 	while (settings) {
-		struct swlib_setting *st = settings;
+		st = settings;
 
-		swlib_set_attr_string(dev, st->attr, st->port_vlan, st->val);
+		if (!swlib_parse_attr_string(dev, st->attr, st->port_vlan,
+				st->val, &vals[n_vals]))
+			n_vals++;
 		st = st->next;
 		free(settings);
 		settings = st;
 	}
 
-	/* Apply the config */
+	/* Set everything in one go and apply the config */
 	attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_GLOBAL, "apply");
-	if (!attr)
-		return 0;
+	if (swlib_set_attrs(dev, vals, n_vals, !!attr) < 0) {
+		/* the batch was rejected as a whole, fall back to setting
+		 * the attributes one by one so that a single bad option
+		 * does not keep the others from being applied */
+		for (i = 0; i < n_vals; i++)
+			swlib_set_attr(dev, vals[i].attr, &vals[i]);
+
+		if (attr) {
+			memset(&val, 0, sizeof(val));
+			swlib_set_attr(dev, attr, &val);
+		}
+	}
 
-	memset(&val, 0, sizeof(val));
-	swlib_set_attr(dev, attr, &val);
+	for (i = 0; i < n_vals; i++)
+		swlib_free_attr_val(&vals[i]);
+	free(vals);
 
 	return 0;
 }
@@ -1156,6 +1156,87 @@ hostapd_set_bss_options() {
 	return 0
 }
 
+hostapd_append_config_key() {
+	local var="$1"
+	local _keys _key _type _val
+
+	json_get_keys _keys
+	for _key in $_keys; do
+		json_get_type _type "$_key"
+		case "$_type" in
+			array|object)
+				append "$var" "$_key={" "$N"
+				json_select "$_key"
+				hostapd_append_config_key "$var"
+				json_select ..
+				append "$var" "}" "$N"
+			;;
+			*)
+				json_get_var _val "$_key"
+				append "$var" "$_key=$_val" "$N"
+			;;
+		esac
+	done
+}
+
+# Like hostapd_set_bss_options, but reuses the BSS section rendered for an
+# identical interface config on a previous run. The cache is keyed on the
+# vif config, the caller supplied radio id and the caller state the section
+# is rendered from (ifname, macaddr, network bridge/ifname). Configs pulling
+# in external state (FILS DHCP relay, external MAC list file, IAPP network
+# device lookup) are always rendered.
+# Sets hostapd_bss_id to a value that changes whenever the section does.
+hostapd_set_bss_options_cached() {
+	local var="$1"
+	local phy="$2"
+	local vif="$3"
+	local radio_id="$4"
+	local cache="/var/run/hostapd-$ifname.cache"
+	local key_data key line cached hit fils macfile iapp_interface
+
+	hostapd_bss_id=
+
+	json_get_vars fils macfile iapp_interface
+	if [ "${fils:-0}" -gt 0 ] || [ -n "$macfile" ] || [ -n "$iapp_interface" ]; then
+		rm -f "$cache"
+		local bss_uncached=
+		hostapd_set_bss_options bss_uncached "$phy" "$vif" || return 1
+		hostapd_bss_id="$(echo "$bss_uncached" | md5sum | cut -d" " -f1)"
+		append "$var" "$bss_uncached" "$N"
+		return 0
+	fi
+
+	hostapd_append_config_key key_data
+	key="$(echo "$radio_id $phy $ifname $macaddr $network_bridge $network_ifname $key_data" | md5sum | cut -d" " -f1)"
+	hostapd_bss_id="$key"
+
+	[ -f "$cache" ] && while IFS= read -r line; do
+		if [ -z "$hit" ]; then
+			[ "$line" = "#key=$key" ] || break
+			hit=1
+			continue
+		fi
+		case "$line" in
+			wpa_psk_file=*|vlan_file=*|accept_mac_file=*|deny_mac_file=*)
+				[ -e "${line#*=}" ] || touch "${line#*=}"
+			;;
+		esac
+		append cached "$line" "$N"
+	done < "$cache"
+
+	[ -n "$hit" ] && [ -n "$cached" ] || {
+		cached=
+		hostapd_set_bss_options cached "$phy" "$vif" || {
+			rm -f "$cache"
+			return 1
+		}
+		printf '#key=%s\n%s\n' "$key" "$cached" > "$cache"
+	}
+
+	append "$var" "$cached" "$N"
+	return 0
+}
+
 hostapd_set_log_options() {
 	local var="$1"
 
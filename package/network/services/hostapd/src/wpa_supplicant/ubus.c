@@ -14,6 +14,8 @@
 #include "common/ieee802_11_defs.h"
 #include "wpa_supplicant_i.h"
 #include "wps_supplicant.h"
+#include "bss.h"
+#include "scan.h"
 #include "ubus.h"
 
 static struct ubus_context *ctx;
@@ -113,6 +115,193 @@ wpas_bss_reload(struct ubus_context *ctx, struct ubus_object *obj,
 		return 0;
 }
 
+/*
+ * BSS table entries are sent as positional arrays rather than tables to keep
+ * scan result messages small; bss_list reports the field names once.
+ */
+static const char * const bss_fields[] = {
+	"id", "bssid", "ssid", "freq", "signal", "est_throughput", "caps"
+};
+
+static void
+wpas_bss_add_entry(struct wpa_bss *bss)
+{
+	char *ssid;
+	void *c;
+
+	c = blobmsg_open_array(&b, NULL);
+	blobmsg_add_u32(&b, NULL, bss->id);
+	blobmsg_printf(&b, NULL, MACSTR, MAC2STR(bss->bssid));
+	ssid = blobmsg_alloc_string_buffer(&b, NULL, bss->ssid_len + 1);
+	memcpy(ssid, bss->ssid, bss->ssid_len);
+	ssid[bss->ssid_len] = '\0';
+	blobmsg_add_string_buffer(&b);
+	blobmsg_add_u32(&b, NULL, bss->freq);
+	blobmsg_add_u32(&b, NULL, bss->level);
+	blobmsg_add_u32(&b, NULL, bss->est_throughput);
+	blobmsg_add_u32(&b, NULL, bss->caps);
+	blobmsg_close_array(&b, c);
+}
+
+static int
+wpas_bss_list(struct ubus_context *ctx, struct ubus_object *obj,
+	      struct ubus_request_data *req, const char *method,
+	      struct blob_attr *msg)
+{
+	struct wpa_supplicant *wpa_s = get_wpas_from_object(obj);
+	struct wpa_bss *bss;
+	unsigned int i;
+	void *c;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "gen", wpa_s->ubus.bss_gen);
+
+	c = blobmsg_open_array(&b, "fields");
+	for (i = 0; i < ARRAY_SIZE(bss_fields); i++)
+		blobmsg_add_string(&b, NULL, bss_fields[i]);
+	blobmsg_close_array(&b, c);
+
+	c = blobmsg_open_array(&b, "bss");
+	dl_list_for_each(bss, &wpa_s->bss_id, struct wpa_bss, list_id)
+		wpas_bss_add_entry(bss);
+	blobmsg_close_array(&b, c);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
+static int
+wpas_bss_scan(struct ubus_context *ctx, struct ubus_object *obj,
+	      struct ubus_request_data *req, const char *method,
+	      struct blob_attr *msg)
+{
+	struct wpa_supplicant *wpa_s = get_wpas_from_object(obj);
+
+	if (wpa_s->wpa_state <= WPA_INTERFACE_DISABLED)
+		return UBUS_STATUS_NOT_SUPPORTED;
+
+	wpa_s->scan_req = MANUAL_SCAN_REQ;
+	wpa_supplicant_req_scan(wpa_s, 0, 0);
+
+	return 0;
+}
+
+static void
+wpas_ubus_bss_flush(void *eloop_data, void *user_ctx)
+{
+	struct wpa_supplicant *wpa_s = eloop_data;
+	struct wpas_ubus_bss *u = &wpa_s->ubus;
+	struct wpa_bss *bss;
+	size_t i, j;
+	void *c;
+
+	if (!ctx || !u->obj.has_subscribers)
+		goto out;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "gen", ++u->bss_gen);
+
+	c = blobmsg_open_array(&b, "added");
+	for (i = 0; i < u->n_bss_added; i++) {
+		bss = wpa_bss_get_id(wpa_s, u->bss_added[i]);
+		if (bss)
+			wpas_bss_add_entry(bss);
+	}
+	blobmsg_close_array(&b, c);
+
+	c = blobmsg_open_array(&b, "removed");
+	for (i = 0; i < u->n_bss_removed; i++)
+		blobmsg_add_u32(&b, NULL, u->bss_removed[i]);
+	blobmsg_close_array(&b, c);
+
+	/* flat id, signal pairs, skipping entries which were reported as added */
+	c = blobmsg_open_array(&b, "signal");
+	for (i = 0; i < u->n_bss_changed; i++) {
+		for (j = 0; j < u->n_bss_added; j++)
+			if (u->bss_added[j] == u->bss_changed[i])
+				break;
+
+		if (j < u->n_bss_added)
+			continue;
+
+		bss = wpa_bss_get_id(wpa_s, u->bss_changed[i]);
+		if (!bss)
+			continue;
+
+		blobmsg_add_u32(&b, NULL, bss->id);
+		blobmsg_add_u32(&b, NULL, bss->level);
+	}
+	blobmsg_close_array(&b, c);
+
+	ubus_notify(ctx, &u->obj, "bss_update", b.head, -1);
+
+out:
+	os_free(u->bss_added);
+	os_free(u->bss_changed);
+	os_free(u->bss_removed);
+	u->bss_added = NULL;
+	u->bss_changed = NULL;
+	u->bss_removed = NULL;
+	u->n_bss_added = 0;
+	u->n_bss_changed = 0;
+	u->n_bss_removed = 0;
+}
+
+/*
+ * Changes are collected while the current event (usually a scan result) is
+ * being processed and sent as one notification from the next eloop round.
+ */
+static bool
+wpas_ubus_bss_queue(struct wpa_supplicant *wpa_s)
+{
+	if (!ctx || !wpa_s->ubus.obj.id || !wpa_s->ubus.obj.has_subscribers)
+		return false;
+
+	if (!eloop_is_timeout_registered(wpas_ubus_bss_flush, wpa_s, NULL))
+		eloop_register_timeout(0, 0, wpas_ubus_bss_flush, wpa_s, NULL);
+
+	return true;
+}
+
+static void
+wpas_ubus_bss_queue_id(unsigned int **list, size_t *len, unsigned int id)
+{
+	unsigned int *n;
+
+	n = os_realloc_array(*list, *len + 1, sizeof(**list));
+	if (!n)
+		return;
+
+	n[(*len)++] = id;
+	*list = n;
+}
+
+void wpas_ubus_bss_added(struct wpa_supplicant *wpa_s, unsigned int id)
+{
+	struct wpas_ubus_bss *u = &wpa_s->ubus;
+
+	if (wpas_ubus_bss_queue(wpa_s))
+		wpas_ubus_bss_queue_id(&u->bss_added, &u->n_bss_added, id);
+}
+
+void wpas_ubus_bss_signal_changed(struct wpa_supplicant *wpa_s, unsigned int id)
+{
+	struct wpas_ubus_bss *u = &wpa_s->ubus;
+
+	if (wpas_ubus_bss_queue(wpa_s))
+		wpas_ubus_bss_queue_id(&u->bss_changed, &u->n_bss_changed, id);
+}
+
+void wpas_ubus_bss_removed(struct wpa_supplicant *wpa_s, const u8 *bssid,
+			   unsigned int id)
+{
+	struct wpas_ubus_bss *u = &wpa_s->ubus;
+
+	if (wpas_ubus_bss_queue(wpa_s))
+		wpas_ubus_bss_queue_id(&u->bss_removed, &u->n_bss_removed, id);
+}
+
 #ifdef CONFIG_WPS
 enum {
 	WPS_START_MULTI_AP,
@@ -166,6 +355,8 @@ wpas_bss_wps_cancel(struct ubus_context *ctx, struct ubus_object *obj,
 static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD_NOARG("reload", wpas_bss_reload),
 	UBUS_METHOD_NOARG("get_features", wpas_bss_get_features),
+	UBUS_METHOD_NOARG("bss_list", wpas_bss_list),
+	UBUS_METHOD_NOARG("scan", wpas_bss_scan),
 #ifdef CONFIG_WPS
 	UBUS_METHOD_NOARG("wps_start", wpas_bss_wps_start),
 	UBUS_METHOD_NOARG("wps_cancel", wpas_bss_wps_cancel),
@@ -200,6 +391,14 @@ void wpas_ubus_free_bss(struct wpa_supplicant *wpa_s)
 	struct ubus_object *obj = &wpa_s->ubus.obj;
 	char *name = (char *) obj->name;
 
+	eloop_cancel_timeout(wpas_ubus_bss_flush, wpa_s, NULL);
+	os_free(wpa_s->ubus.bss_added);
+	os_free(wpa_s->ubus.bss_changed);
+	os_free(wpa_s->ubus.bss_removed);
+	wpa_s->ubus.bss_added = NULL;
+	wpa_s->ubus.bss_changed = NULL;
+	wpa_s->ubus.bss_removed = NULL;
+
 	if (!ctx)
 		return;
 
@@ -19,11 +19,25 @@ struct wpa_global;
 
 struct wpas_ubus_bss {
 	struct ubus_object obj;
+
+	/* BSS table changes not yet sent to subscribers */
+	u32 bss_gen;
+	unsigned int *bss_added;
+	size_t n_bss_added;
+	unsigned int *bss_changed;
+	size_t n_bss_changed;
+	unsigned int *bss_removed;
+	size_t n_bss_removed;
 };
 
 void wpas_ubus_add_bss(struct wpa_supplicant *wpa_s);
 void wpas_ubus_free_bss(struct wpa_supplicant *wpa_s);
 
+void wpas_ubus_bss_added(struct wpa_supplicant *wpa_s, unsigned int id);
+void wpas_ubus_bss_removed(struct wpa_supplicant *wpa_s, const u8 *bssid,
+			   unsigned int id);
+void wpas_ubus_bss_signal_changed(struct wpa_supplicant *wpa_s, unsigned int id);
+
 void wpas_ubus_add(struct wpa_global *global);
 void wpas_ubus_free(struct wpa_global *global);
 
@@ -50,6 +64,19 @@ static inline void wpas_ubus_free_bss(struct wpa_supplicant *wpa_s)
 {
 }
 
+static inline void wpas_ubus_bss_added(struct wpa_supplicant *wpa_s, unsigned int id)
+{
+}
+
+static inline void wpas_ubus_bss_removed(struct wpa_supplicant *wpa_s, const u8 *bssid,
+					 unsigned int id)
+{
+}
+
+static inline void wpas_ubus_bss_signal_changed(struct wpa_supplicant *wpa_s, unsigned int id)
+{
+}
+
 static inline void wpas_ubus_notify(struct wpa_supplicant *wpa_s, struct wps_credential *cred)
 {
 }
@@ -17,6 +17,8 @@
  *
  */
 
+#include <stdio.h>
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -27,14 +29,17 @@
 #include <syslog.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
@@ -45,6 +50,22 @@
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
 
+#define RING_BLOCK_SIZE				(64 * 1024)
+#define RING_FRAME_SIZE				2048
+#define RING_BLOCK_TIMEOUT			100		/* ms */
+#define RING_DUMP_BLOCK_TIMEOUT		10000	/* ms */
+
+#define MAX_INTERFACES				8
+
+#define PCAPNG_BLOCK_SHB			0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB			0x00000001
+#define PCAPNG_BLOCK_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER			0x1A2B3C4D
+#define PCAPNG_OPT_END				0
+#define PCAPNG_OPT_IF_NAME			2
+#define PCAPNG_OPT_IF_TSRESOL		9
+#define PCAPNG_ALIGN(x)				(((x) + 3) & ~3)
+
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
 #else
@@ -55,43 +76,70 @@ uint8_t run_dump   = 0;
 uint8_t run_stop   = 0;
 uint8_t run_daemon = 0;
 
-uint32_t frames_captured = 0;
-uint32_t frames_filtered = 0;
-
-int capture_sock = -1;
-const char *ifname = NULL;
+uint8_t filter_data    = 0;
+uint8_t filter_beacon  = 0;
 
 
 struct ringbuf {
-	uint32_t len;            /* number of slots */
-	uint32_t fill;           /* last used slot */
-	uint32_t slen;           /* slot size */
-	void *buf;               /* ring memory */
+	uint8_t *map;            /* mmap()ed TPACKET_V3 ring */
+	uint32_t map_len;        /* size of the mapping */
+	uint32_t block_size;     /* size of one block */
+	uint32_t block_nr;       /* number of blocks */
+	uint32_t block_keep;     /* blocks retained for dumping */
+	uint32_t cur;            /* next block handed over by the kernel */
+	uint32_t held;           /* blocks currently retained */
 };
 
-struct ringbuf_entry {
-	uint32_t len;            /* used slot memory */
-	uint32_t olen;           /* original data size */
-	uint32_t sec;            /* epoch of slot creation */
-	uint32_t usec;			 /* epoch microseconds */
+struct ringbuf_iter {
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *hdr; /* current frame, NULL at end */
+	uint32_t block;           /* index of the current block */
+	uint32_t blocks;          /* retained blocks left after this one */
+	uint32_t pkts;            /* frames left in this block */
 };
 
-typedef struct pcap_hdr_s {
-	uint32_t magic_number;   /* magic number */
+struct capture {
+	const char *ifname;      /* monitor interface name */
+	int ifindex;             /* monitor interface index */
+	int sock;                /* PF_PACKET socket */
+	uint8_t promisc;         /* promisc mode was enabled by us */
+	uint8_t filter_kernel;   /* frame type filter runs in kernel */
+	uint32_t frames_captured;
+	uint32_t frames_filtered;
+	uint32_t frames_dropped;
+	struct ringbuf ring;
+};
+
+struct capture captures[MAX_INTERFACES];
+int num_captures = 0;
+
+typedef struct pcapng_shb_s {
+	uint32_t block_type;     /* PCAPNG_BLOCK_SHB */
+	uint32_t block_len;      /* total block length */
+	uint32_t byte_order;     /* byte order magic */
 	uint16_t version_major;  /* major version number */
 	uint16_t version_minor;  /* minor version number */
-	int32_t  thiszone;       /* GMT to local correction */
-	uint32_t sigfigs;        /* accuracy of timestamps */
+	int64_t  section_len;    /* section length, -1 if unknown */
+	uint32_t block_len2;     /* total block length */
+} __attribute__((__packed__)) pcapng_shb_t;
+
+typedef struct pcapng_idb_s {
+	uint32_t block_type;     /* PCAPNG_BLOCK_IDB */
+	uint32_t block_len;      /* total block length */
+	uint16_t link_type;      /* data link type */
+	uint16_t reserved;
 	uint32_t snaplen;        /* max length of captured packets, in octets */
-	uint32_t network;        /* data link type */
-} pcap_hdr_t;
-
-typedef struct pcaprec_hdr_s {
-	uint32_t ts_sec;         /* timestamp seconds */
-	uint32_t ts_usec;        /* timestamp microseconds */
+} pcapng_idb_t;
+
+typedef struct pcapng_epb_s {
+	uint32_t block_type;     /* PCAPNG_BLOCK_EPB */
+	uint32_t block_len;      /* total block length */
+	uint32_t interface_id;   /* index of the interface description */
+	uint32_t ts_high;        /* upper 32 bits of nanosecond timestamp */
+	uint32_t ts_low;         /* lower 32 bits of nanosecond timestamp */
 	uint32_t incl_len;       /* number of octets of packet saved in file */
 	uint32_t orig_len;       /* actual length of packet */
-} pcaprec_hdr_t;
+} pcapng_epb_t;
 
 typedef struct ieee80211_radiotap_header {
 	u_int8_t  it_version;    /* set to 0 */
@@ -101,32 +149,32 @@ typedef struct ieee80211_radiotap_header {
 } __attribute__((__packed__)) radiotap_hdr_t;
 
 
-int check_type(void)
+int check_type(struct capture *c)
 {
 	struct ifreq ifr;
 
-	strncpy(ifr.ifr_name, ifname, IFNAMSIZ);
+	strncpy(ifr.ifr_name, c->ifname, IFNAMSIZ);
 
-	if (ioctl(capture_sock, SIOCGIFHWADDR, &ifr) < 0)
+	if (ioctl(c->sock, SIOCGIFHWADDR, &ifr) < 0)
 		return -1;
 
 	return (ifr.ifr_hwaddr.sa_family == ARPHRD_IEEE80211_RADIOTAP);
 }
 
-int set_promisc(int on)
+int set_promisc(struct capture *c, int on)
 {
 	struct ifreq ifr;
 
-	strncpy(ifr.ifr_name, ifname, IFNAMSIZ);
+	strncpy(ifr.ifr_name, c->ifname, IFNAMSIZ);
 
-	if (ioctl(capture_sock, SIOCGIFFLAGS, &ifr) < 0)
+	if (ioctl(c->sock, SIOCGIFFLAGS, &ifr) < 0)
 		return -1;
 
 	if (on && !(ifr.ifr_flags & IFF_PROMISC))
 	{
 		ifr.ifr_flags |= IFF_PROMISC;
 
-		if (ioctl(capture_sock, SIOCSIFFLAGS, &ifr))
+		if (ioctl(c->sock, SIOCSIFFLAGS, &ifr))
 			return -1;
 
 		return 1;
@@ -135,7 +183,7 @@ int set_promisc(int on)
 	{
 		ifr.ifr_flags &= ~IFF_PROMISC;
 
-		if (ioctl(capture_sock, SIOCSIFFLAGS, &ifr))
+		if (ioctl(c->sock, SIOCSIFFLAGS, &ifr))
 			return -1;
 
 		return 1;
@@ -156,101 +204,355 @@ void sig_teardown(int sig)
 }
 
 
-void write_pcap_header(FILE *o)
+void write_pcapng_option(FILE *o, uint16_t code, const void *val, uint16_t len)
 {
-	pcap_hdr_t ghdr = {
-		.magic_number  = 0xa1b2c3d4,
-		.version_major = 2,
-		.version_minor = 4,
-		.thiszone      = 0,
-		.sigfigs       = 0,
-		.snaplen       = 0xFFFF,
-		.network       = DLT_IEEE802_11_RADIO
-	};
+	static const uint8_t pad[3] = { 0 };
+	uint16_t hdr[2] = { code, len };
 
-	fwrite(&ghdr, 1, sizeof(ghdr), o);
+	fwrite(hdr, 1, sizeof(hdr), o);
+
+	if (len > 0)
+	{
+		fwrite(val, 1, len, o);
+		fwrite(pad, 1, PCAPNG_ALIGN(len) - len, o);
+	}
 }
 
-void write_pcap_frame(FILE *o, uint32_t *sec, uint32_t *usec,
-					  uint16_t len, uint16_t olen)
+void write_pcapng_header(FILE *o, uint32_t snaplen)
 {
-	struct timeval tv;
-	pcaprec_hdr_t fhdr;
+	int i;
+	uint8_t tsresol = 9; /* nanoseconds */
+	uint16_t namelen;
+	uint32_t len;
+
+	pcapng_shb_t shb = {
+		.block_type    = PCAPNG_BLOCK_SHB,
+		.block_len     = sizeof(shb),
+		.byte_order    = PCAPNG_BYTE_ORDER,
+		.version_major = 1,
+		.version_minor = 0,
+		.section_len   = -1,
+		.block_len2    = sizeof(shb)
+	};
 
-	if (!sec || !usec)
-	{
-		gettimeofday(&tv, NULL);
-	}
-	else
+	pcapng_idb_t idb = {
+		.block_type    = PCAPNG_BLOCK_IDB,
+		.link_type     = DLT_IEEE802_11_RADIO,
+		.snaplen       = snaplen
+	};
+
+	fwrite(&shb, 1, sizeof(shb), o);
+
+	/* one interface description per capture, indexed like captures[] */
+	for (i = 0; i < num_captures; i++)
 	{
-		tv.tv_sec  = *sec;
-		tv.tv_usec = *usec;
+		namelen = strlen(captures[i].ifname);
+
+		len = sizeof(idb) +
+			4 + PCAPNG_ALIGN(namelen) +
+			4 + PCAPNG_ALIGN(sizeof(tsresol)) +
+			4 + sizeof(len);
+
+		idb.block_len = len;
+
+		fwrite(&idb, 1, sizeof(idb), o);
+		write_pcapng_option(o, PCAPNG_OPT_IF_NAME, captures[i].ifname, namelen);
+		write_pcapng_option(o, PCAPNG_OPT_IF_TSRESOL, &tsresol, sizeof(tsresol));
+		write_pcapng_option(o, PCAPNG_OPT_END, NULL, 0);
+		fwrite(&len, 1, sizeof(len), o);
 	}
+}
 
-	fhdr.ts_sec   = tv.tv_sec;
-	fhdr.ts_usec  = tv.tv_usec;
-	fhdr.incl_len = len;
-	fhdr.orig_len = olen;
+void write_pcapng_frame(FILE *o, uint32_t ifid, struct tpacket3_hdr *h,
+						uint32_t caplen)
+{
+	static const uint8_t pad[3] = { 0 };
+	uint64_t ts = (uint64_t)h->tp_sec * 1000000000ULL + h->tp_nsec;
+	uint32_t len = (h->tp_snaplen > caplen) ? caplen : h->tp_snaplen;
+
+	pcapng_epb_t epb = {
+		.block_type   = PCAPNG_BLOCK_EPB,
+		.block_len    = sizeof(epb) + PCAPNG_ALIGN(len) + sizeof(uint32_t),
+		.interface_id = ifid,
+		.ts_high      = ts >> 32,
+		.ts_low       = ts & 0xFFFFFFFF,
+		.incl_len     = len,
+		.orig_len     = h->tp_len
+	};
 
-	fwrite(&fhdr, 1, sizeof(fhdr), o);
+	fwrite(&epb, 1, sizeof(epb), o);
+	fwrite((uint8_t *)h + h->tp_mac, 1, len, o);
+	fwrite(pad, 1, PCAPNG_ALIGN(len) - len, o);
+	fwrite(&epb.block_len, 1, sizeof(epb.block_len), o);
 }
 
 
-struct ringbuf * ringbuf_init(uint32_t num_item, uint16_t len_item)
+int attach_filter(struct capture *c, uint16_t snaplen)
 {
-	static struct ringbuf r;
+	/*
+	 * Load the little endian radiotap length into X, then fetch the
+	 * frame control byte behind the radiotap header. Out of bounds loads
+	 * make the filter return 0, which drops truncated frames as well.
+	 */
+	struct sock_filter code[] = {
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 3),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K,   8),
+		BPF_STMT(BPF_MISC | BPF_TAX,          0),
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 2),
+		BPF_STMT(BPF_ALU | BPF_OR  | BPF_X,   0),
+		BPF_STMT(BPF_MISC | BPF_TAX,          0),
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_IND, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K,   FRAMETYPE_MASK),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   FRAMETYPE_BEACON, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K,             filter_beacon ? 0 : snaplen),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   FRAMETYPE_DATA, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K,             filter_data ? 0 : snaplen),
+		BPF_STMT(BPF_RET | BPF_K,             snaplen),
+	};
 
-	if (len_item <= 0)
-		return NULL;
+	struct sock_fprog prog = {
+		.len    = sizeof(code) / sizeof(code[0]),
+		.filter = code
+	};
+
+	return setsockopt(c->sock, SOL_SOCKET, SO_ATTACH_FILTER,
+					  &prog, sizeof(prog));
+}
+
+int check_frame(struct capture *c, struct tpacket3_hdr *h)
+{
+	const uint8_t *data = (uint8_t *)h + h->tp_mac;
+	const radiotap_hdr_t *rhdr = (const radiotap_hdr_t *)data;
+	uint32_t len = h->tp_snaplen;
+	uint8_t frametype;
+
+	if (c->filter_kernel)
+		return 1;
+
+	if (len <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= len)
+		return 0;
+
+	frametype = data[le16(rhdr->it_len)] & FRAMETYPE_MASK;
 
-	r.buf = malloc(num_item * (len_item + sizeof(struct ringbuf_entry)));
+	if ((filter_data   && frametype == FRAMETYPE_DATA) ||
+	    (filter_beacon && frametype == FRAMETYPE_BEACON))
+		return 0;
+
+	return 1;
+}
 
-	if (r.buf)
+
+int ringbuf_init(struct capture *c, uint32_t size, uint8_t streaming)
+{
+	struct ringbuf *r = &c->ring;
+	struct tpacket_req3 req = { 0 };
+	int version = TPACKET_V3;
+	long pagesz = sysconf(_SC_PAGESIZE);
+
+	r->block_size = RING_BLOCK_SIZE;
+
+	/*
+	 * The dump history is made of whole blocks, so use the smallest ones
+	 * there and only retire them early after a long idle time. Otherwise
+	 * nearly empty blocks retired every RING_BLOCK_TIMEOUT would push the
+	 * history out of the ring at low frame rates.
+	 */
+	while (r->block_size > pagesz &&
+	       (!streaming || r->block_size * 4 > size))
+		r->block_size /= 2;
+
+	if (r->block_size < RING_FRAME_SIZE)
+		r->block_size = RING_FRAME_SIZE;
+
+	r->block_nr = size / r->block_size;
+
+	if (r->block_nr < 3)
+		r->block_nr = 3;
+
+	/* leave at least one spare block to the kernel while holding the rest */
+	r->block_keep = r->block_nr - 2;
+	r->cur = 0;
+	r->held = 0;
+
+	req.tp_block_size = r->block_size;
+	req.tp_block_nr = r->block_nr;
+	req.tp_frame_size = RING_FRAME_SIZE;
+	req.tp_frame_nr = (r->block_size / RING_FRAME_SIZE) * r->block_nr;
+	req.tp_retire_blk_tov = streaming ? RING_BLOCK_TIMEOUT : RING_DUMP_BLOCK_TIMEOUT;
+
+	if (setsockopt(c->sock, SOL_PACKET, PACKET_VERSION,
+				   &version, sizeof(version)) ||
+	    setsockopt(c->sock, SOL_PACKET, PACKET_RX_RING,
+				   &req, sizeof(req)))
+		return -1;
+
+	r->map_len = r->block_size * r->block_nr;
+	r->map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE,
+				  MAP_SHARED, c->sock, 0);
+
+	if (r->map == MAP_FAILED)
 	{
-		r.len = num_item;
-		r.fill = 0;
-		r.slen = (len_item + sizeof(struct ringbuf_entry));
+		r->map = NULL;
+		return -1;
+	}
+
+	return 0;
+}
 
-		memset(r.buf, 0, num_item * len_item);
+struct tpacket_block_desc * ringbuf_block(struct ringbuf *r, uint32_t i)
+{
+	return (struct tpacket_block_desc *)(r->map + (i % r->block_nr) * r->block_size);
+}
+
+void ringbuf_release(struct tpacket_block_desc *bd)
+{
+	__sync_synchronize();
+	bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+}
 
-		return &r;
+/* hand the current block over to the dump history, recycling the oldest */
+void ringbuf_hold(struct ringbuf *r)
+{
+	if (r->held >= r->block_keep)
+	{
+		ringbuf_release(ringbuf_block(r, r->cur + r->block_nr - r->held));
+		r->held--;
 	}
 
-	return NULL;
+	r->held++;
 }
 
-struct ringbuf_entry * ringbuf_add(struct ringbuf *r)
+void ringbuf_free(struct ringbuf *r)
 {
-	struct timeval t;
-	struct ringbuf_entry *e;
+	if (r->map)
+		munmap(r->map, r->map_len);
+
+	memset(r, 0, sizeof(*r));
+}
 
-	gettimeofday(&t, NULL);
 
-	e = r->buf + (r->fill++ * r->slen);
-	r->fill %= r->len;
+static void ringbuf_iter_block(struct ringbuf_iter *it)
+{
+	it->pkts = it->bd->hdr.bh1.num_pkts;
+	it->hdr = it->pkts ? (struct tpacket3_hdr *)((uint8_t *)it->bd +
+		it->bd->hdr.bh1.offset_to_first_pkt) : NULL;
+}
 
-	memset(e, 0, r->slen);
+/* advance to the next frame passing the filter, returns NULL at the end */
+struct tpacket3_hdr * ringbuf_iter_next(struct capture *c,
+										struct ringbuf_iter *it)
+{
+	while (1)
+	{
+		if (it->hdr && it->pkts > 1)
+		{
+			it->hdr = (struct tpacket3_hdr *)((uint8_t *)it->hdr +
+				it->hdr->tp_next_offset);
+			it->pkts--;
+		}
+		else if (it->blocks > 0)
+		{
+			it->block = (it->block + 1) % c->ring.block_nr;
+			it->bd = ringbuf_block(&c->ring, it->block);
+			it->blocks--;
+			ringbuf_iter_block(it);
 
-	e->sec = t.tv_sec;
-	e->usec = t.tv_usec;
+			if (!it->hdr)
+				continue;
+		}
+		else
+		{
+			it->hdr = NULL;
+			return NULL;
+		}
 
-	return e;
+		if (check_frame(c, it->hdr))
+			return it->hdr;
+	}
 }
 
-struct ringbuf_entry * ringbuf_get(struct ringbuf *r, int i)
+/* iterate a single block, or all retained blocks if bd is NULL */
+struct tpacket3_hdr * ringbuf_iter_init(struct capture *c,
+										struct ringbuf_iter *it,
+										struct tpacket_block_desc *bd)
 {
-	struct ringbuf_entry *e = r->buf + (((r->fill + i) % r->len) * r->slen);
+	struct ringbuf *r = &c->ring;
+
+	if (!bd && !r->held)
+	{
+		it->hdr = NULL;
+		return NULL;
+	}
 
-	if (e->len > 0)
-		return e;
+	it->block = bd ? r->cur : (r->cur + r->block_nr - r->held) % r->block_nr;
+	it->bd = ringbuf_block(r, it->block);
+	it->blocks = bd ? 0 : r->held - 1;
+	ringbuf_iter_block(it);
 
-	return NULL;
+	if (it->hdr && check_frame(c, it->hdr))
+		return it->hdr;
+
+	return ringbuf_iter_next(c, it);
 }
 
-void ringbuf_free(struct ringbuf *r)
+
+/* write the retained blocks of all interfaces, merged by timestamp */
+int write_pcapng_dump(FILE *o, uint16_t caplen)
 {
-	free(r->buf);
-	memset(r, 0, sizeof(*r));
+	struct ringbuf_iter it[MAX_INTERFACES];
+	struct tpacket3_hdr *h;
+	int i, min, n = 0;
+
+	for (i = 0; i < num_captures; i++)
+		ringbuf_iter_init(&captures[i], &it[i], NULL);
+
+	while (1)
+	{
+		for (i = 0, min = -1; i < num_captures; i++)
+		{
+			if (!(h = it[i].hdr))
+				continue;
+
+			if (min < 0 ||
+			    h->tp_sec < it[min].hdr->tp_sec ||
+			    (h->tp_sec == it[min].hdr->tp_sec &&
+			     h->tp_nsec < it[min].hdr->tp_nsec))
+				min = i;
+		}
+
+		if (min < 0)
+			break;
+
+		write_pcapng_frame(o, min, it[min].hdr, caplen);
+		ringbuf_iter_next(&captures[min], &it[min]);
+		n++;
+	}
+
+	return n;
+}
+
+/* count and stream out a block which just got handed over by the kernel */
+void process_block(struct capture *c, struct tpacket_block_desc *bd,
+				   FILE *o)
+{
+	struct ringbuf_iter it;
+	struct tpacket3_hdr *h;
+	uint32_t n = 0;
+
+	c->frames_captured += bd->hdr.bh1.num_pkts;
+
+	if (c->filter_kernel && !o)
+		return;
+
+	for (h = ringbuf_iter_init(c, &it, bd); h; h = ringbuf_iter_next(c, &it))
+	{
+		if (o)
+			write_pcapng_frame(o, c - captures, h, 0xFFFF);
+
+		n++;
+	}
+
+	c->frames_filtered += bd->hdr.bh1.num_pkts - n;
 }
 
 
@@ -270,29 +572,23 @@ void msg(const char *fmt, ...)
 
 int main(int argc, char **argv)
 {
-	int i, n;
-	struct ringbuf *ring;
-	struct ringbuf_entry *e;
+	int i, n, busy;
+	struct capture *c;
+	struct tpacket_block_desc *bd;
+	struct tpacket_stats_v3 stats;
+	socklen_t statslen;
+	struct pollfd pfds[MAX_INTERFACES];
 	struct sockaddr_ll local = {
 		.sll_family   = AF_PACKET,
 		.sll_protocol = htons(ETH_P_ALL)
 	};
 
-	radiotap_hdr_t *rhdr;
-
-	uint8_t frametype;
-	uint8_t pktbuf[0xFFFF];
-	ssize_t pktlen;
-
 	FILE *o;
 
 	int opt;
 
-	uint8_t promisc        = 0;
 	uint8_t streaming      = 0;
 	uint8_t foreground     = 0;
-	uint8_t filter_data    = 0;
-	uint8_t filter_beacon  = 0;
 	uint8_t header_written = 0;
 
 	uint32_t ringsz   = 1024 * 1024; /* 1 Mbyte ring buffer */
@@ -306,12 +602,24 @@ int main(int argc, char **argv)
 		switch (opt)
 		{
 		case 'i':
-			ifname = optarg;
-			if (!(local.sll_ifindex = if_nametoindex(ifname)))
+			if (num_captures >= MAX_INTERFACES)
+			{
+				msg("Too many interfaces, at most %d are supported\n",
+					MAX_INTERFACES);
+				return 2;
+			}
+
+			c = &captures[num_captures];
+			c->ifname = optarg;
+			c->sock = -1;
+
+			if (!(c->ifindex = if_nametoindex(c->ifname)))
 			{
-				msg("Unknown interface '%s'\n", ifname);
+				msg("Unknown interface '%s'\n", c->ifname);
 				return 2;
 			}
+
+			num_captures++;
 			break;
 
 		case 'r':
@@ -358,19 +666,22 @@ int main(int argc, char **argv)
 		case 'h':
 			msg(
 				"Usage:\n"
-				"  %s -i {iface} -s [-b] [-d]\n"
-				"  %s -i {iface} -o {file} [-r len] [-c len] [-B] [-D] [-f]\n"
+				"  %s -i {iface} [-i {iface} ...] -s [-b] [-d]\n"
+				"  %s -i {iface} [-i {iface} ...] -o {file} [-r len] [-c len] [-B] [-D] [-f]\n"
 				"\n"
 				"  -i iface\n"
 				"    Specify interface to use, must be in monitor mode and\n"
-				"    produce IEEE 802.11 Radiotap headers.\n\n"
+				"    produce IEEE 802.11 Radiotap headers. May be given up\n"
+				"    to %d times to capture on several radios at once.\n\n"
 				"  -s\n"
 				"    Stream to stdout instead of Dumping to file on USR1.\n\n"
 				"  -o file\n"
 				"    Write current ringbuffer contents to given output file\n"
 				"    on receipt of SIGUSR1.\n\n"
 				"  -r len\n"
-				"    Specify the amount of bytes to use for the ringbuffer.\n"
+				"    Specify the amount of bytes to use for the ringbuffer\n"
+				"    of each interface. The ring is shared with the kernel,\n"
+				"    frames are not copied.\n"
 				"    The default length is %d bytes.\n\n"
 				"  -c len\n"
 				"    Truncate captured packets after given amount of bytes.\n"
@@ -382,8 +693,10 @@ int main(int argc, char **argv)
 				"  -f\n"
 				"    Do not daemonize but keep running in foreground.\n\n"
 				"  -h\n"
-				"    Display this help.\n\n",
-				argv[0], argv[0], ringsz, pktcap);
+				"    Display this help.\n\n"
+				"Output is written in pcapng format with one interface\n"
+				"description per captured interface.\n\n",
+				argv[0], argv[0], MAX_INTERFACES, ringsz, pktcap);
 
 			return 1;
 		}
@@ -407,30 +720,51 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
-	if (!local.sll_ifindex)
+	if (!num_captures)
 	{
 		msg("No interface specified\n");
 		return 2;
 	}
 
-	if (!check_type())
+	for (i = 0; i < num_captures; i++)
 	{
-		msg("Bad interface: not ARPHRD_IEEE80211_RADIOTAP\n");
-		return 2;
-	}
+		c = &captures[i];
 
-	if ((capture_sock = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0)
-	{
-		msg("Unable to create raw socket: %s\n",
-				strerror(errno));
-		return 6;
-	}
+		/* do not receive anything before the filter and ring are set up */
+		if ((c->sock = socket(PF_PACKET, SOCK_RAW, 0)) < 0)
+		{
+			msg("Unable to create raw socket: %s\n",
+					strerror(errno));
+			return 6;
+		}
 
-	if (bind(capture_sock, (struct sockaddr *)&local, sizeof(local)) == -1)
-	{
-		msg("Unable to bind to interface: %s\n",
-			strerror(errno));
-		return 7;
+		if (check_type(c) != 1)
+		{
+			msg("Bad interface %s: not ARPHRD_IEEE80211_RADIOTAP\n",
+				c->ifname);
+			return 2;
+		}
+
+		c->filter_kernel = !attach_filter(c, streaming ? 0xFFFF : pktcap);
+
+		if (ringbuf_init(c, ringsz, streaming))
+		{
+			msg("Unable to set up capture ring on %s: %s\n",
+				c->ifname, strerror(errno));
+			return 5;
+		}
+
+		local.sll_ifindex = c->ifindex;
+
+		if (bind(c->sock, (struct sockaddr *)&local, sizeof(local)) == -1)
+		{
+			msg("Unable to bind to interface %s: %s\n",
+				c->ifname, strerror(errno));
+			return 7;
+		}
+
+		pfds[i].fd = c->sock;
+		pfds[i].events = POLLIN | POLLERR;
 	}
 
 	if (!streaming)
@@ -458,16 +792,14 @@ int main(int argc, char **argv)
 			}
 		}
 
-		msg("Monitoring interface %s ...\n", ifname);
-
-		if (!(ring = ringbuf_init(ringsz / pktcap, pktcap)))
+		for (i = 0; i < num_captures; i++)
 		{
-			msg("Unable to allocate ring buffer: %s\n",
-				strerror(errno));
-			return 5;
+			msg("Monitoring interface %s ...\n", captures[i].ifname);
+			msg(" * Using %d bytes ringbuffer with %d blocks of %d bytes\n",
+				captures[i].ring.map_len, captures[i].ring.block_nr,
+				captures[i].ring.block_size);
 		}
 
-		msg(" * Using %d bytes ringbuffer with %d slots\n", ringsz, ring->len);
 		msg(" * Truncating frames at %d bytes\n", pktcap);
 		msg(" * Dumping data to file %s\n", output);
 
@@ -475,17 +807,25 @@ int main(int argc, char **argv)
 	}
 	else
 	{
-		msg("Monitoring interface %s ...\n", ifname);
+		for (i = 0; i < num_captures; i++)
+			msg("Monitoring interface %s ...\n", captures[i].ifname);
+
 		msg(" * Streaming data to stdout\n");
 	}
 
 	msg(" * Beacon frames are %sfiltered\n", filter_beacon ? "" : "not ");
 	msg(" * Data frames are %sfiltered\n", filter_data ? "" : "not ");
 
+	for (i = 0; i < num_captures; i++)
+		if ((filter_beacon || filter_data) && !captures[i].filter_kernel)
+			msg(" * Kernel filter unavailable on %s, filtering in userspace\n",
+				captures[i].ifname);
+
 	signal(SIGINT, sig_teardown);
 	signal(SIGTERM, sig_teardown);
 
-	promisc = set_promisc(1);
+	for (i = 0; i < num_captures; i++)
+		captures[i].promisc = (set_promisc(&captures[i], 1) == 1);
 
 	/* capture loop */
 	while (1)
@@ -501,23 +841,32 @@ int main(int argc, char **argv)
 			}
 			else
 			{
-				write_pcap_header(o);
+				write_pcapng_header(o, pktcap);
+
+				/* sig_dump retained ring blocks, oldest first */
+				n = write_pcapng_dump(o, pktcap);
 
-				/* sig_dump packet buffer */
-				for (i = 0, n = 0; i < ring->len; i++)
+				fclose(o);
+
+				for (i = 0; i < num_captures; i++)
 				{
-					if (!(e = ringbuf_get(ring, i)))
-						continue;
+					c = &captures[i];
+					statslen = sizeof(stats);
 
-					write_pcap_frame(o, &(e->sec), &(e->usec), e->len, e->olen);
-					fwrite((void *)e + sizeof(*e), 1, e->len, o);
-					n++;
-				}
+					if (getsockopt(c->sock, SOL_PACKET, PACKET_STATISTICS,
+								   &stats, &statslen))
+						memset(&stats, 0, sizeof(stats));
 
-				fclose(o);
+					c->frames_dropped += stats.tp_drops;
+
+					msg(" * %s: %d frames captured\n",
+						c->ifname, c->frames_captured);
+					msg(" * %s: %d frames filtered\n",
+						c->ifname, c->frames_filtered);
+					msg(" * %s: %d frames dropped\n",
+						c->ifname, c->frames_dropped);
+				}
 
-				msg(" * %d frames captured\n", frames_captured);
-				msg(" * %d frames filtered\n", frames_filtered);
 				msg(" * %d frames dumped\n", n);
 			}
 
@@ -527,56 +876,54 @@ int main(int argc, char **argv)
 		{
 			msg("Shutting down ...\n");
 
-			if (promisc)
-				set_promisc(0);
+			for (i = 0; i < num_captures; i++)
+			{
+				if (captures[i].promisc)
+					set_promisc(&captures[i], 0);
 
-			if (ring)
-				ringbuf_free(ring);
+				ringbuf_free(&captures[i].ring);
+				close(captures[i].sock);
+			}
 
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
-		frames_captured++;
-
-		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
-
-		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
+		/* collect every block the kernel handed over on any interface */
+		for (i = 0, busy = 0; i < num_captures; i++)
 		{
-			frames_filtered++;
-			continue;
-		}
+			c = &captures[i];
+			bd = ringbuf_block(&c->ring, c->ring.cur);
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+			if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
+				continue;
 
-		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
-		{
-			frames_filtered++;
-			continue;
-		}
+			__sync_synchronize();
 
-		if (streaming)
-		{
-			if (!header_written)
+			if (streaming)
+			{
+				if (!header_written)
+				{
+					write_pcapng_header(stdout, 0xFFFF);
+					header_written = 1;
+				}
+
+				process_block(c, bd, stdout);
+				ringbuf_release(bd);
+			}
+			else
 			{
-				write_pcap_header(stdout);
-				header_written = 1;
+				process_block(c, bd, NULL);
+				ringbuf_hold(&c->ring);
 			}
 
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
+			c->ring.cur = (c->ring.cur + 1) % c->ring.block_nr;
+			busy = 1;
 		}
-		else
-		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
-			e->len = (pktlen > pktcap) ? pktcap : pktlen;
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
-		}
+		if (streaming && busy)
+			fflush(stdout);
+		else if (!busy)
+			poll(pfds, num_captures, 1000);
 	}
 
 	return 0;
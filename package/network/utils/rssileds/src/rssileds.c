@@ -26,17 +26,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <net/if.h>
+
+#include <linux/nl80211.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/family.h>
+#include <netlink/genl/ctrl.h>
+#include <libubox/uloop.h>
 
 #include "iwinfo.h"
 
 #define RUN_DIR			"/var/run"
 #define LEDS_BASEPATH		"/sys/class/leds/"
 #define BACKEND_RETRY_DELAY	500000
+#define POLL_BACKOFF_MAX	16
+#define CQM_MAX_THRESHOLDS	32
 
 char *ifname;
 int qual_max;
@@ -206,11 +216,249 @@ void update_leds(rule_t *rules, int q)
 	}
 }
 
+/*
+ * Event driven operation: the kernel is asked to report CQM RSSI events
+ * whenever the signal crosses one of the rule boundaries or moves more
+ * than the sustain threshold away from the last reported level. Only if
+ * that is not possible (no nl80211, AP mode, driver without threshold
+ * list support) the quality is polled, backing off while it is stable.
+ */
+static const struct iwinfo_ops *iw;
+static rule_t *headrule;
+static int refresh, threshold, q0 = -1;
+static int poll_backoff = 1;
+static unsigned long wakeups;
+
+static struct nl_sock *nl_cmd, *nl_evt;
+static int nl80211_id = -1;
+static int ifindex;
+static int cqm_active;
+static int cqm_unsupported;
+
+static struct uloop_fd nl_evt_fd;
+static struct uloop_fd sig_fd;
+static struct uloop_timeout poll_timer;
+static int sig_pipe[2] = { -1, -1 };
+
+/* invert the cfg80211 wext compat mapping used by iwinfo's nl80211 backend */
+static int quality_to_dbm(int q)
+{
+	return (q * 70) / 100 - 110;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static int cqm_add_threshold(int *thold, int n, int q)
+{
+	if (q < 0 || q > 100 || n >= CQM_MAX_THRESHOLDS)
+		return n;
+
+	thold[n] = quality_to_dbm(q);
+
+	return n + 1;
+}
+
+static int cqm_arm(int q)
+{
+	int thold[CQM_MAX_THRESHOLDS];
+	struct nl_msg *msg;
+	struct nlattr *cqm;
+	rule_t *rule;
+	int i, j, n = 0, ret = -1;
+
+	if (nl80211_id < 0 || cqm_unsupported)
+		return -1;
+
+	for (rule = headrule; rule; rule = rule->next) {
+		n = cqm_add_threshold(thold, n, rule->minq);
+		n = cqm_add_threshold(thold, n, rule->maxq + 1);
+	}
+
+	if (q >= 0) {
+		n = cqm_add_threshold(thold, n, q - threshold - 1);
+		n = cqm_add_threshold(thold, n, q + threshold + 1);
+	}
+
+	if (!n)
+		return -1;
+
+	/* nl80211 wants a strictly ascending list */
+	qsort(thold, n, sizeof(thold[0]), cmp_int);
+	for (i = 1, j = 0; i < n; i++)
+		if (thold[i] != thold[j])
+			thold[++j] = thold[i];
+	n = j + 1;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -1;
+
+	if (!genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_CQM, 0) ||
+	    nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifindex))
+		goto out;
+
+	cqm = nla_nest_start(msg, NL80211_ATTR_CQM);
+	if (!cqm ||
+	    nla_put(msg, NL80211_ATTR_CQM_RSSI_THOLD, n * sizeof(thold[0]), thold) ||
+	    nla_put_u32(msg, NL80211_ATTR_CQM_RSSI_HYST, 0))
+		goto out;
+	nla_nest_end(msg, cqm);
+
+	if (nl_send_auto_complete(nl_cmd, msg) < 0)
+		goto out;
+
+	ret = nl_wait_for_ack(nl_cmd);
+
+	/* not a station, or no threshold list support: stay in polling mode */
+	if (ret == -NLE_OPNOTSUPP || ret == -NLE_INVAL)
+		cqm_unsupported = 1;
+
+out:
+	nlmsg_free(msg);
+	return ret;
+}
+
+static void update(void)
+{
+	int q;
+
+	q = quality(iw, ifname);
+	if ( q < q0 - threshold || q > q0 + threshold ) {
+		update_leds(headrule, q);
+		q0 = q;
+		poll_backoff = 1;
+	} else if (poll_backoff < POLL_BACKOFF_MAX) {
+		poll_backoff *= 2;
+	}
+
+	// re-open backend...
+	if ( q == -1 && q0 == -1 ) {
+		if (iw) {
+			iwinfo_finish();
+			iw = NULL;
+			usleep(BACKEND_RETRY_DELAY);
+		}
+		while (open_backend(&iw, ifname))
+			usleep(BACKEND_RETRY_DELAY);
+
+		/* set the LEDs now, an event may not come for a long time */
+		q = quality(iw, ifname);
+		update_leds(headrule, q);
+		q0 = q;
+	}
+
+	if (iw && strcmp(iw->name, "nl80211"))
+		cqm_unsupported = 1;
+
+	if (cqm_arm(q0)) {
+		if (cqm_active)
+			syslog(LOG_INFO, "lost RSSI events on %s, polling\n", ifname);
+		cqm_active = 0;
+	} else if (!cqm_active) {
+		syslog(LOG_INFO, "using RSSI events on %s\n", ifname);
+		cqm_active = 1;
+	}
+
+	if (cqm_active)
+		uloop_timeout_cancel(&poll_timer);
+	else
+		uloop_timeout_set(&poll_timer, (refresh / 1000) * poll_backoff);
+}
+
+static void poll_timer_cb(struct uloop_timeout *t)
+{
+	wakeups++;
+	update();
+}
+
+static int nl_event_cb(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+
+	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[NL80211_ATTR_IFINDEX] ||
+	    nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != ifindex)
+		return NL_SKIP;
+
+	switch (gnlh->cmd) {
+	case NL80211_CMD_NOTIFY_CQM:
+	case NL80211_CMD_CONNECT:
+	case NL80211_CMD_DISCONNECT:
+	case NL80211_CMD_NEW_STATION:
+	case NL80211_CMD_DEL_STATION:
+		update();
+		break;
+	}
+
+	return NL_SKIP;
+}
+
+static void nl_evt_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	wakeups++;
+	nl_recvmsgs_default(nl_evt);
+}
+
+static int nl_init(void)
+{
+	int grp;
+
+	ifindex = if_nametoindex(ifname);
+	if (!ifindex)
+		return -1;
+
+	nl_cmd = nl_socket_alloc();
+	nl_evt = nl_socket_alloc();
+	if (!nl_cmd || !nl_evt)
+		return -1;
+
+	if (genl_connect(nl_cmd) || genl_connect(nl_evt))
+		return -1;
+
+	nl80211_id = genl_ctrl_resolve(nl_cmd, "nl80211");
+	grp = genl_ctrl_resolve_grp(nl_cmd, "nl80211", "mlme");
+	if (nl80211_id < 0 || grp < 0)
+		return -1;
+
+	if (nl_socket_add_membership(nl_evt, grp))
+		return -1;
+
+	nl_socket_disable_seq_check(nl_evt);
+	nl_socket_modify_cb(nl_evt, NL_CB_VALID, NL_CB_CUSTOM, nl_event_cb, NULL);
+
+	nl_evt_fd.fd = nl_socket_get_fd(nl_evt);
+	nl_evt_fd.cb = nl_evt_fd_cb;
+	uloop_fd_add(&nl_evt_fd, ULOOP_READ);
+
+	return 0;
+}
+
+static void sig_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	char buf[8];
+
+	while (read(fd->fd, buf, sizeof(buf)) > 0);
+
+	syslog(LOG_INFO, "%lu wakeups, %s mode\n", wakeups,
+	       cqm_active ? "event" : "polling");
+}
+
+static void sigusr1_handler(int sig)
+{
+	if (write(sig_pipe[1], "", 1) < 0)
+		return;
+}
+
 int main(int argc, char **argv)
 {
-	int i,q,q0,r,s;
-	const struct iwinfo_ops *iw = NULL;
-	rule_t *headrule = NULL, *currentrule = NULL;
+	int i,r,s;
+	rule_t *currentrule = NULL;
 
 	if (argc < 9 || ( (argc-4) % 5 != 0 ) )
 	{
@@ -264,26 +512,31 @@ int main(int argc, char **argv)
 	}
 	log_rules(headrule);
 
-	q0 = -1;
-	do {
-		q = quality(iw, ifname);
-		if ( q < q0 - s || q > q0 + s ) {
-			update_leds(headrule, q);
-			q0=q;
-		};
-		// re-open backend...
-		if ( q == -1 && q0 == -1 ) {
-			if (iw) {
-				iwinfo_finish();
-				iw=NULL;
-				usleep(BACKEND_RETRY_DELAY);
-			}
-			while (open_backend(&iw, ifname))
-				usleep(BACKEND_RETRY_DELAY);
-		}
-		usleep(r);
-	} while(1);
+	refresh = r < 1000 ? 1000 : r;
+	threshold = s;
+
+	uloop_init();
+
+	if (nl_init()) {
+		syslog(LOG_INFO, "nl80211 events unavailable, polling\n");
+		nl80211_id = -1;
+	}
+
+	if (!pipe(sig_pipe)) {
+		fcntl(sig_pipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(sig_pipe[1], F_SETFL, O_NONBLOCK);
+		sig_fd.fd = sig_pipe[0];
+		sig_fd.cb = sig_fd_cb;
+		uloop_fd_add(&sig_fd, ULOOP_READ);
+		signal(SIGUSR1, sigusr1_handler);
+	}
+
+	poll_timer.cb = poll_timer_cb;
+	update();
+	uloop_run();
+	uloop_done();
 
+	syslog(LOG_INFO, "%lu wakeups\n", wakeups);
 	iwinfo_finish();
 
 	return 0;
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * XDP variant of trelay: relays frames between two devices without passing
+ * them through the network stack
+ */
+#define KBUILD_MODNAME "trelay"
+#include <uapi/linux/bpf.h>
+#include <uapi/linux/if_ether.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+#include "trelay-bpf.h"
+
+/* ifindex of each device of the pair -> ifindex of the other one */
+struct {
+	__uint(type, BPF_MAP_TYPE_DEVMAP_HASH);
+	__uint(max_entries, 2);
+	__type(key, __u32);
+	__type(value, __u32);
+} peer SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, __u32);
+	__type(value, struct trelay_stats);
+} stats SEC(".maps");
+
+SEC("xdp")
+int trelay_xdp(struct xdp_md *ctx)
+{
+	void *data = (void *)(long)ctx->data;
+	void *data_end = (void *)(long)ctx->data_end;
+	struct ethhdr *eth = data;
+	struct trelay_stats *s;
+	__u32 len = data_end - data;
+	__u32 key = 0;
+	int ret;
+
+	if ((void *)(eth + 1) > data_end)
+		return XDP_PASS;
+
+	/* Leave EAPOL to the local authenticator/supplicant */
+	if (eth->h_proto == bpf_htons(ETH_P_PAE))
+		return XDP_PASS;
+
+	ret = bpf_redirect_map(&peer, ctx->ingress_ifindex, XDP_DROP);
+
+	s = bpf_map_lookup_elem(&stats, &key);
+	if (!s)
+		return ret;
+
+	s->rx_packets++;
+	s->rx_bytes += len;
+	if (ret == XDP_REDIRECT) {
+		s->tx_packets++;
+		s->tx_bytes += len;
+	} else {
+		s->tx_dropped++;
+	}
+
+	return ret;
+}
+
+char _license[] SEC("license") = "GPL";
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef __TRELAY_BPF_H
+#define __TRELAY_BPF_H
+
+/*
+ * Per-CPU counters, the same ones the rx_handler shows in debugfs. tx counts
+ * frames handed to the peer device, errors on its transmit side are only
+ * reported by the xdp:xdp_redirect_err tracepoint.
+ */
+struct trelay_stats {
+	__u64 rx_packets;
+	__u64 rx_bytes;
+	__u64 tx_packets;
+	__u64 tx_bytes;
+	__u64 tx_dropped;
+};
+
+#endif
@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * trelay-xdp: load and manage the XDP variant of trelay
+ *
+ * The program and its maps are pinned below TRELAY_PIN_DIR/<name>, which
+ * keeps the counters readable and allows to detach the program again later.
+ */
+#include <errno.h>
+#include <limits.h>
+#include <net/if.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <linux/if_link.h>
+#include <linux/types.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include "trelay-bpf.h"
+
+#define TRELAY_BPF_PROG	"/lib/bpf/trelay-bpf.o"
+#define TRELAY_PIN_DIR	"/sys/fs/bpf/trelay"
+
+static const char * const trelay_pins[] = { "prog", "peer", "stats" };
+
+static void trelay_pin_path(char *buf, const char *name, const char *pin)
+{
+	snprintf(buf, PATH_MAX, TRELAY_PIN_DIR "/%s%s%s", name, pin ? "/" : "", pin ? pin : "");
+}
+
+static int trelay_pin_get(const char *name, const char *pin)
+{
+	char path[PATH_MAX];
+
+	trelay_pin_path(path, name, pin);
+	return bpf_obj_get(path);
+}
+
+static void trelay_unpin(const char *name)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i = 0; i < sizeof(trelay_pins) / sizeof(trelay_pins[0]); i++) {
+		trelay_pin_path(path, name, trelay_pins[i]);
+		unlink(path);
+	}
+
+	trelay_pin_path(path, name, NULL);
+	rmdir(path);
+}
+
+/*
+ * Only detach our own program, in whichever mode it was attached. Devices
+ * which are gone have lost it already.
+ */
+static void trelay_detach(__u32 ifindex, int prog_fd)
+{
+	DECLARE_LIBBPF_OPTS(bpf_xdp_attach_opts, opts, .old_prog_fd = prog_fd);
+
+	bpf_xdp_detach(ifindex, XDP_FLAGS_DRV_MODE | XDP_FLAGS_REPLACE, &opts);
+	bpf_xdp_detach(ifindex, XDP_FLAGS_SKB_MODE | XDP_FLAGS_REPLACE, &opts);
+}
+
+static int trelay_remove(const char *name)
+{
+	__u32 key, next, *prev = NULL;
+	char path[PATH_MAX];
+	int prog_fd, peer_fd;
+
+	trelay_pin_path(path, name, NULL);
+	if (access(path, F_OK)) {
+		fprintf(stderr, "Relay %s not found\n", name);
+		return -ENOENT;
+	}
+
+	prog_fd = trelay_pin_get(name, "prog");
+	peer_fd = trelay_pin_get(name, "peer");
+	if (prog_fd >= 0 && peer_fd >= 0) {
+		while (!bpf_map_get_next_key(peer_fd, prev, &next)) {
+			trelay_detach(next, prog_fd);
+			key = next;
+			prev = &key;
+		}
+	}
+
+	if (peer_fd >= 0)
+		close(peer_fd);
+	if (prog_fd >= 0)
+		close(prog_fd);
+	trelay_unpin(name);
+
+	return 0;
+}
+
+/* A relay is up as long as the peer map still holds both of its devices */
+static bool trelay_active(const char *name, __u32 *ifindex)
+{
+	__u32 val;
+	bool ret;
+	int fd;
+
+	fd = trelay_pin_get(name, "peer");
+	if (fd < 0)
+		return false;
+
+	ret = !bpf_map_lookup_elem(fd, &ifindex[0], &val) && val == ifindex[1] &&
+	      !bpf_map_lookup_elem(fd, &ifindex[1], &val) && val == ifindex[0];
+	close(fd);
+
+	return ret;
+}
+
+/*
+ * Both devices use the same mode: a native redirect needs XDP support on the
+ * target device too. Generic XDP works with any device.
+ */
+static int trelay_attach(__u32 *ifindex, int prog_fd, bool generic)
+{
+	static const __u32 modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+	int i, m, err = 0;
+
+	for (m = generic ? 1 : 0; m < 2; m++) {
+		for (i = 0; i < 2; i++) {
+			err = bpf_xdp_attach(ifindex[i], prog_fd,
+					     modes[m] | XDP_FLAGS_UPDATE_IF_NOEXIST, NULL);
+			if (err)
+				break;
+		}
+		if (i == 2)
+			return 0;
+
+		while (i-- > 0)
+			trelay_detach(ifindex[i], prog_fd);
+	}
+
+	return err;
+}
+
+static int trelay_add(const char *name, const char *dev1, const char *dev2, bool generic)
+{
+	struct bpf_object *obj;
+	struct bpf_program *prog;
+	char path[PATH_MAX];
+	__u32 ifindex[2];
+	int prog_fd, peer_fd, stats_fd;
+	int i, err;
+
+	ifindex[0] = if_nametoindex(dev1);
+	ifindex[1] = if_nametoindex(dev2);
+	if (!ifindex[0] || !ifindex[1]) {
+		fprintf(stderr, "Device %s not found\n", ifindex[0] ? dev2 : dev1);
+		return -ENOENT;
+	}
+
+	if (trelay_active(name, ifindex))
+		return 0;
+
+	/* Left behind by a device which went away */
+	trelay_pin_path(path, name, NULL);
+	if (!access(path, F_OK))
+		trelay_remove(name);
+
+	mkdir(TRELAY_PIN_DIR, 0700);
+	if (mkdir(path, 0700)) {
+		err = -errno;
+		fprintf(stderr, "Failed to create %s: %s\n", path, strerror(errno));
+		return err;
+	}
+
+	obj = bpf_object__open_file(TRELAY_BPF_PROG, NULL);
+	err = libbpf_get_error(obj);
+	if (err) {
+		fprintf(stderr, "Failed to open %s: %d\n", TRELAY_BPF_PROG, err);
+		goto out_unpin;
+	}
+
+	err = bpf_object__load(obj);
+	if (err) {
+		fprintf(stderr, "Failed to load %s: %d\n", TRELAY_BPF_PROG, err);
+		goto out_close;
+	}
+
+	prog = bpf_object__find_program_by_name(obj, "trelay_xdp");
+	prog_fd = prog ? bpf_program__fd(prog) : -1;
+	peer_fd = bpf_object__find_map_fd_by_name(obj, "peer");
+	stats_fd = bpf_object__find_map_fd_by_name(obj, "stats");
+	if (prog_fd < 0 || peer_fd < 0 || stats_fd < 0) {
+		fprintf(stderr, "Invalid %s\n", TRELAY_BPF_PROG);
+		err = -EINVAL;
+		goto out_close;
+	}
+
+	for (i = 0; i < 2; i++) {
+		err = bpf_map_update_elem(peer_fd, &ifindex[i], &ifindex[!i], BPF_ANY);
+		if (err) {
+			fprintf(stderr, "Failed to set up the peer map: %d\n", err);
+			goto out_close;
+		}
+	}
+
+	trelay_pin_path(path, name, "prog");
+	err = bpf_obj_pin(prog_fd, path);
+	trelay_pin_path(path, name, "peer");
+	err = err ? err : bpf_obj_pin(peer_fd, path);
+	trelay_pin_path(path, name, "stats");
+	err = err ? err : bpf_obj_pin(stats_fd, path);
+	if (err) {
+		fprintf(stderr, "Failed to pin below %s: %d\n", TRELAY_PIN_DIR, err);
+		goto out_close;
+	}
+
+	err = trelay_attach(ifindex, prog_fd, generic);
+	if (err) {
+		fprintf(stderr, "Failed to attach to %s and %s: %d\n", dev1, dev2, err);
+		goto out_close;
+	}
+
+	/* The devices and the pins keep the program and the maps around */
+	bpf_object__close(obj);
+	return 0;
+
+out_close:
+	bpf_object__close(obj);
+out_unpin:
+	trelay_unpin(name);
+	return err;
+}
+
+static int trelay_stats(const char *name)
+{
+	struct trelay_stats sum = {}, *vals;
+	__u32 key = 0;
+	int fd, ncpus, i;
+
+	fd = trelay_pin_get(name, "stats");
+	if (fd < 0) {
+		fprintf(stderr, "Relay %s not found\n", name);
+		return -ENOENT;
+	}
+
+	ncpus = libbpf_num_possible_cpus();
+	vals = ncpus > 0 ? calloc(ncpus, sizeof(*vals)) : NULL;
+	if (!vals || bpf_map_lookup_elem(fd, &key, vals)) {
+		fprintf(stderr, "Failed to read the counters of %s\n", name);
+		free(vals);
+		close(fd);
+		return -EIO;
+	}
+
+	for (i = 0; i < ncpus; i++) {
+		sum.rx_packets += vals[i].rx_packets;
+		sum.rx_bytes += vals[i].rx_bytes;
+		sum.tx_packets += vals[i].tx_packets;
+		sum.tx_bytes += vals[i].tx_bytes;
+		sum.tx_dropped += vals[i].tx_dropped;
+	}
+
+	printf("rx_packets: %llu\n", (unsigned long long)sum.rx_packets);
+	printf("rx_bytes: %llu\n", (unsigned long long)sum.rx_bytes);
+	printf("tx_packets: %llu\n", (unsigned long long)sum.tx_packets);
+	printf("tx_bytes: %llu\n", (unsigned long long)sum.tx_bytes);
+	printf("tx_dropped: %llu\n", (unsigned long long)sum.tx_dropped);
+
+	free(vals);
+	close(fd);
+
+	return 0;
+}
+
+static int usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s <command> [<arguments>]\n"
+		"Commands:\n"
+		"	add [-g] <name> <dev1> <dev2>	relay between dev1 and dev2,\n"
+		"					-g forces generic XDP\n"
+		"	remove <name>			stop a relay\n"
+		"	stats <name>			show the counters of a relay\n",
+		progname);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *progname = argv[0];
+	bool generic = false;
+	int ret;
+
+	if (argc < 3)
+		return usage(progname);
+
+	if (!strcmp(argv[1], "add")) {
+		if (!strcmp(argv[2], "-g")) {
+			generic = true;
+			argc--;
+			argv++;
+		}
+		if (argc != 5)
+			return usage(progname);
+		ret = trelay_add(argv[2], argv[3], argv[4], generic);
+	} else if (!strcmp(argv[1], "remove") && argc == 3) {
+		ret = trelay_remove(argv[2]);
+	} else if (!strcmp(argv[1], "stats") && argc == 3) {
+		ret = trelay_stats(argv[2]);
+	} else {
+		return usage(progname);
+	}
+
+	return ret ? 1 : 0;
+}
@@ -46,10 +46,9 @@
 #include <mtd/mtd-user.h>
 #include "crc32.h"
 #include "fis.h"
+#include "md5.h"
 #include "mtd.h"
 
-#include <libubox/md5.h>
-
 #define MAX_ARGS 8
 #define JFFS2_DEFAULT_DIR	"" /* directory name without /, empty means root dir */
 
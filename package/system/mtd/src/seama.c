@@ -36,9 +36,9 @@
 
 #include <sys/ioctl.h>
 #include <mtd/mtd-user.h>
+#include "md5.h"
 #include "mtd.h"
 #include "seama.h"
-#include "md5.h"
 
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define STORE32_LE(X)           ((((X) & 0x000000FF) << 24) | (((X) & 0x0000FF00) << 8) | (((X) & 0x00FF0000) >> 8) | (((X) & 0xFF000000) >> 24))
@@ -56,7 +56,7 @@ seama_fix_md5(struct seama_entity_header *shdr, int fd, size_t data_offset, size
 {
 	char *buf;
 	ssize_t res;
-	MD5_CTX ctx;
+	md5_ctx_t ctx;
 	unsigned char digest[16];
 	int i;
 	int err = 0;
@@ -74,9 +74,9 @@ seama_fix_md5(struct seama_entity_header *shdr, int fd, size_t data_offset, size
 		goto err_free;
 	}
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, buf, data_size);
-	MD5_Final(digest, &ctx);
+	md5_begin(&ctx);
+	md5_hash(buf, data_size, &ctx);
+	md5_end(digest, &ctx);
 
 	if (!memcmp(digest, shdr->md5, sizeof(digest))) {
 		if (quiet < 2)
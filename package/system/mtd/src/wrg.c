@@ -37,8 +37,8 @@
 
 #include <sys/ioctl.h>
 #include <mtd/mtd-user.h>
-#include "mtd.h"
 #include "md5.h"
+#include "mtd.h"
 
 #if !defined(__BYTE_ORDER)
 #error "Unknown byte order"
@@ -74,7 +74,7 @@ wrg_fix_md5(struct wrg_header *shdr, int fd, size_t data_offset, size_t data_siz
 {
 	char *buf;
 	ssize_t res;
-	MD5_CTX ctx;
+	md5_ctx_t ctx;
 	unsigned char digest[16];
 	int i;
 	int err = 0;
@@ -92,11 +92,11 @@ wrg_fix_md5(struct wrg_header *shdr, int fd, size_t data_offset, size_t data_siz
 		goto err_free;
 	}
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, (char *)&shdr->offset, sizeof(shdr->offset));
-	MD5_Update(&ctx, (char *)&shdr->devname, sizeof(shdr->devname));
-	MD5_Update(&ctx, buf, data_size);
-	MD5_Final(digest, &ctx);
+	md5_begin(&ctx);
+	md5_hash((char *)&shdr->offset, sizeof(shdr->offset), &ctx);
+	md5_hash((char *)&shdr->devname, sizeof(shdr->devname), &ctx);
+	md5_hash(buf, data_size, &ctx);
+	md5_end(digest, &ctx);
 
 	if (!memcmp(digest, shdr->digest, sizeof(digest))) {
 		if (quiet < 2)
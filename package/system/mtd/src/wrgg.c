@@ -35,9 +35,9 @@
 
 #include <sys/ioctl.h>
 #include <mtd/mtd-user.h>
+#include "md5.h"
 #include "mtd.h"
 #include "wrgg.h"
-#include "md5.h"
 
 static inline uint32_t le32_to_cpu(uint8_t *buf)
 {
@@ -52,7 +52,7 @@ wrgg_fix_md5(struct wrgg03_header *shdr, int fd, size_t data_offset, size_t data
 {
 	char *buf;
 	ssize_t res;
-	MD5_CTX ctx;
+	md5_ctx_t ctx;
 	unsigned char digest[16];
 	int i;
 	int err = 0;
@@ -70,11 +70,11 @@ wrgg_fix_md5(struct wrgg03_header *shdr, int fd, size_t data_offset, size_t data
 		goto err_free;
 	}
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, (char *)&shdr->offset, sizeof(shdr->offset));
-	MD5_Update(&ctx, (char *)&shdr->dev_name, sizeof(shdr->dev_name));
-	MD5_Update(&ctx, buf, data_size);
-	MD5_Final(digest, &ctx);
+	md5_begin(&ctx);
+	md5_hash((char *)&shdr->offset, sizeof(shdr->offset), &ctx);
+	md5_hash((char *)&shdr->dev_name, sizeof(shdr->dev_name), &ctx);
+	md5_hash(buf, data_size, &ctx);
+	md5_end(digest, &ctx);
 
 	if (!memcmp(digest, shdr->digest, sizeof(digest))) {
 		if (quiet < 2)
@@ -6,15 +6,21 @@
 #include <byteswap.h>
 #include <endian.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include "crc32.h"
+
 #if !defined(__BYTE_ORDER)
 #error "Unknown byte order"
 #endif
@@ -95,89 +101,6 @@ static inline size_t bcm4908img_min(size_t x, size_t y) {
 	return x < y ? x : y;
 }
 
-/**************************************************
- * CRC32
- **************************************************/
-
-static const uint32_t crc32_tbl[] = {
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba,
-	0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
-	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
-	0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
-	0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,
-	0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
-	0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
-	0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940,
-	0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116,
-	0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
-	0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
-	0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a,
-	0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818,
-	0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
-	0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
-	0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c,
-	0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
-	0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
-	0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
-	0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086,
-	0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4,
-	0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
-	0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
-	0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
-	0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe,
-	0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
-	0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
-	0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252,
-	0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60,
-	0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
-	0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
-	0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04,
-	0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a,
-	0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
-	0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
-	0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e,
-	0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
-	0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
-	0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
-	0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0,
-	0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6,
-	0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
-	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
-};
-
-uint32_t bcm4908img_crc32(uint32_t crc, const void *buf, size_t len) {
-	const uint8_t *in = buf;
-
-	while (len) {
-		crc = crc32_tbl[(crc ^ *in) & 0xff] ^ (crc >> 8);
-		in++;
-		len--;
-	}
-
-	return crc;
-}
-
 /**************************************************
  * Helpers
  **************************************************/
@@ -211,8 +134,73 @@ static void bcm4908img_close(FILE *fp) {
 		fclose(fp);
 }
 
+/*
+ * Copy @length bytes from @in_fd (starting at @in_offset) to the current
+ * position of @out_fd. copy_file_range() lets the kernel move the data (or
+ * just share extents) without bouncing it through userspace. Fall back to
+ * pread() / write() if it's unavailable, e.g. for pipes or cross-filesystem
+ * copies on older kernels.
+ */
+static ssize_t bcm4908img_copy_fd(int in_fd, off_t in_offset, int out_fd, size_t length) {
+	int64_t offset = in_offset;
+	uint8_t buf[65536];
+	size_t left = length;
+	ssize_t bytes = 0;
+	ssize_t done;
+	ssize_t ret;
+
+#ifdef __NR_copy_file_range
+	while (left) {
+		bytes = syscall(__NR_copy_file_range, in_fd, &offset, out_fd, NULL, left, 0);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes <= 0)
+			break;
+		left -= bytes;
+	}
+	if (bytes == 0)
+		return length - left;
+#endif
+
+	while (left) {
+		bytes = pread(in_fd, buf, bcm4908img_min(sizeof(buf), left), offset);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes < 0)
+			return -errno;
+		if (!bytes)
+			break;
+		offset += bytes;
+		left -= bytes;
+
+		for (done = 0; done < bytes; done += ret) {
+			ret = write(out_fd, buf + done, bytes - done);
+			if (ret < 0 && errno == EINTR)
+				ret = 0;
+			else if (ret < 0)
+				return -errno;
+		}
+	}
+
+	return length - left;
+}
+
+struct bcm4908img_crc32_job {
+	const void *buf;
+	size_t length;
+	uint32_t crc32;
+};
+
+static void *bcm4908img_crc32_thread(void *data) {
+	struct bcm4908img_crc32_job *job = data;
+
+	job->crc32 = crc32(job->crc32, job->buf, job->length);
+
+	return NULL;
+}
+
 static int bcm4908img_calc_crc32(FILE *fp, struct bcm4908img_info *info) {
-	uint8_t buf[1024];
+	uint8_t buf[65536];
 	size_t length;
 	size_t bytes;
 
@@ -222,7 +210,7 @@ static int bcm4908img_calc_crc32(FILE *fp, struct bcm4908img_info *info) {
 	info->crc32 = 0xffffffff;
 	length = info->tail_offset - info->cferom_offset;
 	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
+		info->crc32 = crc32(info->crc32, buf, bytes);
 		length -= bytes;
 	}
 	if (length) {
@@ -378,7 +366,7 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	info->crc32 = 0xffffffff;
 	length = info->tail_offset - info->cferom_offset;
 	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
+		info->crc32 = crc32(info->crc32, buf, bytes);
 		length -= bytes;
 	}
 	if (length) {
@@ -453,29 +441,70 @@ out:
  * Create
  **************************************************/
 
-static ssize_t bcm4908img_create_append_file(FILE *trx, const char *in_path, uint32_t *crc32) {
-	FILE *in;
-	size_t bytes;
+static ssize_t bcm4908img_create_append_stream(FILE *trx, int fd, uint32_t *crc) {
+	uint8_t buf[65536];
 	ssize_t length = 0;
-	uint8_t buf[1024];
+	ssize_t bytes;
+
+	while ((bytes = read(fd, buf, sizeof(buf))) > 0) {
+		if (fwrite(buf, 1, bytes, trx) != (size_t)bytes) {
+			fprintf(stderr, "Failed to write %zd B to %s\n", bytes, pathname);
+			return -EIO;
+		}
+		*crc = crc32(*crc, buf, bytes);
+		length += bytes;
+	}
+
+	return length;
+}
+
+static ssize_t bcm4908img_create_append_file(FILE *trx, const char *in_path, uint32_t *crc) {
+	struct bcm4908img_crc32_job job = { .crc32 = *crc };
+	pthread_t thread;
+	bool threaded;
+	struct stat st;
+	ssize_t length;
+	void *map;
+	int fd;
 
-	in = fopen(in_path, "r");
-	if (!in) {
+	fd = open(in_path, O_RDONLY);
+	if (fd < 0) {
 		fprintf(stderr, "Failed to open %s\n", in_path);
 		return -EACCES;
 	}
 
-	while ((bytes = fread(buf, 1, sizeof(buf), in)) > 0) {
-		if (fwrite(buf, 1, bytes, trx) != bytes) {
-			fprintf(stderr, "Failed to write %zu B to %s\n", bytes, pathname);
-			length = -EIO;
-			break;
-		}
-		*crc32 = bcm4908img_crc32(*crc32, buf, bytes);
-		length += bytes;
+	map = MAP_FAILED;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		length = bcm4908img_create_append_stream(trx, fd, crc);
+		close(fd);
+		return length;
+	}
+
+	/* Checksum the mapped input while the kernel copies it */
+	job.buf = map;
+	job.length = st.st_size;
+	threaded = !pthread_create(&thread, NULL, bcm4908img_crc32_thread, &job);
+
+	fflush(trx);
+	length = bcm4908img_copy_fd(fd, 0, fileno(trx), st.st_size);
+	fseek(trx, lseek(fileno(trx), 0, SEEK_CUR), SEEK_SET);
+
+	if (threaded)
+		pthread_join(thread, NULL);
+	else
+		bcm4908img_crc32_thread(&job);
+
+	if (length != st.st_size) {
+		fprintf(stderr, "Failed to write %zu B to %s\n", (size_t)st.st_size, pathname);
+		length = -EIO;
+	} else {
+		*crc = job.crc32;
 	}
 
-	fclose(in);
+	munmap(map, st.st_size);
+	close(fd);
 
 	return length;
 }
@@ -515,7 +544,7 @@ static int bcm4908img_create(int argc, char **argv) {
 		.flash_type = cpu_to_le32(WFI_NAND128_FLASH),
 		.flags = cpu_to_le32(WFI_FLAG_SUPPORTS_BTRM),
 	};
-	uint32_t crc32 = 0xffffffff;
+	uint32_t crc = 0xffffffff;
 	size_t cur_offset = 0;
 	ssize_t bytes;
 	FILE *fp;
@@ -540,7 +569,7 @@ static int bcm4908img_create(int argc, char **argv) {
 	while ((c = getopt(argc, argv, "f:a:A:")) != -1) {
 		switch (c) {
 		case 'f':
-			bytes = bcm4908img_create_append_file(fp, optarg, &crc32);
+			bytes = bcm4908img_create_append_file(fp, optarg, &crc);
 			if (bytes < 0) {
 				fprintf(stderr, "Failed to append file %s\n", optarg);
 			} else {
@@ -571,7 +600,7 @@ static int bcm4908img_create(int argc, char **argv) {
 			goto err_close;
 	}
 
-	tail.crc32 = cpu_to_le32(crc32);
+	tail.crc32 = cpu_to_le32(crc);
 
 	bytes = fwrite(&tail, 1, sizeof(tail), fp);
 	if (bytes != sizeof(tail)) {
@@ -593,10 +622,9 @@ static int bcm4908img_extract(int argc, char **argv) {
 	struct bcm4908img_info info;
 	const char *pathname = NULL;
 	const char *type = NULL;
-	uint8_t buf[1024];
 	size_t offset;
 	size_t length;
-	size_t bytes;
+	ssize_t bytes;
 	FILE *fp;
 	int c;
 	int err = 0;
@@ -658,14 +686,11 @@ static int bcm4908img_extract(int argc, char **argv) {
 		goto err_close;
 	}
 
-	fseek(fp, offset, SEEK_SET);
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		fwrite(buf, bytes, 1, stdout);
-		length -= bytes;
-	}
-	if (length) {
+	fflush(stdout);
+	bytes = bcm4908img_copy_fd(fileno(fp), offset, fileno(stdout), length);
+	if (bytes < 0 || (size_t)bytes != length) {
 		err = -EIO;
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
+		fprintf(stderr, "Failed to read last %zd B of data\n", bytes < 0 ? length : length - bytes);
 		goto err_close;
 	}
 
@@ -821,7 +846,7 @@ static int bcm4908img_bootfs_mv(FILE *fp, struct bcm4908img_info *info, int argc
 
 	for (offset = info->bootfs_offset; ; offset += (je32_to_cpu(node.totlen) + 0x03) & ~0x03) {
 		char name[FILENAME_MAX];
-		uint32_t crc32;
+		uint32_t name_crc;
 
 		if (fseek(fp, offset, SEEK_SET)) {
 			err = -errno;
@@ -874,9 +899,9 @@ static int bcm4908img_bootfs_mv(FILE *fp, struct bcm4908img_info *info, int argc
 			fprintf(stderr, "Failed to fseek: %d\n", err);
 			return err;
 		}
-		crc32 = bcm4908img_crc32(0, newname, dirent.nsize);
-		bytes = fwrite(&crc32, 1, sizeof(crc32), fp);
-		if (bytes != sizeof(crc32)) {
+		name_crc = crc32(0, newname, dirent.nsize);
+		bytes = fwrite(&name_crc, 1, sizeof(name_crc), fp);
+		if (bytes != sizeof(name_crc)) {
 			fprintf(stderr, "Failed to write new CRC32\n");
 			return -EIO;
 		}
@@ -64,7 +64,10 @@
 
 static char *progname;
 static char *mtddev;
-static char *name_filter = NULL;
+#define MAX_NAME_FILTERS	16
+
+static char *name_filter[MAX_NAME_FILTERS];
+static int num_name_filters;
 static bool show_all = false;
 static bool print_all_key_names = false;
 static bool read_oob_sector_health = false;
@@ -168,103 +171,208 @@ static void print_entry_value(const struct tffs_entry *entry)
 	fwrite(entry->val, 1, entry->len, stdout);
 }
 
-static int find_entry(uint32_t id, struct tffs_entry *entry)
+/*
+ * Latest revision of every entry found on the device. All sectors are read
+ * once while building it, instead of scanning the whole partition again for
+ * every key that is looked up.
+ */
+struct tffs_index_entry {
+	uint32_t id;
+	uint32_t rev;
+	uint32_t num_segments;
+	struct tffs_entry_segment *segments;
+};
+
+static struct tffs_index_entry *tffs_index;
+static uint32_t tffs_index_size;
+
+static struct tffs_index_entry *index_lookup(uint32_t id)
 {
-	uint32_t rev = 0;
-	uint32_t num_segments = 0;
-	struct tffs_entry_segment *segments = NULL;
+	for (uint32_t i = 0; i < tffs_index_size; i++) {
+		if (tffs_index[i].id == id) {
+			return &tffs_index[i];
+		}
+	}
 
-	off_t pos = 0;
+	return NULL;
+}
+
+static void index_clear_segments(struct tffs_index_entry *ie)
+{
+	for (uint32_t i = 0; i < ie->num_segments; i++) {
+		free(ie->segments[i].val);
+	}
+	free(ie->segments);
+	ie->num_segments = 0;
+	ie->segments = NULL;
+}
+
+static void index_add_sector(const uint8_t *buf)
+{
+	struct tffs_index_entry *ie;
+	uint32_t id = read_uint32((void *)buf, 0x00);
+	uint32_t len = read_uint32((void *)buf, 0x04);
+	uint32_t rev = read_uint32((void *)buf, 0x0c);
+	uint32_t seg = read_uint32((void *)buf, 0x10);
+	uint32_t next_seg = read_uint32((void *)buf, 0x14);
+
+	ie = index_lookup(id);
+	if (!ie) {
+		tffs_index = realloc(tffs_index, (tffs_index_size + 1) * sizeof(*tffs_index));
+		if (tffs_index == NULL) {
+			fprintf(stderr, "ERROR: memory allocation failed!\n");
+			exit(EXIT_FAILURE);
+		}
+		ie = &tffs_index[tffs_index_size++];
+		memset(ie, 0, sizeof(*ie));
+		ie->id = id;
+	}
+
+	if (rev < ie->rev) {
+		/* obsolete revision => ignore this */
+		return;
+	}
+	if (rev > ie->rev) {
+		/* newer revision => clear old data */
+		index_clear_segments(ie);
+		ie->rev = rev;
+	}
+
+	if (seg == TFFS_SEGMENT_CLEARED) {
+		return;
+	}
+
+	uint32_t new_num_segs = next_seg == 0 ? seg + 1 : next_seg + 1;
+	if (new_num_segs > ie->num_segments) {
+		ie->segments = realloc(ie->segments, new_num_segs * sizeof(struct tffs_entry_segment));
+		if (ie->segments == NULL) {
+			fprintf(stderr, "ERROR: memory allocation failed!\n");
+			exit(EXIT_FAILURE);
+		}
+		memset(ie->segments + ie->num_segments, 0x0,
+				(new_num_segs - ie->num_segments) * sizeof(struct tffs_entry_segment));
+		ie->num_segments = new_num_segs;
+	}
+	if (seg >= ie->num_segments) {
+		return;
+	}
+	free(ie->segments[seg].val);
+	ie->segments[seg].len = len;
+	ie->segments[seg].val = malloc(len);
+	if (ie->segments[seg].val == NULL) {
+		fprintf(stderr, "ERROR: memory allocation failed!\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(ie->segments[seg].val, buf + TFFS_ENTRY_HEADER_SIZE, len);
+}
+
+static void build_index(void)
+{
+	uint8_t *blockbuf;
+	bool block_read = false;
 	uint8_t block_end = 0;
+	off_t pos = 0;
+
+	/* Read whole eraseblocks, fall back to single sectors on errors */
+	blockbuf = malloc(blocksize);
+	if (blockbuf == NULL) {
+		fprintf(stderr, "ERROR: memory allocation failed!\n");
+		exit(EXIT_FAILURE);
+	}
+
 	for (uint32_t sector = 0; sector < sectors->num_sectors; sector++, pos += TFFS_SECTOR_SIZE) {
+		const uint8_t *buf;
+
+		if (pos % blocksize == 0) {
+			block_read = pread(mtdfd, blockbuf, blocksize, pos) == blocksize;
+		}
+
 		if (block_end) {
 			if (pos % blocksize == 0) {
 				block_end = 0;
 			}
-		} else if (sector_get_good(sector)) {
-			if (read_sectoroob(pos) || read_sector(pos)) {
+		}
+		if (block_end || !sector_get_good(sector)) {
+			continue;
+		}
+
+		if (block_read) {
+			buf = blockbuf + (pos % blocksize);
+		} else if (read_sector(pos)) {
+			fprintf(stderr, "ERROR: sector isn't readable, but has been previously!\n");
+			exit(EXIT_FAILURE);
+		} else {
+			buf = readbuf;
+		}
+
+		uint32_t read_id = read_uint32((void *)buf, 0x00);
+		uint32_t read_len = read_uint32((void *)buf, 0x04);
+
+		if (read_oob_sector_health) {
+			if (read_sectoroob(pos)) {
 				fprintf(stderr, "ERROR: sector isn't readable, but has been previously!\n");
 				exit(EXIT_FAILURE);
 			}
 			uint32_t oob_id = read_uint32(oobbuf, 0x02);
 			uint32_t oob_len = read_uint32(oobbuf, 0x06);
 			uint32_t oob_rev = read_uint32(oobbuf, 0x0a);
-			uint32_t read_id = read_uint32(readbuf, 0x00);
-			uint32_t read_len = read_uint32(readbuf, 0x04);
-			uint32_t read_rev = read_uint32(readbuf, 0x0c);
-			if (read_oob_sector_health && (oob_id != read_id || oob_len != read_len || oob_rev != read_rev)) {
+			uint32_t read_rev = read_uint32((void *)buf, 0x0c);
+			if (oob_id != read_id || oob_len != read_len || oob_rev != read_rev) {
 				fprintf(stderr, "Warning: sector has inconsistent metadata\n");
 				continue;
 			}
-			if (read_id == TFFS_ID_END) {
-				/* no more entries in this block */
-				block_end = 1;
-				continue;
-			}
-			if (read_len > TFFS_MAXIMUM_SEGMENT_SIZE) {
-				fprintf(stderr, "Warning: segment is longer than possible\n");
-				continue;
-			}
-			if (read_id == id) {
-				if (read_rev < rev) {
-					/* obsolete revision => ignore this */
-					continue;
-				}
-				if (read_rev > rev) {
-					/* newer revision => clear old data */
-					for (uint32_t i = 0; i < num_segments; i++) {
-						free(segments[i].val);
-					}
-					free (segments);
-					rev = read_rev;
-					num_segments = 0;
-					segments = NULL;
-				}
-
-				uint32_t seg = read_uint32(readbuf, 0x10);
-
-				if (seg == TFFS_SEGMENT_CLEARED) {
-					continue;
-				}
-
-				uint32_t next_seg = read_uint32(readbuf, 0x14);
-
-				uint32_t new_num_segs = next_seg == 0 ? seg + 1 : next_seg + 1;
-				if (new_num_segs > num_segments) {
-					segments = realloc(segments, new_num_segs * sizeof(struct tffs_entry_segment));
-					memset(segments + (num_segments * sizeof(struct tffs_entry_segment)), 0x0,
-							(new_num_segs - num_segments) * sizeof(struct tffs_entry_segment));
-					num_segments = new_num_segs;
-				}
-				segments[seg].len = read_len;
-				segments[seg].val = malloc(read_len);
-				memcpy(segments[seg].val, readbuf + TFFS_ENTRY_HEADER_SIZE, read_len);
-			}
 		}
+		if (read_id == TFFS_ID_END) {
+			/* no more entries in this block */
+			block_end = 1;
+			continue;
+		}
+		if (read_len > TFFS_MAXIMUM_SEGMENT_SIZE) {
+			fprintf(stderr, "Warning: segment is longer than possible\n");
+			continue;
+		}
+
+		index_add_sector(buf);
 	}
 
-	if (num_segments == 0) {
-		return 0;
+	free(blockbuf);
+}
+
+static void free_index(void)
+{
+	for (uint32_t i = 0; i < tffs_index_size; i++) {
+		index_clear_segments(&tffs_index[i]);
 	}
+	free(tffs_index);
+	tffs_index = NULL;
+	tffs_index_size = 0;
+}
 
-	assert (segments != NULL);
+static int find_entry(uint32_t id, struct tffs_entry *entry)
+{
+	struct tffs_index_entry *ie;
+
+	ie = index_lookup(id);
+	if (ie == NULL || ie->num_segments == 0) {
+		return 0;
+	}
 
 	uint32_t len = 0;
-	for (uint32_t i = 0; i < num_segments; i++) {
-		if (segments[i].val == NULL) {
+	for (uint32_t i = 0; i < ie->num_segments; i++) {
+		if (ie->segments[i].val == NULL) {
 			/* missing segment */
 			return 0;
 		}
 
-		len += segments[i].len;
+		len += ie->segments[i].len;
 	}
 
 	void *p = malloc(len);
 	entry->val = p;
 	entry->len = len;
-	for (uint32_t i = 0; i < num_segments; i++) {
-		memcpy(p, segments[i].val, segments[i].len);
-		p += segments[i].len;
+	for (uint32_t i = 0; i < ie->num_segments; i++) {
+		memcpy(p, ie->segments[i].val, ie->segments[i].len);
+		p += ie->segments[i].len;
 	}
 
 	return 1;
@@ -332,7 +440,8 @@ static int show_all_key_value_pairs(struct tffs_key_name_table *key_names)
 	return EXIT_SUCCESS;
 }
 
-static int show_matching_key_value(struct tffs_key_name_table *key_names)
+static int show_key_value(struct tffs_key_name_table *key_names,
+			  const char *filter)
 {
 	struct tffs_entry tmp;
 	const char *name;
@@ -340,7 +449,7 @@ static int show_matching_key_value(struct tffs_key_name_table *key_names)
 	for (uint32_t i = 0; i < key_names->size; i++) {
 		name = key_names->entries[i].val;
 
-		if (strcmp(name, name_filter) == 0) {
+		if (strcmp(name, filter) == 0) {
 			if (find_entry(key_names->entries[i].id, &tmp)) {
 				print_entry_value(&tmp);
 				printf("\n");
@@ -355,10 +464,23 @@ static int show_matching_key_value(struct tffs_key_name_table *key_names)
 		}
 	}
 
-	fprintf(stderr, "ERROR: Unknown key name %s!\n", name_filter);
+	fprintf(stderr, "ERROR: Unknown key name %s!\n", filter);
 	return EXIT_FAILURE;
 }
 
+static int show_matching_key_values(struct tffs_key_name_table *key_names)
+{
+	int ret = EXIT_SUCCESS;
+
+	/* One value per line, in the order the names were given */
+	for (int i = 0; i < num_name_filters; i++) {
+		if (show_key_value(key_names, name_filter[i]) != EXIT_SUCCESS)
+			ret = EXIT_FAILURE;
+	}
+
+	return ret;
+}
+
 static int check_sector(off_t pos)
 {
 	if (!read_oob_sector_health) {
@@ -453,7 +575,7 @@ static void usage(int status)
 	"  -d <mtd>        inspect the TFFS on mtd device <mtd>\n"
 	"  -h              show this screen\n"
 	"  -l              list all supported keys\n"
-	"  -n <key name>   display the value of the given key\n"
+	"  -n <key name>   display the value of the given key, can be repeated\n"
 	"  -o              read OOB information about sector health\n"
 	);
 
@@ -472,7 +594,7 @@ static void parse_options(int argc, char *argv[])
 		switch (c) {
 		case 'a':
 			show_all = true;
-			name_filter = NULL;
+			num_name_filters = 0;
 			print_all_key_names = false;
 			break;
 		case 'b':
@@ -487,10 +609,14 @@ static void parse_options(int argc, char *argv[])
 		case 'l':
 			print_all_key_names = true;
 			show_all = false;
-			name_filter = NULL;
+			num_name_filters = 0;
 			break;
 		case 'n':
-			name_filter = optarg;
+			if (num_name_filters == MAX_NAME_FILTERS) {
+				fprintf(stderr, "ERROR: too many key names given!\n");
+				usage(EXIT_FAILURE);
+			}
+			name_filter[num_name_filters++] = optarg;
 			show_all = false;
 			print_all_key_names = false;
 			break;
@@ -508,7 +634,7 @@ static void parse_options(int argc, char *argv[])
 		usage(EXIT_FAILURE);
 	}
 
-	if (!show_all && !name_filter && !print_all_key_names) {
+	if (!show_all && !num_name_filters && !print_all_key_names) {
 		fprintf(stderr,
 			"ERROR: either -l, -a or -n <key name> is required!\n");
 		usage(EXIT_FAILURE);
@@ -538,6 +664,8 @@ int main(int argc, char *argv[])
 		goto out_close;
 	}
 
+	build_index();
+
 	if (!find_entry(TFFS_ID_TABLE_NAME, &name_table)) {
 		fprintf(stderr, "ERROR: No name table found on tffs device %s\n",
 			mtddev);
@@ -557,13 +685,14 @@ int main(int argc, char *argv[])
 	} else if (show_all) {
 		ret = show_all_key_value_pairs(&key_names);
 	} else {
-		ret = show_matching_key_value(&key_names);
+		ret = show_matching_key_values(&key_names);
 	}
 
 	free(key_names.entries);
 out_free_entry:
 	free(name_table.val);
 out_free_sectors:
+	free_index();
 	free(sectors);
 out_close:
 	close(mtdfd);
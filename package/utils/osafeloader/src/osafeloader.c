@@ -64,7 +64,7 @@ static const uint8_t md5_salt[16] = {
 static int osafeloader_info(int argc, char **argv) {
 	FILE *safeloader;
 	struct safeloader_header hdr;
-	MD5_CTX ctx;
+	md5_ctx_t ctx;
 	size_t bytes, imagesize;
 	uint8_t buf[1024];
 	uint8_t md5[16];
@@ -94,13 +94,13 @@ static int osafeloader_info(int argc, char **argv) {
 	}
 	imagesize = be32_to_cpu(hdr.imagesize);
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, md5_salt, sizeof(md5_salt));
+	md5_begin(&ctx);
+	md5_hash(md5_salt, sizeof(md5_salt), &ctx);
 	while ((bytes = fread(buf, 1, osafeloader_min(sizeof(buf), imagesize), safeloader)) > 0) {
-		MD5_Update(&ctx, buf, bytes);
+		md5_hash(buf, bytes, &ctx);
 		imagesize -= bytes;
 	}
-	MD5_Final(md5, &ctx);
+	md5_end(md5, &ctx);
 
 	if (memcmp(md5, hdr.md5, 16)) {
 		fprintf(stderr, "Broken SafeLoader file with invalid MD5\n");
@@ -12,10 +12,15 @@
 #include <byteswap.h>
 #include <endian.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include "md5.h"
@@ -63,6 +68,55 @@ static inline size_t oseama_min(size_t x, size_t y) {
 	return x < y ? x : y;
 }
 
+/*
+ * Copy @length bytes from @in_fd (starting at @in_offset) to the current
+ * position of @out_fd. Let the kernel do it with copy_file_range() and fall
+ * back to pread() / write() where that isn't supported.
+ */
+static ssize_t oseama_copy_fd(int in_fd, off_t in_offset, int out_fd, size_t length) {
+	int64_t offset = in_offset;
+	uint8_t buf[65536];
+	size_t left = length;
+	ssize_t bytes = 0;
+	ssize_t done;
+	ssize_t ret;
+
+#ifdef __NR_copy_file_range
+	while (left) {
+		bytes = syscall(__NR_copy_file_range, in_fd, &offset, out_fd, NULL, left, 0);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes <= 0)
+			break;
+		left -= bytes;
+	}
+	if (bytes == 0)
+		return length - left;
+#endif
+
+	while (left) {
+		bytes = pread(in_fd, buf, oseama_min(sizeof(buf), left), offset);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes < 0)
+			return -errno;
+		if (!bytes)
+			break;
+		offset += bytes;
+		left -= bytes;
+
+		for (done = 0; done < bytes; done += ret) {
+			ret = write(out_fd, buf + done, bytes - done);
+			if (ret < 0 && errno == EINTR)
+				ret = 0;
+			else if (ret < 0)
+				return -errno;
+		}
+	}
+
+	return length - left;
+}
+
 /**************************************************
  * Info
  **************************************************/
@@ -221,33 +275,87 @@ out:
  * Create
  **************************************************/
 
-static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path) {
-	FILE *in;
-	size_t bytes;
+struct oseama_md5_job {
+	const void *buf;
+	size_t length;
+	md5_ctx_t *ctx;
+};
+
+static void *oseama_md5_thread(void *data) {
+	struct oseama_md5_job *job = data;
+
+	md5_hash(job->buf, job->length, job->ctx);
+
+	return NULL;
+}
+
+static ssize_t oseama_entity_append_stream(FILE *seama, int fd, md5_ctx_t *ctx) {
+	uint8_t buf[65536];
 	ssize_t length = 0;
-	uint8_t buf[128];
+	ssize_t bytes;
 
-	in = fopen(in_path, "r");
-	if (!in) {
+	while ((bytes = read(fd, buf, sizeof(buf))) > 0) {
+		if (fwrite(buf, 1, bytes, seama) != (size_t)bytes) {
+			fprintf(stderr, "Couldn't write %zd B to %s\n", bytes, seama_path);
+			return -EIO;
+		}
+		md5_hash(buf, bytes, ctx);
+		length += bytes;
+	}
+
+	return length;
+}
+
+static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path, md5_ctx_t *ctx) {
+	struct oseama_md5_job job = { .ctx = ctx };
+	pthread_t thread;
+	int threaded;
+	struct stat st;
+	ssize_t length;
+	void *map;
+	int fd;
+
+	fd = open(in_path, O_RDONLY);
+	if (fd < 0) {
 		fprintf(stderr, "Couldn't open %s\n", in_path);
 		return -EACCES;
 	}
 
-	while ((bytes = fread(buf, 1, sizeof(buf), in)) > 0) {
-		if (fwrite(buf, 1, bytes, seama) != bytes) {
-			fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, seama_path);
-			length = -EIO;
-			break;
-		}
-		length += bytes;
+	map = MAP_FAILED;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		length = oseama_entity_append_stream(seama, fd, ctx);
+		close(fd);
+		return length;
 	}
 
-	fclose(in);
+	/* Hash the mapped input while the kernel copies it */
+	job.buf = map;
+	job.length = st.st_size;
+	threaded = !pthread_create(&thread, NULL, oseama_md5_thread, &job);
+
+	fflush(seama);
+	length = oseama_copy_fd(fd, 0, fileno(seama), st.st_size);
+	fseek(seama, lseek(fileno(seama), 0, SEEK_CUR), SEEK_SET);
+
+	if (threaded)
+		pthread_join(thread, NULL);
+	else
+		oseama_md5_thread(&job);
+
+	if (length != st.st_size) {
+		fprintf(stderr, "Couldn't write %zu B to %s\n", (size_t)st.st_size, seama_path);
+		length = -EIO;
+	}
+
+	munmap(map, st.st_size);
+	close(fd);
 
 	return length;
 }
 
-static ssize_t oseama_entity_append_zeros(FILE *seama, size_t length) {
+static ssize_t oseama_entity_append_zeros(FILE *seama, size_t length, md5_ctx_t *ctx) {
 	uint8_t *buf;
 
 	buf = malloc(length);
@@ -257,9 +365,15 @@ static ssize_t oseama_entity_append_zeros(FILE *seama, size_t length) {
 
 	if (fwrite(buf, 1, length, seama) != length) {
 		fprintf(stderr, "Couldn't write %zu B to %s\n", length, seama_path);
+		free(buf);
 		return -EIO;
 	}
 
+	if (ctx)
+		md5_hash(buf, length, ctx);
+
+	free(buf);
+
 	return length;
 }
 
@@ -267,26 +381,17 @@ static ssize_t oseama_entity_align(FILE *seama, size_t curr_offset, size_t align
 	if (curr_offset & (alignment - 1)) {
 		size_t length = alignment - (curr_offset % alignment);
 
-		return oseama_entity_append_zeros(seama, length);
+		return oseama_entity_append_zeros(seama, length, NULL);
 	}
 
 	return 0;
 }
 
-static int oseama_entity_write_hdr(FILE *seama, size_t metasize, size_t imagesize) {
+static int oseama_entity_write_hdr(FILE *seama, size_t metasize, size_t imagesize, md5_ctx_t *ctx) {
 	struct seama_entity_header hdr = {};
-	uint8_t buf[128];
-	size_t length = imagesize;
 	size_t bytes;
-	MD5_CTX ctx;
 
-	fseek(seama, sizeof(hdr) + metasize, SEEK_SET);
-	MD5_Init(&ctx);
-	while ((bytes = fread(buf, 1, oseama_min(sizeof(buf), length), seama)) > 0) {
-		MD5_Update(&ctx, buf, bytes);
-		length -= bytes;
-	}
-	MD5_Final(hdr.md5, &ctx);
+	md5_end(hdr.md5, ctx);
 
 	hdr.magic = cpu_to_be32(SEAMA_MAGIC);
 	hdr.metasize = cpu_to_be16(metasize);
@@ -307,6 +412,7 @@ static int oseama_entity(int argc, char **argv) {
 	ssize_t sbytes;
 	size_t curr_offset = sizeof(struct seama_entity_header);
 	size_t metasize = 0, imagesize = 0;
+	md5_ctx_t ctx;
 	int c;
 	int err = 0;
 
@@ -352,13 +458,14 @@ static int oseama_entity(int argc, char **argv) {
 		}
 	}
 
+	md5_begin(&ctx);
 	optind = 3;
 	while ((c = getopt(argc, argv, "m:f:b:")) != -1) {
 		switch (c) {
 		case 'm':
 			break;
 		case 'f':
-			sbytes = oseama_entity_append_file(seama, optarg);
+			sbytes = oseama_entity_append_file(seama, optarg, &ctx);
 			if (sbytes < 0) {
 				fprintf(stderr, "Failed to append file %s\n", optarg);
 			} else {
@@ -371,7 +478,7 @@ static int oseama_entity(int argc, char **argv) {
 			if (sbytes < 0) {
 				fprintf(stderr, "Current Seama entity length is 0x%zx, can't pad it with zeros to 0x%lx\n", curr_offset, strtol(optarg, NULL, 0));
 			} else {
-				sbytes = oseama_entity_append_zeros(seama, sbytes);
+				sbytes = oseama_entity_append_zeros(seama, sbytes, &ctx);
 				if (sbytes < 0) {
 					fprintf(stderr, "Failed to append zeros\n");
 				} else {
@@ -385,7 +492,7 @@ static int oseama_entity(int argc, char **argv) {
 			break;
 	}
 
-	oseama_entity_write_hdr(seama, metasize, imagesize);
+	oseama_entity_write_hdr(seama, metasize, imagesize, &ctx);
 
 	fclose(seama);
 out:
@@ -414,7 +521,7 @@ static void oseama_extract_parse_options(int argc, char **argv) {
 static int oseama_extract_entity(FILE *seama, FILE *out) {
 	struct seama_entity_header hdr;
 	size_t bytes, metasize, imagesize, length;
-	uint8_t buf[1024];
+	ssize_t copied;
 	int i = 0;
 	int err = 0;
 
@@ -433,17 +540,15 @@ static int oseama_extract_entity(FILE *seama, FILE *out) {
 			continue;
 		}
 
-		fseek(seama, -sizeof(hdr), SEEK_CUR);
-
 		length = sizeof(hdr) + metasize + imagesize;
-		while ((bytes = fread(buf, 1, oseama_min(sizeof(buf), length), seama)) > 0) {
-			if (fwrite(buf, 1, bytes, out) != bytes) {
-				fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, out_path);
-				err = -EIO;
-				break;
-			}
-			length -= bytes;
+		fflush(out);
+		copied = oseama_copy_fd(fileno(seama), ftell(seama) - sizeof(hdr), fileno(out), length);
+		if (copied < 0) {
+			fprintf(stderr, "Couldn't write %zu B to %s\n", length, out_path);
+			err = -EIO;
+			break;
 		}
+		length -= copied;
 
 		if (length) {
 			fprintf(stderr, "Couldn't extract whole entity %d from %s (%zu B left)\n", entity_idx, seama_path, length);
@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Check the shared CRC32 and MD5 code, as built into mkhash, against zlib and
+# md5sum. Buffers of odd sizes exercise the tails behind the 8 byte (CRC32)
+# and 64 byte (MD5) blocks.
+#
+# Usage: check.sh [<path to mkhash>]
+#
+
+MKHASH="${1:-${STAGING_DIR_HOST:-staging_dir/host}/bin/mkhash}"
+TMP="$(mktemp -d)" || exit 1
+trap 'rm -rf "$TMP"' EXIT
+ret=0
+
+for size in 0 1 7 8 9 55 56 63 64 65 4095 65536 1000003; do
+	head -c "$size" /dev/urandom > "$TMP/data"
+
+	crc="$("$MKHASH" crc32 "$TMP/data")"
+	ref="$(python3 -c 'import sys, zlib; print("%08x" % zlib.crc32(open(sys.argv[1], "rb").read()))' "$TMP/data")"
+	[ "$crc" = "$ref" ] || {
+		echo "crc32 mismatch for $size bytes: $crc instead of $ref" >&2
+		ret=1
+	}
+
+	md5="$("$MKHASH" md5 "$TMP/data")"
+	ref="$(md5sum < "$TMP/data" | cut -d' ' -f1)"
+	[ "$md5" = "$ref" ] || {
+		echo "md5 mismatch for $size bytes: $md5 instead of $ref" >&2
+		ret=1
+	}
+done
+
+exit $ret
@@ -37,9 +37,9 @@
  *      polynomial $edb88320
  */
 
-#include <stdint.h>
+#include "crc32.h"
 
-const uint32_t crc32_table[256] = {
+static const uint32_t crc32_table[256] = {
 	0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L,
 	0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0x0edb8832L, 0x79dcb8a4L,
 	0xe0d5e91eL, 0x97d2d988L, 0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L,
@@ -93,3 +93,50 @@ const uint32_t crc32_table[256] = {
 	0x5d681b02L, 0x2a6f2b94L, 0xb40bbe37L, 0xc30c8ea1L, 0x5a05df1bL,
 	0x2d02ef8dL
 };
+
+/*
+ * Slice-by-8: crc32_slice[n] holds the CRC of a byte followed by n + 1 zero
+ * bytes, which allows to fold 8 bytes of input into the CRC at once. The tables
+ * are derived from crc32_table before main() runs, so that threads calling
+ * crc32() never race on their setup.
+ */
+static uint32_t crc32_slice[7][256];
+
+static void __attribute__((constructor)) crc32_slice_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = crc32_table[i];
+		for (j = 0; j < 7; j++) {
+			c = crc32_table[c & 0xff] ^ (c >> 8);
+			crc32_slice[j][i] = c;
+		}
+	}
+}
+
+uint32_t crc32(uint32_t crc, const void *buf, size_t len)
+{
+	const unsigned char *s = buf;
+
+	/* Input bytes are assembled explicitly, so this is endian neutral */
+	while (len >= 8) {
+		crc ^= s[0] | (s[1] << 8) | (s[2] << 16) | ((uint32_t)s[3] << 24);
+		crc = crc32_slice[6][crc & 0xff] ^
+		      crc32_slice[5][(crc >> 8) & 0xff] ^
+		      crc32_slice[4][(crc >> 16) & 0xff] ^
+		      crc32_slice[3][crc >> 24] ^
+		      crc32_slice[2][s[4]] ^
+		      crc32_slice[1][s[5]] ^
+		      crc32_slice[0][s[6]] ^
+		      crc32_table[s[7]];
+		s += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = crc32_table[(crc ^ *s++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
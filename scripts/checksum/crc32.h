@@ -0,0 +1,19 @@
+#ifndef CHECKSUM_CRC32_H
+#define CHECKSUM_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Update a CRC-32 (IEEE 802.3, reflected) with the contents of the buffer. No
+ * pre- or post-inversion is done, start with 0xffffffff and invert the result
+ * to get the value zlib's crc32() returns.
+ */
+uint32_t crc32(uint32_t crc, const void *buf, size_t len);
+
+static inline uint32_t crc32buf(const void *buf, size_t len)
+{
+	return crc32(0xffffffff, buf, len);
+}
+
+#endif
@@ -33,10 +33,18 @@
  * It is meant to be fast, but not as fast as possible.  Some known
  * optimizations are not included to reduce source code size and avoid
  * compile-time configuration.
+ *
+ * Taken from scripts/mkhash.c, the functions were renamed after the ones of
+ * libubox, which most users of this code used before.
  */
 
-#ifndef HAVE_OPENSSL
+#ifndef __FreeBSD__
+#include <endian.h>
+#else
+#include <sys/endian.h>
+#endif
 
+#include <stdio.h>
 #include <string.h>
 
 #include "md5.h"
@@ -65,36 +73,37 @@
 /*
  * SET reads 4 input bytes in little-endian byte order and stores them
  * in a properly aligned word in host byte order.
- *
- * The check for little-endian architectures that tolerate unaligned
- * memory accesses is just an optimization.  Nothing will break if it
- * doesn't work.
  */
-#if defined(__i386__) || defined(__x86_64__) || defined(__vax__)
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+/*
+ * The copy becomes a single load where the CPU handles unaligned accesses,
+ * and stays safe on targets which do not.
+ */
 #define SET(n) \
-	(*(MD5_u32plus *)&ptr[(n) * 4])
+	(memcpy(&block[(n)], &ptr[(n) * 4], 4), block[(n)])
 #define GET(n) \
-	SET(n)
+	(block[(n)])
 #else
 #define SET(n) \
-	(ctx->block[(n)] = \
-	(MD5_u32plus)ptr[(n) * 4] | \
-	((MD5_u32plus)ptr[(n) * 4 + 1] << 8) | \
-	((MD5_u32plus)ptr[(n) * 4 + 2] << 16) | \
-	((MD5_u32plus)ptr[(n) * 4 + 3] << 24))
+	(block[(n)] = \
+	(uint32_t)ptr[(n) * 4] | \
+	((uint32_t)ptr[(n) * 4 + 1] << 8) | \
+	((uint32_t)ptr[(n) * 4 + 2] << 16) | \
+	((uint32_t)ptr[(n) * 4 + 3] << 24))
 #define GET(n) \
-	(ctx->block[(n)])
+	(block[(n)])
 #endif
 
 /*
  * This processes one or more 64-byte data blocks, but does NOT update
  * the bit counters.  There are no alignment requirements.
  */
-static const void *body(MD5_CTX *ctx, const void *data, unsigned long size)
+static const void *md5_body(md5_ctx_t *ctx, const void *data, unsigned long size)
 {
 	const unsigned char *ptr;
-	MD5_u32plus a, b, c, d;
-	MD5_u32plus saved_a, saved_b, saved_c, saved_d;
+	uint32_t a, b, c, d;
+	uint32_t saved_a, saved_b, saved_c, saved_d;
+	uint32_t block[16];
 
 	ptr = (const unsigned char *)data;
 
@@ -197,7 +206,7 @@ static const void *body(MD5_CTX *ctx, const void *data, unsigned long size)
 	return ptr;
 }
 
-void MD5_Init(MD5_CTX *ctx)
+void md5_begin(md5_ctx_t *ctx)
 {
 	ctx->a = 0x67452301;
 	ctx->b = 0xefcdab89;
@@ -208,9 +217,9 @@ void MD5_Init(MD5_CTX *ctx)
 	ctx->hi = 0;
 }
 
-void MD5_Update(MD5_CTX *ctx, const void *data, unsigned long size)
+void md5_hash(const void *data, size_t size, md5_ctx_t *ctx)
 {
-	MD5_u32plus saved_lo;
+	uint32_t saved_lo;
 	unsigned long used, available;
 
 	saved_lo = ctx->lo;
@@ -231,19 +240,20 @@ void MD5_Update(MD5_CTX *ctx, const void *data, unsigned long size)
 		memcpy(&ctx->buffer[used], data, available);
 		data = (const unsigned char *)data + available;
 		size -= available;
-		body(ctx, ctx->buffer, 64);
+		md5_body(ctx, ctx->buffer, 64);
 	}
 
 	if (size >= 64) {
-		data = body(ctx, data, size & ~(unsigned long)0x3f);
+		data = md5_body(ctx, data, size & ~((size_t) 0x3f));
 		size &= 0x3f;
 	}
 
 	memcpy(ctx->buffer, data, size);
 }
 
-void MD5_Final(unsigned char *result, MD5_CTX *ctx)
+void md5_end(void *resbuf, md5_ctx_t *ctx)
 {
+	unsigned char *result = resbuf;
 	unsigned long used, available;
 
 	used = ctx->lo & 0x3f;
@@ -254,7 +264,7 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 
 	if (available < 8) {
 		memset(&ctx->buffer[used], 0, available);
-		body(ctx, ctx->buffer, 64);
+		md5_body(ctx, ctx->buffer, 64);
 		used = 0;
 		available = 64;
 	}
@@ -271,7 +281,7 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 	ctx->buffer[62] = ctx->hi >> 16;
 	ctx->buffer[63] = ctx->hi >> 24;
 
-	body(ctx, ctx->buffer, 64);
+	md5_body(ctx, ctx->buffer, 64);
 
 	result[0] = ctx->a;
 	result[1] = ctx->a >> 8;
@@ -293,4 +303,28 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
-#endif
+int md5sum(const char *file, void *md5_buf)
+{
+	char buf[4096];
+	md5_ctx_t ctx;
+	int ret = 0;
+	size_t len;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (!f)
+		return -1;
+
+	md5_begin(&ctx);
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		md5_hash(buf, len, &ctx);
+		ret += len;
+	}
+	md5_end(md5_buf, &ctx);
+
+	if (ferror(f))
+		ret = -1;
+	fclose(f);
+
+	return ret;
+}
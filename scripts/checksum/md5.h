@@ -0,0 +1,27 @@
+/*
+ * MD5 Message-Digest Algorithm (RFC 1321), see md5.c for the origin of the code.
+ * The interface matches the one of libubox.
+ */
+
+#ifndef CHECKSUM_MD5_H
+#define CHECKSUM_MD5_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MD5_DIGEST_LENGTH	16
+
+typedef struct md5_ctx {
+	uint32_t lo, hi;
+	uint32_t a, b, c, d;
+	unsigned char buffer[64];
+} md5_ctx_t;
+
+void md5_begin(md5_ctx_t *ctx);
+void md5_hash(const void *data, size_t size, md5_ctx_t *ctx);
+void md5_end(void *resbuf, md5_ctx_t *ctx);
+
+/* Hash a whole file, returns the number of bytes hashed or -1 on error */
+int md5sum(const char *file, void *md5_buf);
+
+#endif
@@ -107,8 +107,10 @@ int parse_fit_partitions(struct parsed_partitions *state, u64 fit_start_sector,
 	if (IS_ERR(page))
 		return -EFAULT;
 
-	if (PageError(page))
+	if (PageError(page)) {
+		put_page(page);
 		return -EFAULT;
+	}
 
 	init_fit = page_address(page);
 
@@ -154,7 +156,7 @@ int parse_fit_partitions(struct parsed_partitions *state, u64 fit_start_sector,
 
 	config = fdt_path_offset(fit, FIT_CONFS_PATH);
 	if (config < 0) {
-		printk(KERN_ERR "FIT: Cannot find %s node: %d\n", FIT_CONFS_PATH, images);
+		printk(KERN_ERR "FIT: Cannot find %s node: %d\n", FIT_CONFS_PATH, config);
 		ret = -ENOENT;
 		goto ret_out;
 	}
@@ -289,6 +291,7 @@ int parse_fit_partitions(struct parsed_partitions *state, u64 fit_start_sector,
 		strlcat(state->pp_buf, tmp, PAGE_SIZE);
 	}
 ret_out:
+	of_node_put(np);
 	kfree(fit);
 	return ret;
 }
@@ -92,6 +92,14 @@ bool mapping_block_in_range(int block, int *start, int *end)
 	return false;
 }
 
+static inline int
+mtk_bmt_get_mapping_block(int block)
+{
+	bmtd.stats.lookups++;
+
+	return bmtd.ops->get_mapping_block(block);
+}
+
 static bool
 mtk_bmt_remap_block(u32 block, u32 mapped_block, int copy_len)
 {
@@ -100,7 +108,12 @@ mtk_bmt_remap_block(u32 block, u32 mapped_block, int copy_len)
 	if (!mapping_block_in_range(block, &start, &end))
 		return false;
 
-	return bmtd.ops->remap_block(block, mapped_block, copy_len);
+	if (!bmtd.ops->remap_block(block, mapped_block, copy_len))
+		return false;
+
+	bmtd.stats.remaps++;
+
+	return true;
 }
 
 static int
@@ -123,7 +136,7 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 		u32 block = from >> bmtd.blk_shift;
 		int cur_block;
 
-		cur_block = bmtd.ops->get_mapping_block(block);
+		cur_block = mtk_bmt_get_mapping_block(block);
 		if (cur_block < 0)
 			return -EIO;
 
@@ -188,7 +201,7 @@ mtk_bmt_write(struct mtd_info *mtd, loff_t to,
 		u32 block = to >> bmtd.blk_shift;
 		int cur_block;
 
-		cur_block = bmtd.ops->get_mapping_block(block);
+		cur_block = mtk_bmt_get_mapping_block(block);
 		if (cur_block < 0)
 			return -EIO;
 
@@ -242,7 +255,7 @@ mtk_bmt_mtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 
 	while (start_addr < end_addr) {
 		orig_block = start_addr >> bmtd.blk_shift;
-		block = bmtd.ops->get_mapping_block(orig_block);
+		block = mtk_bmt_get_mapping_block(orig_block);
 		if (block < 0)
 			return -EIO;
 		mapped_instr.addr = (loff_t)block << bmtd.blk_shift;
@@ -269,7 +282,7 @@ mtk_bmt_block_isbad(struct mtd_info *mtd, loff_t ofs)
 	int ret;
 
 retry:
-	block = bmtd.ops->get_mapping_block(orig_block);
+	block = mtk_bmt_get_mapping_block(orig_block);
 	ret = bmtd._block_isbad(mtd, (loff_t)block << bmtd.blk_shift);
 	if (ret) {
 		if (mtk_bmt_remap_block(orig_block, block, bmtd.blk_size) &&
@@ -285,7 +298,7 @@ mtk_bmt_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	u16 orig_block = ofs >> bmtd.blk_shift;
 	int block;
 
-	block = bmtd.ops->get_mapping_block(orig_block);
+	block = mtk_bmt_get_mapping_block(orig_block);
 	if (block < 0)
 		return -EIO;
 
@@ -315,12 +328,12 @@ static int mtk_bmt_debug_repair(void *data, u64 val)
 	int block = val >> bmtd.blk_shift;
 	int prev_block, new_block;
 
-	prev_block = bmtd.ops->get_mapping_block(block);
+	prev_block = mtk_bmt_get_mapping_block(block);
 	if (prev_block < 0)
 		return -EIO;
 
 	bmtd.ops->unmap_block(block);
-	new_block = bmtd.ops->get_mapping_block(block);
+	new_block = mtk_bmt_get_mapping_block(block);
 	if (new_block < 0)
 		return -EIO;
 
@@ -345,7 +358,7 @@ static int mtk_bmt_debug_mark_bad(void *data, u64 val)
 	u32 block = val >> bmtd.blk_shift;
 	int cur_block;
 
-	cur_block = bmtd.ops->get_mapping_block(block);
+	cur_block = mtk_bmt_get_mapping_block(block);
 	if (cur_block < 0)
 		return -EIO;
 
@@ -378,6 +391,9 @@ mtk_bmt_add_debugfs(void)
 	debugfs_create_file_unsafe("mark_good", S_IWUSR, dir, NULL, &fops_mark_good);
 	debugfs_create_file_unsafe("mark_bad", S_IWUSR, dir, NULL, &fops_mark_bad);
 	debugfs_create_file_unsafe("debug", S_IWUSR, dir, NULL, &fops_debug);
+	debugfs_create_u64("lookups", S_IRUSR, dir, &bmtd.stats.lookups);
+	debugfs_create_u64("remaps", S_IRUSR, dir, &bmtd.stats.remaps);
+	debugfs_create_u64("table_writes", S_IRUSR, dir, &bmtd.stats.table_writes);
 }
 
 void mtk_bmt_detach(struct mtd_info *mtd)
@@ -390,6 +406,7 @@ void mtk_bmt_detach(struct mtd_info *mtd)
 	bmtd.debugfs_dir = NULL;
 
 	kfree(bmtd.bbt_buf);
+	kfree(bmtd.bbt_map);
 	kfree(bmtd.data_buf);
 
 	mtd->_read_oob = bmtd._read_oob;
@@ -26,10 +26,18 @@ struct mtk_bmt_ops {
 struct bbbt;
 struct nmbm_instance;
 
+struct mtk_bmt_stats {
+	u64 lookups;
+	u64 remaps;
+	u64 table_writes;
+};
+
 struct bmt_desc {
 	struct mtd_info *mtd;
 	unsigned char *bbt_buf;
 	unsigned char *data_buf;
+	/* bbt: logical to physical block lookup table */
+	u16 *bbt_map;
 
 	int (*_read_oob) (struct mtd_info *mtd, loff_t from,
 			  struct mtd_oob_ops *ops);
@@ -71,6 +79,8 @@ struct bmt_desc {
 
 	/* to compensate for driver level remapping */
 	u8 oob_offset;
+
+	struct mtk_bmt_stats stats;
 };
 
 extern struct bmt_desc bmtd;
@@ -121,8 +131,13 @@ static inline int write_bmt(u16 block, unsigned char *dat)
 		.len = bmtd.bmt_pgs << bmtd.pg_shift,
 	};
 	loff_t addr = (loff_t)block << bmtd.blk_shift;
+	int ret;
+
+	ret = bmtd._write_oob(bmtd.mtd, addr, &ops);
+	if (!ret)
+		bmtd.stats.table_writes++;
 
-	return bmtd._write_oob(bmtd.mtd, addr, &ops);
+	return ret;
 }
 
 int bbt_nand_copy(u16 dest_blk, u16 src_blk, loff_t max_offset);
@@ -25,6 +25,51 @@ bbt_block_is_bad(u16 block)
 	return cur & (3 << ((block % 4) * 2));
 }
 
+static void
+bbt_map_range(int start, int end)
+{
+	u16 *map = bmtd.bbt_map;
+	int good = 0, ofs;
+	int i;
+
+	if (end > bmtd.total_blks)
+		end = bmtd.total_blks;
+
+	/* skip bad blocks within the mapping range */
+	for (i = start; i < end; i++)
+		if (!bbt_block_is_bad(i))
+			map[start + good++] = i;
+
+	/* when overflowing, remap remaining blocks to bad ones */
+	ofs = end - start;
+	for (i = end - 1; i >= start && ofs > good; i--)
+		if (bbt_block_is_bad(i))
+			map[start + --ofs] = i;
+}
+
+static void
+bbt_update_map(void)
+{
+	const __be32 *cur = bmtd.remap_range;
+	int i;
+
+	for (i = 0; i < bmtd.total_blks; i++)
+		bmtd.bbt_map[i] = i;
+
+	/*
+	 * Without mediatek,bmt-remap-range, blocks have always been mapped
+	 * 1:1 (the range end in blocks was shifted down to an empty range),
+	 * keep it that way to not move data on existing devices.
+	 */
+	if (!cur || !bmtd.remap_range_len)
+		return;
+
+	/* the first matching range wins, so apply them in reverse order */
+	for (i = bmtd.remap_range_len - 1; i >= 0; i--)
+		bbt_map_range(be32_to_cpu(cur[2 * i]) >> bmtd.blk_shift,
+			      be32_to_cpu(cur[2 * i + 1]) >> bmtd.blk_shift);
+}
+
 static void
 bbt_set_block_state(u16 block, bool bad)
 {
@@ -35,6 +80,12 @@ bbt_set_block_state(u16 block, bool bad)
 	else
 		bmtd.bbt_buf[block / 4] &= ~mask;
 
+	bbt_update_map();
+}
+
+static void
+bbt_write_table(void)
+{
 	bbt_nand_erase(bmtd.bmt_blk_idx);
 	write_bmt(bmtd.bmt_blk_idx, bmtd.bbt_buf);
 }
@@ -42,40 +93,10 @@ bbt_set_block_state(u16 block, bool bad)
 static int
 get_mapping_block_index_bbt(int block)
 {
-	int start, end, ofs;
-	int bad_blocks = 0;
-	int i;
-
-	if (!mapping_block_in_range(block, &start, &end))
+	if (block >= bmtd.total_blks)
 		return block;
 
-	start >>= bmtd.blk_shift;
-	end >>= bmtd.blk_shift;
-	/* skip bad blocks within the mapping range */
-	ofs = block - start;
-	for (i = start; i < end; i++) {
-		if (bbt_block_is_bad(i))
-			bad_blocks++;
-		else if (ofs)
-			ofs--;
-		else
-			break;
-	}
-
-	if (i < end)
-		return i;
-
-	/* when overflowing, remap remaining blocks to bad ones */
-	for (i = end - 1; bad_blocks > 0; i--) {
-		if (!bbt_block_is_bad(i))
-			continue;
-
-		bad_blocks--;
-		if (bad_blocks <= ofs)
-			return i;
-	}
-
-	return block;
+	return bmtd.bbt_map[block];
 }
 
 static bool remap_block_bbt(u16 block, u16 mapped_blk, int copy_len)
@@ -93,6 +114,9 @@ static bool remap_block_bbt(u16 block, u16 mapped_blk, int copy_len)
 	if (copy_len > 0)
 		bbt_nand_copy(new_blk, mapped_blk, copy_len);
 
+	/* only commit the new mapping once the data has been moved */
+	bbt_write_table();
+
 	return true;
 }
 
@@ -100,6 +124,7 @@ static void
 unmap_block_bbt(u16 block)
 {
 	bbt_set_block_state(block, false);
+	bbt_write_table();
 }
 
 static int
@@ -150,11 +175,17 @@ mtk_bmt_init_bbt(struct device_node *np)
 	memset(bmtd.bbt_buf, 0xff, buf_size);
 	bmtd.mtd->size -= 4 * bmtd.mtd->erasesize;
 
+	bmtd.bbt_map = kmalloc_array(bmtd.total_blks, sizeof(*bmtd.bbt_map),
+				     GFP_KERNEL);
+	if (!bmtd.bbt_map)
+		return -ENOMEM;
+
 	ret = mtk_bmt_read_bbt();
 	if (ret)
 		return ret;
 
 	bmtd.bmt_pgs = buf_size / bmtd.pg_size;
+	bbt_update_map();
 
 	return 0;
 }
@@ -183,8 +214,7 @@ static int mtk_bmt_debug_bbt(void *data, u64 val)
 #endif
 
 		bmtd.bmt_blk_idx = bmtd.total_blks - 1;
-		bbt_nand_erase(bmtd.bmt_blk_idx);
-		write_bmt(bmtd.bmt_blk_idx, bmtd.bbt_buf);
+		bbt_write_table();
 		break;
 	default:
 		break;
@@ -1,4 +1,5 @@
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include "mtk_bmt.h"
 
@@ -111,6 +112,9 @@ struct nmbm_instance {
 	u32 max_reserved_blocks;
 	bool empty_page_ecc_ok;
 	bool force_create;
+
+	/* Physical page reads, used for attach time accounting */
+	u32 page_reads;
 };
 
 static inline u32 nmbm_crc32(u32 crcval, const void *buf, size_t size)
@@ -245,6 +249,7 @@ static int nmbm_read_phys_page(struct nmbm_instance *ni, uint64_t addr,
 		if (oob)
 			ops.ooblen = mtd_oobavail(bmtd.mtd, &ops);
 
+		ni->page_reads++;
 		ret = bmtd._read_oob(bmtd.mtd, addr, &ops);
 		if (ret == -EUCLEAN)
 			return min_t(u32, bmtd.mtd->bitflip_threshold + 1,
@@ -605,6 +610,35 @@ static void nmbm_scan_badblocks(struct nmbm_instance *ni)
 	}
 }
 
+/*
+ * nmbm_verify_badblocks - Compare block state table with OOB bad block marks
+ * @ni: NMBM instance structure
+ *
+ * Attaching trusts the state table stored in the info table instead of
+ * scanning every block. This walks the chip and reports blocks which are
+ * marked bad in OOB but still recorded as good, without changing anything.
+ *
+ * Return the number of mismatching blocks.
+ */
+static uint32_t nmbm_verify_badblocks(struct nmbm_instance *ni)
+{
+	uint32_t ba, count = 0;
+
+	for (ba = 0; ba < ni->block_count; ba++) {
+		if (nmbm_get_block_state(ni, ba) != BLOCK_ST_GOOD)
+			continue;
+
+		if (!nmbm_check_bad_phys_block(ni, ba))
+			continue;
+
+		nlog_warn(ni, "Block %u [0x%08llx] is bad but recorded as good\n",
+			  ba, ba2addr(ni, ba));
+		count++;
+	}
+
+	return count;
+}
+
 /*
  * nmbm_build_mapping_table - Build initial block mapping table
  * @ni: NMBM instance structure
@@ -1029,9 +1063,15 @@ static bool nmbm_write_info_table(struct nmbm_instance *ni, uint32_t ba,
 				  uint32_t limit, uint32_t *actual_start_ba,
 				  uint32_t *actual_end_ba)
 {
-	return nmbm_write_mgmt_range(ni, ba, limit, ni->info_table_cache,
-				     ni->info_table_size, actual_start_ba,
-				     actual_end_ba);
+	bool success;
+
+	success = nmbm_write_mgmt_range(ni, ba, limit, ni->info_table_cache,
+					ni->info_table_size, actual_start_ba,
+					actual_end_ba);
+	if (success)
+		bmtd.stats.table_writes++;
+
+	return success;
 }
 
 /*
@@ -1754,6 +1794,7 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
 	uint8_t *off = ni->info_table_cache;
 	uint32_t limit = ba + size2blk(ni, ni->info_table_size);
 	uint32_t start_ba = 0, chunksize, sizeremain = ni->info_table_size;
+	uint32_t hdrsize = 0;
 	bool success, checkhdr = true;
 	int ret;
 
@@ -1770,22 +1811,41 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
 		if (chunksize > bmtd.blk_size)
 			chunksize = bmtd.blk_size;
 
-		/* Assume block with ECC error has no info table data */
-		ret = nmbn_read_data(ni, ba2addr(ni, ba), off, chunksize);
-		if (ret < 0)
-			goto skip_bad_block;
-		else if (ret > 0)
-			return false;
-
+		/*
+		 * Validate the header from the first page before reading the
+		 * rest of the block. Most candidate blocks visited while
+		 * searching do not hold a table, so this saves reading a
+		 * whole table worth of pages for each of them.
+		 */
 		if (checkhdr) {
+			hdrsize = bmtd.pg_size;
+			if (hdrsize > chunksize)
+				hdrsize = chunksize;
+
+			ret = nmbn_read_data(ni, ba2addr(ni, ba), off, hdrsize);
+			if (ret < 0)
+				goto skip_bad_block;
+			else if (ret > 0)
+				return false;
+
 			success = nmbm_check_info_table_header(ni, off);
 			if (!success)
 				return false;
 
 			start_ba = ba;
 			checkhdr = false;
+		} else {
+			hdrsize = 0;
 		}
 
+		/* Assume block with ECC error has no info table data */
+		ret = nmbn_read_data(ni, ba2addr(ni, ba) + hdrsize,
+				     off + hdrsize, chunksize - hdrsize);
+		if (ret < 0)
+			goto skip_bad_block;
+		else if (ret > 0)
+			return false;
+
 		off += chunksize;
 		sizeremain -= chunksize;
 
@@ -2165,6 +2225,7 @@ static void nmbm_init_structure(struct nmbm_instance *ni)
  */
 static int nmbm_attach(struct nmbm_instance *ni)
 {
+	ktime_t start = ktime_get();
 	bool success;
 
 	if (!ni)
@@ -2209,6 +2270,9 @@ static int nmbm_attach(struct nmbm_instance *ni)
 	if (!success)
 		return -ENODEV;
 
+	nlog_debug(ni, "NMBM attached in %lld us, %u page reads\n",
+		   ktime_us_delta(ktime_get(), start), ni->page_reads);
+
 	return 0;
 }
 
@@ -2292,6 +2356,10 @@ static int mtk_bmt_debug_nmbm(void *data, u64 val)
 
 			printk("remap [%x->%x]\n", i, ni->block_mapping[i]);
 		}
+		break;
+	case 1:
+		printk("%u block state mismatches\n", nmbm_verify_badblocks(ni));
+		break;
 	}
 
 	return 0;
@@ -27,6 +27,9 @@
 #include <linux/of_mdio.h>
 #include <linux/of_net.h>
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <net/genetlink.h>
 #include <linux/switch.h>
 #include <linux/delay.h>
@@ -226,6 +229,7 @@ ar8xxx_mii_read32(struct ar8xxx_priv *priv, int phy_id, int regnum)
 
 	lo = bus->read(bus, phy_id, regnum);
 	hi = bus->read(bus, phy_id, regnum + 1);
+	priv->mdio_stats.reads += 2;
 
 	return (hi << 16) | lo;
 }
@@ -247,22 +251,152 @@ ar8xxx_mii_write32(struct ar8xxx_priv *priv, int phy_id, int regnum, u32 val)
 		bus->write(bus, phy_id, regnum + 1, hi);
 		bus->write(bus, phy_id, regnum, lo);
 	}
+	priv->mdio_stats.writes += 2;
 }
 
-u32
-ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+/* must be called with mdio_lock held */
+void
+ar8xxx_select_page(struct ar8xxx_priv *priv, u16 page)
 {
 	struct mii_bus *bus = priv->mii_bus;
+
+	if (priv->cur_page == page) {
+		priv->mdio_stats.page_skips++;
+		return;
+	}
+
+	bus->write(bus, 0x18, 0, page);
+	wait_for_page_switch();
+	priv->cur_page = page;
+	priv->mdio_stats.writes++;
+}
+
+static u32
+__ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+{
 	u16 r1, r2, page;
-	u32 val;
 
 	split_addr((u32) reg, &r1, &r2, &page);
+	ar8xxx_select_page(priv, page);
+
+	return ar8xxx_mii_read32(priv, 0x10 | r2, r1);
+}
+
+static void
+__ar8xxx_write(struct ar8xxx_priv *priv, int reg, u32 val)
+{
+	u16 r1, r2, page;
+
+	split_addr((u32) reg, &r1, &r2, &page);
+	ar8xxx_select_page(priv, page);
+	ar8xxx_mii_write32(priv, 0x10 | r2, r1, val);
+}
+
+static int
+ar8xxx_shadow_index(struct ar8xxx_priv *priv, int reg)
+{
+	const struct ar8xxx_chip *chip = priv->chip;
+	unsigned int i, off, base = 0;
+
+	if (!priv->reg_shadow_size)
+		return -1;
+
+	for (i = 0; i < chip->num_shadow_regs; i++) {
+		const struct ar8xxx_reg_range *r = &chip->shadow_regs[i];
+
+		if (reg >= r->start) {
+			off = (reg - r->start) / r->stride;
+			if (off < r->count && reg == r->start + off * r->stride)
+				return base + off;
+		}
+		base += r->count;
+	}
+
+	return -1;
+}
+
+static int
+ar8xxx_shadow_reg(struct ar8xxx_priv *priv, unsigned int idx)
+{
+	const struct ar8xxx_chip *chip = priv->chip;
+	unsigned int i;
+
+	for (i = 0; i < chip->num_shadow_regs; i++) {
+		const struct ar8xxx_reg_range *r = &chip->shadow_regs[i];
+
+		if (idx < r->count)
+			return r->start + idx * r->stride;
+		idx -= r->count;
+	}
+
+	return -1;
+}
+
+static void
+ar8xxx_shadow_write(struct ar8xxx_priv *priv, int reg, int idx, u32 val)
+{
+	if (idx >= 0) {
+		if (test_bit(idx, priv->reg_shadow_valid) &&
+		    priv->reg_shadow[idx] == val) {
+			priv->mdio_stats.writes_elided++;
+			return;
+		}
+
+		priv->reg_shadow[idx] = val;
+		set_bit(idx, priv->reg_shadow_valid);
+		if (priv->reg_batch) {
+			set_bit(idx, priv->reg_shadow_dirty);
+			return;
+		}
+	}
+
+	__ar8xxx_write(priv, reg, val);
+}
+
+/* write back deferred registers, grouped by page */
+static void
+ar8xxx_shadow_flush(struct ar8xxx_priv *priv)
+{
+	unsigned int size = priv->reg_shadow_size;
+	unsigned int idx;
+	u16 r1, r2, page, cur;
+	int reg;
+
+	while ((idx = find_first_bit(priv->reg_shadow_dirty, size)) < size) {
+		split_addr(ar8xxx_shadow_reg(priv, idx), &r1, &r2, &cur);
+
+		for_each_set_bit(idx, priv->reg_shadow_dirty, size) {
+			reg = ar8xxx_shadow_reg(priv, idx);
+			split_addr(reg, &r1, &r2, &page);
+			if (page != cur)
+				continue;
+
+			__ar8xxx_write(priv, reg, priv->reg_shadow[idx]);
+			clear_bit(idx, priv->reg_shadow_dirty);
+		}
+	}
+}
+
+u32
+ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+{
+	struct mii_bus *bus = priv->mii_bus;
+	int idx;
+	u32 val;
 
 	mutex_lock(&bus->mdio_lock);
 
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
-	val = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
+	idx = ar8xxx_shadow_index(priv, reg);
+	if (idx >= 0 && test_bit(idx, priv->reg_shadow_valid)) {
+		val = priv->reg_shadow[idx];
+		priv->mdio_stats.shadow_hits++;
+	} else {
+		val = __ar8xxx_read(priv, reg);
+		if (idx >= 0) {
+			priv->reg_shadow[idx] = val;
+			set_bit(idx, priv->reg_shadow_valid);
+		}
+	}
 
 	mutex_unlock(&bus->mdio_lock);
 
@@ -273,16 +407,9 @@ void
 ar8xxx_write(struct ar8xxx_priv *priv, int reg, u32 val)
 {
 	struct mii_bus *bus = priv->mii_bus;
-	u16 r1, r2, page;
-
-	split_addr((u32) reg, &r1, &r2, &page);
 
 	mutex_lock(&bus->mdio_lock);
-
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
-	ar8xxx_mii_write32(priv, 0x10 | r2, r1, val);
-
+	ar8xxx_shadow_write(priv, reg, ar8xxx_shadow_index(priv, reg), val);
 	mutex_unlock(&bus->mdio_lock);
 }
 
@@ -290,25 +417,108 @@ u32
 ar8xxx_rmw(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val)
 {
 	struct mii_bus *bus = priv->mii_bus;
-	u16 r1, r2, page;
+	int idx;
 	u32 ret;
 
-	split_addr((u32) reg, &r1, &r2, &page);
-
 	mutex_lock(&bus->mdio_lock);
 
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
+	idx = ar8xxx_shadow_index(priv, reg);
+	if (idx >= 0 && test_bit(idx, priv->reg_shadow_valid)) {
+		ret = priv->reg_shadow[idx];
+		priv->mdio_stats.shadow_hits++;
+	} else {
+		ret = __ar8xxx_read(priv, reg);
+		if (idx >= 0) {
+			priv->reg_shadow[idx] = ret;
+			set_bit(idx, priv->reg_shadow_valid);
+		}
+	}
 
-	ret = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
 	ret &= ~mask;
 	ret |= val;
-	ar8xxx_mii_write32(priv, 0x10 | r2, r1, ret);
+	ar8xxx_shadow_write(priv, reg, idx, ret);
 
 	mutex_unlock(&bus->mdio_lock);
 
 	return ret;
 }
+
+/* forget the selected page and shadowed values, e.g. after a chip reset */
+void
+ar8xxx_reg_shadow_reset(struct ar8xxx_priv *priv)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	mutex_lock(&bus->mdio_lock);
+	priv->cur_page = -1;
+	bitmap_zero(priv->reg_shadow_valid, AR8XXX_MAX_SHADOW_REGS);
+	bitmap_zero(priv->reg_shadow_dirty, AR8XXX_MAX_SHADOW_REGS);
+	mutex_unlock(&bus->mdio_lock);
+}
+
+/*
+ * Defer writes to shadowed registers until ar8xxx_reg_batch_end(), so that
+ * repeated read-modify-writes of the same register during a config apply
+ * only reach the bus once, with all writes to one page done back to back.
+ */
+void
+ar8xxx_reg_batch_begin(struct ar8xxx_priv *priv)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	mutex_lock(&bus->mdio_lock);
+	priv->reg_batch = true;
+	mutex_unlock(&bus->mdio_lock);
+}
+
+void
+ar8xxx_reg_batch_end(struct ar8xxx_priv *priv)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	mutex_lock(&bus->mdio_lock);
+	priv->reg_batch = false;
+	ar8xxx_shadow_flush(priv);
+	mutex_unlock(&bus->mdio_lock);
+}
+
+static void
+ar8xxx_mdio_op_begin(struct ar8xxx_priv *priv, struct ar8xxx_mdio_stats *start,
+		     ktime_t *t)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	mutex_lock(&bus->mdio_lock);
+	*start = priv->mdio_stats;
+	mutex_unlock(&bus->mdio_lock);
+	*t = ktime_get();
+}
+
+/* the deltas include concurrent traffic from other operations, if any */
+static void
+ar8xxx_mdio_op_end(struct ar8xxx_priv *priv, enum ar8xxx_mdio_op op,
+		   const struct ar8xxx_mdio_stats *start, ktime_t t)
+{
+	struct ar8xxx_mdio_op_stats *s = &priv->mdio_op_stats[op];
+	struct mii_bus *bus = priv->mii_bus;
+	struct ar8xxx_mdio_stats *cur = &priv->mdio_stats;
+
+	mutex_lock(&bus->mdio_lock);
+	s->calls++;
+	s->last_usecs = ktime_us_delta(ktime_get(), t);
+	s->last.reads = cur->reads - start->reads;
+	s->last.writes = cur->writes - start->writes;
+	s->last.page_skips = cur->page_skips - start->page_skips;
+	s->last.shadow_hits = cur->shadow_hits - start->shadow_hits;
+	s->last.writes_elided = cur->writes_elided - start->writes_elided;
+	s->total.reads += s->last.reads;
+	s->total.writes += s->last.writes;
+	s->total.page_skips += s->last.page_skips;
+	s->total.shadow_hits += s->last.shadow_hits;
+	s->total.writes_elided += s->last.writes_elided;
+	mutex_unlock(&bus->mdio_lock);
+}
+
 void
 ar8xxx_phy_dbg_read(struct ar8xxx_priv *priv, int phy_addr,
            u16 dbg_addr, u16 *dbg_data)
@@ -411,7 +621,13 @@ out:
 static int
 ar8xxx_mib_capture(struct ar8xxx_priv *priv)
 {
-	return ar8xxx_mib_op(priv, AR8216_MIB_FUNC_CAPTURE);
+	int ret;
+
+	ret = ar8xxx_mib_op(priv, AR8216_MIB_FUNC_CAPTURE);
+	if (!ret)
+		priv->mib_gen++;
+
+	return ret;
 }
 
 static int
@@ -425,6 +641,7 @@ ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 {
 	unsigned int base;
 	u64 *mib_stats;
+	u32 *mib_changed;
 	int i;
 
 	WARN_ON(port >= priv->dev.ports);
@@ -435,6 +652,7 @@ ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 	       priv->chip->reg_port_stats_length * port;
 
 	mib_stats = &priv->mib_stats[port * priv->chip->num_mibs];
+	mib_changed = &priv->mib_changed[port * priv->chip->num_mibs];
 	for (i = 0; i < priv->chip->num_mibs; i++) {
 		const struct ar8xxx_mib_desc *mib;
 		u64 t;
@@ -454,6 +672,8 @@ ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 			mib_stats[i] = 0;
 		else
 			mib_stats[i] += t;
+		if (flush || t)
+			mib_changed[i] = priv->mib_gen;
 		cond_resched();
 	}
 }
@@ -725,6 +945,7 @@ ar8216_hw_init(struct ar8xxx_priv *priv)
 
 	ar8xxx_write(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET);
 	ar8xxx_reg_wait(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET, 0, 1000);
+	ar8xxx_reg_shadow_reset(priv);
 
 	ar8xxx_phy_init(priv);
 
@@ -792,7 +1013,6 @@ ar8216_wait_atu_ready(struct ar8xxx_priv *priv, u16 r2, u16 r1)
 static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 				 struct arl_entry *a, u32 *status, enum arl_op op)
 {
-	struct mii_bus *bus = priv->mii_bus;
 	u16 r2, page;
 	u16 r1_func0, r1_func1, r1_func2;
 	u32 t, val0, val1, val2;
@@ -805,17 +1025,33 @@ static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 
 	switch (op) {
 	case AR8XXX_ARL_INITIALIZE:
+	case AR8XXX_ARL_SEEK:
 		/* all ATU registers are on the same page
 		* therefore set page only once
 		*/
-		bus->write(bus, 0x18, 0, page);
-		wait_for_page_switch();
+		ar8xxx_select_page(priv, page);
 
 		ar8216_wait_atu_ready(priv, r2, r1_func0);
 
-		ar8xxx_mii_write32(priv, r2, r1_func0, AR8216_ATU_OP_GET_NEXT);
-		ar8xxx_mii_write32(priv, r2, r1_func1, 0);
-		ar8xxx_mii_write32(priv, r2, r1_func2, 0);
+		val0 = AR8216_ATU_OP_GET_NEXT;
+		val1 = 0;
+		val2 = 0;
+		if (op == AR8XXX_ARL_SEEK) {
+			val0 |= ((u32) a->mac[0] << AR8216_ATU_ADDR5_S) |
+				((u32) a->mac[1] << AR8216_ATU_ADDR4_S);
+			val1 = ((u32) a->mac[2] << AR8216_ATU_ADDR3_S) |
+			       ((u32) a->mac[3] << AR8216_ATU_ADDR2_S) |
+			       ((u32) a->mac[4] << AR8216_ATU_ADDR1_S) |
+			       ((u32) a->mac[5] << AR8216_ATU_ADDR0_S);
+			val2 = ((a->portmap << AR8216_ATU_PORTS_S) &
+				AR8216_ATU_PORTS) |
+			       ((a->status << AR8216_ATU_STATUS_S) &
+				AR8216_ATU_STATUS);
+		}
+
+		ar8xxx_mii_write32(priv, r2, r1_func0, val0);
+		ar8xxx_mii_write32(priv, r2, r1_func1, val1);
+		ar8xxx_mii_write32(priv, r2, r1_func2, val2);
 		break;
 	case AR8XXX_ARL_GET_NEXT:
 		t = ar8xxx_mii_read32(priv, r2, r1_func0);
@@ -832,6 +1068,8 @@ static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 			break;
 
 		a->portmap = (val2 & AR8216_ATU_PORTS) >> AR8216_ATU_PORTS_S;
+		a->status = *status;
+		a->vid = 0;
 		a->mac[0] = (val0 & AR8216_ATU_ADDR5) >> AR8216_ATU_ADDR5_S;
 		a->mac[1] = (val0 & AR8216_ATU_ADDR4) >> AR8216_ATU_ADDR4_S;
 		a->mac[2] = (val1 & AR8216_ATU_ADDR3) >> AR8216_ATU_ADDR3_S;
@@ -902,6 +1140,7 @@ ar8229_hw_init(struct ar8xxx_priv *priv)
 
 	ar8xxx_write(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET);
 	ar8xxx_reg_wait(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET, 0, 1000);
+	ar8xxx_reg_shadow_reset(priv);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
 	of_get_phy_mode(priv->pdev->of_node, &phy_if_mode);
@@ -991,6 +1230,7 @@ ar7240sw_hw_init(struct ar8xxx_priv *priv)
 
 	ar8xxx_write(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET);
 	ar8xxx_reg_wait(priv, AR8216_REG_CTRL, AR8216_CTRL_RESET, 0, 1000);
+	ar8xxx_reg_shadow_reset(priv);
 
 	priv->port4_phy = 1;
 	/* disable port5 to prevent mii conflict */
@@ -1366,10 +1606,15 @@ ar8xxx_sw_hw_apply(struct switch_dev *dev)
 {
 	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
 	const struct ar8xxx_chip *chip = priv->chip;
+	struct ar8xxx_mdio_stats start;
 	u8 portmask[AR8X16_MAX_PORTS];
+	ktime_t t;
 	int i, j;
 
 	mutex_lock(&priv->reg_mutex);
+	ar8xxx_mdio_op_begin(priv, &start, &t);
+	ar8xxx_reg_batch_begin(priv);
+
 	/* flush all vlan translation unit entries */
 	priv->chip->vtu_flush(priv);
 
@@ -1415,6 +1660,8 @@ ar8xxx_sw_hw_apply(struct switch_dev *dev)
 	if (chip->reg_arl_ctrl)
 		ar8xxx_set_age_time(priv, chip->reg_arl_ctrl);
 
+	ar8xxx_reg_batch_end(priv);
+	ar8xxx_mdio_op_end(priv, AR8XXX_MDIO_OP_APPLY, &start, t);
 	mutex_unlock(&priv->reg_mutex);
 	return 0;
 }
@@ -1424,9 +1671,12 @@ ar8xxx_sw_reset_switch(struct switch_dev *dev)
 {
 	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
 	const struct ar8xxx_chip *chip = priv->chip;
+	struct ar8xxx_mdio_stats start;
+	ktime_t t;
 	int i;
 
 	mutex_lock(&priv->reg_mutex);
+	ar8xxx_mdio_op_begin(priv, &start, &t);
 	memset(&priv->vlan, 0, sizeof(struct ar8xxx_priv) -
 		offsetof(struct ar8xxx_priv, vlan));
 
@@ -1446,6 +1696,7 @@ ar8xxx_sw_reset_switch(struct switch_dev *dev)
 	chip->init_globals(priv);
 	chip->atu_flush(priv);
 
+	ar8xxx_mdio_op_end(priv, AR8XXX_MDIO_OP_RESET, &start, t);
 	mutex_unlock(&priv->reg_mutex);
 
 	return chip->sw_hw_apply(dev);
@@ -1459,6 +1710,7 @@ ar8xxx_sw_set_reset_mibs(struct switch_dev *dev,
 	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
 	unsigned int len;
 	int ret;
+	int i;
 
 	if (!ar8xxx_has_mib_counters(priv))
 		return -EOPNOTSUPP;
@@ -1468,6 +1720,9 @@ ar8xxx_sw_set_reset_mibs(struct switch_dev *dev,
 	len = priv->dev.ports * priv->chip->num_mibs *
 	      sizeof(*priv->mib_stats);
 	memset(priv->mib_stats, '\0', len);
+	priv->mib_gen++;
+	for (i = 0; i < priv->dev.ports * priv->chip->num_mibs; i++)
+		priv->mib_changed[i] = priv->mib_gen;
 	ret = ar8xxx_mib_flush(priv);
 	if (ret)
 		goto unlock;
@@ -1795,12 +2050,15 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 	char *buf = priv->arl_buf;
 	int i, j, k, len = 0;
 	struct arl_entry *a, *a1;
+	struct ar8xxx_mdio_stats start;
+	ktime_t t;
 	u32 status;
 
 	if (!chip->get_arl_entry)
 		return -EOPNOTSUPP;
 
 	mutex_lock(&priv->reg_mutex);
+	ar8xxx_mdio_op_begin(priv, &start, &t);
 	mutex_lock(&bus->mdio_lock);
 
 	chip->get_arl_entry(priv, NULL, NULL, AR8XXX_ARL_INITIALIZE);
@@ -1829,6 +2087,7 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 	}
 
 	mutex_unlock(&bus->mdio_lock);
+	ar8xxx_mdio_op_end(priv, AR8XXX_MDIO_OP_ARL, &start, t);
 
 	len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
                         "address resolution table\n");
@@ -1859,6 +2118,56 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 	return 0;
 }
 
+int
+ar8xxx_sw_get_arl_entries(struct switch_dev *dev,
+			  const struct switch_arl_entry *cursor,
+			  struct switch_arl_entry *entries, unsigned int max)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	struct mii_bus *bus = priv->mii_bus;
+	const struct ar8xxx_chip *chip = priv->chip;
+	struct ar8xxx_mdio_stats start;
+	struct switch_arl_entry *e;
+	struct arl_entry a;
+	unsigned int n = 0;
+	u32 status;
+	ktime_t t;
+
+	if (!chip->get_arl_entry)
+		return -EOPNOTSUPP;
+
+	memcpy(a.mac, cursor->mac, sizeof(a.mac));
+	a.vid = cursor->vid;
+	a.portmap = cursor->portmap;
+	a.status = cursor->age;
+
+	mutex_lock(&priv->reg_mutex);
+	ar8xxx_mdio_op_begin(priv, &start, &t);
+	mutex_lock(&bus->mdio_lock);
+
+	chip->get_arl_entry(priv, &a, NULL, AR8XXX_ARL_SEEK);
+	while (n < max) {
+		chip->get_arl_entry(priv, &a, &status, AR8XXX_ARL_GET_NEXT);
+		if (!status)
+			break;
+
+		e = &entries[n++];
+		memset(e, 0, sizeof(*e));
+		memcpy(e->mac, a.mac, sizeof(e->mac));
+		e->vid = a.vid;
+		e->portmap = a.portmap;
+		e->age = a.status;
+		if (a.status == AR8XXX_ATU_STATUS_STATIC)
+			e->flags |= SWITCH_ARL_F_STATIC;
+	}
+
+	mutex_unlock(&bus->mdio_lock);
+	ar8xxx_mdio_op_end(priv, AR8XXX_MDIO_OP_ARL, &start, t);
+	mutex_unlock(&priv->reg_mutex);
+
+	return n;
+}
+
 int
 ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 			      const struct switch_attr *attr,
@@ -1920,6 +2229,42 @@ ar8xxx_sw_get_port_stats(struct switch_dev *dev, int port,
 	return 0;
 }
 
+int
+ar8xxx_sw_get_port_mib_counters(struct switch_dev *dev, int port,
+				u64 *values, u32 *changed, u32 *generation)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	unsigned int num_mibs = priv->chip->num_mibs;
+
+	/* only hand out what the periodic MIB work has already collected */
+	if (!ar8xxx_has_mib_counters(priv) || !priv->mib_poll_interval)
+		return -EOPNOTSUPP;
+
+	if (port >= dev->ports)
+		return -EINVAL;
+
+	mutex_lock(&priv->mib_lock);
+	memcpy(values, &priv->mib_stats[port * num_mibs],
+	       num_mibs * sizeof(*values));
+	memcpy(changed, &priv->mib_changed[port * num_mibs],
+	       num_mibs * sizeof(*changed));
+	*generation = priv->mib_gen;
+	mutex_unlock(&priv->mib_lock);
+
+	return 0;
+}
+
+const char *
+ar8xxx_sw_get_mib_name(struct switch_dev *dev, int idx)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+
+	if (idx >= priv->chip->num_mibs)
+		return NULL;
+
+	return priv->chip->mib_decs[idx].name;
+}
+
 static int
 ar8xxx_phy_read(struct mii_bus *bus, int phy_addr, int reg_addr)
 {
@@ -2065,6 +2410,22 @@ static const struct switch_dev_ops ar8xxx_sw_ops = {
 	.reset_switch = ar8xxx_sw_reset_switch,
 	.get_port_link = ar8xxx_sw_get_port_link,
 	.get_port_stats = ar8xxx_sw_get_port_stats,
+	.get_port_mib = ar8xxx_sw_get_port_mib_counters,
+	.get_mib_name = ar8xxx_sw_get_mib_name,
+	.get_arl_entries = ar8xxx_sw_get_arl_entries,
+};
+
+static const struct ar8xxx_reg_range ar8216_shadow_regs[] = {
+	AR8XXX_REG_RANGE(AR8216_REG_GLOBAL_CPUPORT, 4, 1),
+	AR8XXX_REG_RANGE(AR8216_REG_PORT_CTRL(0), 0x100, AR8216_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8216_REG_PORT_VLAN(0), 0x100, AR8216_NUM_PORTS),
+};
+
+static const struct ar8xxx_reg_range ar8236_shadow_regs[] = {
+	AR8XXX_REG_RANGE(AR8216_REG_GLOBAL_CPUPORT, 4, 1),
+	AR8XXX_REG_RANGE(AR8216_REG_PORT_CTRL(0), 0x100, AR8216_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8236_REG_PORT_VLAN(0), 0x100, AR8216_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8236_REG_PORT_VLAN2(0), 0x100, AR8216_NUM_PORTS),
 };
 
 static const struct ar8xxx_chip ar7240sw_chip = {
@@ -2099,6 +2460,9 @@ static const struct ar8xxx_chip ar7240sw_chip = {
 	.mib_func = AR8216_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8216_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8216_shadow_regs),
 };
 
 static const struct ar8xxx_chip ar8216_chip = {
@@ -2131,6 +2495,9 @@ static const struct ar8xxx_chip ar8216_chip = {
 	.mib_func = AR8216_REG_MIB_FUNC,
 	.mib_rxb_id = AR8216_MIB_RXB_ID,
 	.mib_txb_id = AR8216_MIB_TXB_ID,
+
+	.shadow_regs = ar8216_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8216_shadow_regs),
 };
 
 static const struct ar8xxx_chip ar8229_chip = {
@@ -2165,6 +2532,9 @@ static const struct ar8xxx_chip ar8229_chip = {
 	.mib_func = AR8216_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8236_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8236_shadow_regs),
 };
 
 static const struct ar8xxx_chip ar8236_chip = {
@@ -2197,6 +2567,9 @@ static const struct ar8xxx_chip ar8236_chip = {
 	.mib_func = AR8216_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8236_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8236_shadow_regs),
 };
 
 static const struct ar8xxx_chip ar8316_chip = {
@@ -2229,6 +2602,9 @@ static const struct ar8xxx_chip ar8316_chip = {
 	.mib_func = AR8216_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8216_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8216_shadow_regs),
 };
 
 static int
@@ -2299,11 +2675,14 @@ static void
 ar8xxx_mib_work_func(struct work_struct *work)
 {
 	struct ar8xxx_priv *priv;
+	struct ar8xxx_mdio_stats start;
+	ktime_t t;
 	int err, i;
 
 	priv = container_of(work, struct ar8xxx_priv, mib_work.work);
 
 	mutex_lock(&priv->mib_lock);
+	ar8xxx_mdio_op_begin(priv, &start, &t);
 
 	err = ar8xxx_mib_capture(priv);
 	if (err)
@@ -2312,6 +2691,8 @@ ar8xxx_mib_work_func(struct work_struct *work)
 	for (i = 0; i < priv->dev.ports; i++)
 		ar8xxx_mib_fetch_port_stat(priv, i, false);
 
+	ar8xxx_mdio_op_end(priv, AR8XXX_MDIO_OP_MIB, &start, t);
+
 next_attempt:
 	mutex_unlock(&priv->mib_lock);
 	schedule_delayed_work(&priv->mib_work,
@@ -2335,6 +2716,14 @@ ar8xxx_mib_init(struct ar8xxx_priv *priv)
 	if (!priv->mib_stats)
 		return -ENOMEM;
 
+	priv->mib_changed = kcalloc(priv->dev.ports * priv->chip->num_mibs,
+				    sizeof(*priv->mib_changed), GFP_KERNEL);
+	if (!priv->mib_changed)
+		return -ENOMEM;
+
+	priv->dev.mibs = priv->chip->num_mibs;
+	priv->dev.stats_snapshot = true;
+
 	return 0;
 }
 
@@ -2357,6 +2746,86 @@ ar8xxx_mib_stop(struct ar8xxx_priv *priv)
 	cancel_delayed_work_sync(&priv->mib_work);
 }
 
+static struct dentry *ar8xxx_debugfs_root;
+
+#ifdef CONFIG_DEBUG_FS
+static void
+ar8xxx_mdio_stats_show(struct seq_file *m, const char *name,
+		       const struct ar8xxx_mdio_stats *st)
+{
+	seq_printf(m, "%-12s %10llu %10llu %10llu %10llu %10llu\n", name,
+		   st->reads, st->writes, st->page_skips, st->shadow_hits,
+		   st->writes_elided);
+}
+
+static int
+ar8xxx_mdio_debugfs_show(struct seq_file *m, void *unused)
+{
+	static const char * const op_names[AR8XXX_MDIO_OP_MAX] = {
+		[AR8XXX_MDIO_OP_APPLY] = "apply",
+		[AR8XXX_MDIO_OP_RESET] = "reset",
+		[AR8XXX_MDIO_OP_MIB] = "mib",
+		[AR8XXX_MDIO_OP_ARL] = "arl",
+	};
+	struct ar8xxx_priv *priv = m->private;
+	struct mii_bus *bus = priv->mii_bus;
+	struct ar8xxx_mdio_op_stats *s;
+	char name[16];
+	int i;
+
+	mutex_lock(&bus->mdio_lock);
+
+	seq_printf(m, "%-12s %10s %10s %10s %10s %10s\n", "",
+		   "reads", "writes", "page_skips", "shadowed", "elided");
+	ar8xxx_mdio_stats_show(m, "total", &priv->mdio_stats);
+
+	for (i = 0; i < AR8XXX_MDIO_OP_MAX; i++) {
+		s = &priv->mdio_op_stats[i];
+		if (!s->calls)
+			continue;
+
+		snprintf(name, sizeof(name), "%s/last", op_names[i]);
+		ar8xxx_mdio_stats_show(m, name, &s->last);
+		snprintf(name, sizeof(name), "%s/total", op_names[i]);
+		ar8xxx_mdio_stats_show(m, name, &s->total);
+	}
+
+	seq_puts(m, "\n");
+	for (i = 0; i < AR8XXX_MDIO_OP_MAX; i++) {
+		s = &priv->mdio_op_stats[i];
+		seq_printf(m, "%s: calls %u last_us %u\n", op_names[i],
+			   s->calls, s->last_usecs);
+	}
+
+	mutex_unlock(&bus->mdio_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ar8xxx_mdio_debugfs);
+
+static void
+ar8xxx_debugfs_init(struct ar8xxx_priv *priv)
+{
+	priv->debugfs = debugfs_create_dir(priv->dev.devname,
+					   ar8xxx_debugfs_root);
+	debugfs_create_file("mdio", 0444, priv->debugfs, priv,
+			    &ar8xxx_mdio_debugfs_fops);
+}
+
+static void
+ar8xxx_debugfs_remove(struct ar8xxx_priv *priv)
+{
+	debugfs_remove_recursive(priv->debugfs);
+	priv->debugfs = NULL;
+}
+#else
+static inline void
+ar8xxx_debugfs_init(struct ar8xxx_priv *priv) { }
+
+static inline void
+ar8xxx_debugfs_remove(struct ar8xxx_priv *priv) { }
+#endif
+
 static struct ar8xxx_priv *
 ar8xxx_create(void)
 {
@@ -2369,6 +2838,7 @@ ar8xxx_create(void)
 	mutex_init(&priv->reg_mutex);
 	mutex_init(&priv->mib_lock);
 	INIT_DELAYED_WORK(&priv->mib_work, ar8xxx_mib_work_func);
+	priv->cur_page = -1;
 
 	return priv;
 }
@@ -2376,11 +2846,14 @@ ar8xxx_create(void)
 static void
 ar8xxx_free(struct ar8xxx_priv *priv)
 {
+	ar8xxx_debugfs_remove(priv);
+
 	if (priv->chip && priv->chip->cleanup)
 		priv->chip->cleanup(priv);
 
 	kfree(priv->chip_data);
 	kfree(priv->mib_stats);
+	kfree(priv->mib_changed);
 	kfree(priv);
 }
 
@@ -2389,6 +2862,7 @@ ar8xxx_probe_switch(struct ar8xxx_priv *priv)
 {
 	const struct ar8xxx_chip *chip;
 	struct switch_dev *swdev;
+	unsigned int i, size = 0;
 	int ret;
 
 	chip = priv->chip;
@@ -2400,6 +2874,11 @@ ar8xxx_probe_switch(struct ar8xxx_priv *priv)
 	swdev->ports = chip->ports;
 	swdev->ops = chip->swops;
 
+	for (i = 0; i < chip->num_shadow_regs; i++)
+		size += chip->shadow_regs[i].count;
+	if (!WARN_ON(size > AR8XXX_MAX_SHADOW_REGS))
+		priv->reg_shadow_size = size;
+
 	ret = ar8xxx_mib_init(priv);
 	if (ret)
 		return ret;
@@ -2413,6 +2892,7 @@ ar8xxx_start(struct ar8xxx_priv *priv)
 	int ret;
 
 	priv->init = true;
+	ar8xxx_reg_shadow_reset(priv);
 
 	ret = priv->chip->hw_init(priv);
 	if (ret)
@@ -2662,6 +3142,8 @@ ar8xxx_phy_probe(struct phy_device *phydev)
 		swdev->devname, swdev->name, priv->chip_rev,
 		dev_name(&priv->mii_bus->dev));
 
+	ar8xxx_debugfs_init(priv);
+
 	list_add(&priv->list, &ar8xxx_dev_list);
 
 found:
@@ -2838,6 +3320,8 @@ ar8xxx_mdiodev_probe(struct mdio_device *mdiodev)
 		swdev->devname, swdev->name, priv->chip_rev,
 		dev_name(&priv->mii_bus->dev));
 
+	ar8xxx_debugfs_init(priv);
+
 	mutex_lock(&ar8xxx_dev_list_lock);
 	list_add(&priv->list, &ar8xxx_dev_list);
 	mutex_unlock(&ar8xxx_dev_list_lock);
@@ -2901,17 +3385,25 @@ static int __init ar8216_init(void)
 {
 	int ret;
 
+	ar8xxx_debugfs_root = debugfs_create_dir("ar8xxx", NULL);
+
 	ret = phy_drivers_register(ar8xxx_phy_driver,
 				   ARRAY_SIZE(ar8xxx_phy_driver),
 				   THIS_MODULE);
 	if (ret)
-		return ret;
+		goto err;
 
 	ret = mdio_driver_register(&ar8xxx_mdio_driver);
 	if (ret)
-		phy_drivers_unregister(ar8xxx_phy_driver,
-				       ARRAY_SIZE(ar8xxx_phy_driver));
+		goto err_phy;
 
+	return 0;
+
+err_phy:
+	phy_drivers_unregister(ar8xxx_phy_driver,
+			       ARRAY_SIZE(ar8xxx_phy_driver));
+err:
+	debugfs_remove_recursive(ar8xxx_debugfs_root);
 	return ret;
 }
 module_init(ar8216_init);
@@ -2921,6 +3413,7 @@ static void __exit ar8216_exit(void)
 	mdio_driver_unregister(&ar8xxx_mdio_driver);
 	phy_drivers_unregister(ar8xxx_phy_driver,
 			        ARRAY_SIZE(ar8xxx_phy_driver));
+	debugfs_remove_recursive(ar8xxx_debugfs_root);
 }
 module_exit(ar8216_exit);
 
@@ -410,12 +410,18 @@ enum {
 
 enum arl_op {
 	AR8XXX_ARL_INITIALIZE,
-	AR8XXX_ARL_GET_NEXT
+	AR8XXX_ARL_GET_NEXT,
+	/* continue the walk after the given entry */
+	AR8XXX_ARL_SEEK
 };
 
+#define AR8XXX_ATU_STATUS_STATIC	0xf
+
 struct arl_entry {
 	u16 portmap;
 	u8 mac[6];
+	u16 vid;
+	u8 status;
 };
 
 struct ar8xxx_priv;
@@ -427,6 +433,41 @@ struct ar8xxx_mib_desc {
 	u8 type;
 };
 
+/* a run of registers that are only ever changed by the driver */
+struct ar8xxx_reg_range {
+	u16 start;
+	u16 stride;
+	u16 count;
+};
+
+#define AR8XXX_REG_RANGE(_start, _stride, _count) \
+	{ .start = (_start), .stride = (_stride), .count = (_count) }
+
+#define AR8XXX_MAX_SHADOW_REGS	48
+
+struct ar8xxx_mdio_stats {
+	u64 reads;		/* 16-bit MDIO reads */
+	u64 writes;		/* 16-bit MDIO writes, including page selects */
+	u64 page_skips;		/* page selects elided */
+	u64 shadow_hits;	/* register reads served from the shadow */
+	u64 writes_elided;	/* register writes dropped as unchanged */
+};
+
+enum ar8xxx_mdio_op {
+	AR8XXX_MDIO_OP_APPLY,
+	AR8XXX_MDIO_OP_RESET,
+	AR8XXX_MDIO_OP_MIB,
+	AR8XXX_MDIO_OP_ARL,
+	AR8XXX_MDIO_OP_MAX,
+};
+
+struct ar8xxx_mdio_op_stats {
+	u32 calls;
+	u32 last_usecs;
+	struct ar8xxx_mdio_stats last;
+	struct ar8xxx_mdio_stats total;
+};
+
 struct ar8xxx_chip {
 	unsigned long caps;
 	bool config_at_probe;
@@ -469,6 +510,9 @@ struct ar8xxx_chip {
 	unsigned mib_func;
 	int mib_rxb_id;
 	int mib_txb_id;
+
+	const struct ar8xxx_reg_range *shadow_regs;
+	unsigned num_shadow_regs;
 };
 
 struct ar8xxx_priv {
@@ -499,9 +543,26 @@ struct ar8xxx_priv {
 	struct mutex mib_lock;
 	struct delayed_work mib_work;
 	u64 *mib_stats;
+	u32 *mib_changed;
+	u32 mib_gen;
 	u32 mib_poll_interval;
 	u8 mib_type;
 
+	/*
+	 * MDIO access state, protected by mii_bus->mdio_lock: the page
+	 * currently selected on the switch (-1 if unknown) and the shadow
+	 * of the chip's shadow_regs.
+	 */
+	int cur_page;
+	unsigned int reg_shadow_size;
+	bool reg_batch;
+	u32 reg_shadow[AR8XXX_MAX_SHADOW_REGS];
+	DECLARE_BITMAP(reg_shadow_valid, AR8XXX_MAX_SHADOW_REGS);
+	DECLARE_BITMAP(reg_shadow_dirty, AR8XXX_MAX_SHADOW_REGS);
+	struct ar8xxx_mdio_stats mdio_stats;
+	struct ar8xxx_mdio_op_stats mdio_op_stats[AR8XXX_MDIO_OP_MAX];
+	struct dentry *debugfs;
+
 	struct list_head list;
 	unsigned int use_count;
 
@@ -532,6 +593,14 @@ void
 ar8xxx_write(struct ar8xxx_priv *priv, int reg, u32 val);
 u32
 ar8xxx_rmw(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val);
+void
+ar8xxx_select_page(struct ar8xxx_priv *priv, u16 page);
+void
+ar8xxx_reg_shadow_reset(struct ar8xxx_priv *priv);
+void
+ar8xxx_reg_batch_begin(struct ar8xxx_priv *priv);
+void
+ar8xxx_reg_batch_end(struct ar8xxx_priv *priv);
 
 void
 ar8xxx_phy_dbg_read(struct ar8xxx_priv *priv, int phy_addr,
@@ -635,6 +704,10 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 			const struct switch_attr *attr,
 			struct switch_val *val);
 int
+ar8xxx_sw_get_arl_entries(struct switch_dev *dev,
+			  const struct switch_arl_entry *cursor,
+			  struct switch_arl_entry *entries, unsigned int max);
+int
 ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 			      const struct switch_attr *attr,
 			      struct switch_val *val);
@@ -646,6 +719,11 @@ int
 ar8xxx_sw_get_port_stats(struct switch_dev *dev, int port,
 			struct switch_port_stats *stats);
 int
+ar8xxx_sw_get_port_mib_counters(struct switch_dev *dev, int port,
+				u64 *values, u32 *changed, u32 *generation);
+const char *
+ar8xxx_sw_get_mib_name(struct switch_dev *dev, int idx);
+int
 ar8216_wait_bit(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val);
 
 static inline struct ar8xxx_priv *
@@ -1097,7 +1097,6 @@ ar8327_wait_atu_ready(struct ar8xxx_priv *priv, u16 r2, u16 r1)
 static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 				 struct arl_entry *a, u32 *status, enum arl_op op)
 {
-	struct mii_bus *bus = priv->mii_bus;
 	u16 r2, page;
 	u16 r1_data0, r1_data1, r1_data2, r1_func;
 	u32 val0, val1, val2;
@@ -1111,17 +1110,34 @@ static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 
 	switch (op) {
 	case AR8XXX_ARL_INITIALIZE:
+	case AR8XXX_ARL_SEEK:
 		/* all ATU registers are on the same page
 		* therefore set page only once
 		*/
-		bus->write(bus, 0x18, 0, page);
-		wait_for_page_switch();
+		ar8xxx_select_page(priv, page);
 
 		ar8327_wait_atu_ready(priv, r2, r1_func);
 
-		ar8xxx_mii_write32(priv, r2, r1_data0, 0);
-		ar8xxx_mii_write32(priv, r2, r1_data1, 0);
-		ar8xxx_mii_write32(priv, r2, r1_data2, 0);
+		val0 = 0;
+		val1 = 0;
+		val2 = 0;
+		/* GET_NEXT searches from the entry held in the data registers */
+		if (op == AR8XXX_ARL_SEEK) {
+			val0 = ((u32) a->mac[0] << AR8327_ATU_ADDR0_S) |
+			       ((u32) a->mac[1] << AR8327_ATU_ADDR1_S) |
+			       ((u32) a->mac[2] << AR8327_ATU_ADDR2_S) |
+			       ((u32) a->mac[3] << AR8327_ATU_ADDR3_S);
+			val1 = ((u32) a->mac[4] << AR8327_ATU_ADDR4_S) |
+			       ((u32) a->mac[5] << AR8327_ATU_ADDR5_S) |
+			       ((a->portmap << AR8327_ATU_PORTS_S) &
+				AR8327_ATU_PORTS);
+			val2 = ((a->vid << AR8327_ATU_VID_S) & AR8327_ATU_VID) |
+			       (a->status & AR8327_ATU_STATUS);
+		}
+
+		ar8xxx_mii_write32(priv, r2, r1_data0, val0);
+		ar8xxx_mii_write32(priv, r2, r1_data1, val1);
+		ar8xxx_mii_write32(priv, r2, r1_data2, val2);
 		break;
 	case AR8XXX_ARL_GET_NEXT:
 		ar8xxx_mii_write32(priv, r2, r1_func,
@@ -1138,6 +1154,8 @@ static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 			break;
 
 		a->portmap = (val1 & AR8327_ATU_PORTS) >> AR8327_ATU_PORTS_S;
+		a->vid = (val2 & AR8327_ATU_VID) >> AR8327_ATU_VID_S;
+		a->status = *status;
 		a->mac[0] = (val0 & AR8327_ATU_ADDR0) >> AR8327_ATU_ADDR0_S;
 		a->mac[1] = (val0 & AR8327_ATU_ADDR1) >> AR8327_ATU_ADDR1_S;
 		a->mac[2] = (val0 & AR8327_ATU_ADDR2) >> AR8327_ATU_ADDR2_S;
@@ -1472,6 +1490,18 @@ static const struct switch_dev_ops ar8327_sw_ops = {
 	.reset_switch = ar8xxx_sw_reset_switch,
 	.get_port_link = ar8xxx_sw_get_port_link,
 	.get_port_stats = ar8xxx_sw_get_port_stats,
+	.get_port_mib = ar8xxx_sw_get_port_mib_counters,
+	.get_mib_name = ar8xxx_sw_get_mib_name,
+	.get_arl_entries = ar8xxx_sw_get_arl_entries,
+};
+
+static const struct ar8xxx_reg_range ar8327_shadow_regs[] = {
+	AR8XXX_REG_RANGE(AR8327_REG_EEE_CTRL, 4, 1),
+	AR8XXX_REG_RANGE(AR8327_REG_PORT_VLAN0(0), 8, AR8327_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8327_REG_PORT_VLAN1(0), 8, AR8327_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8327_REG_FWD_CTRL0, 4, 1),
+	AR8XXX_REG_RANGE(AR8327_REG_PORT_LOOKUP(0), 0xc, AR8327_NUM_PORTS),
+	AR8XXX_REG_RANGE(AR8327_REG_PORT_HOL_CTRL1(0), 8, AR8327_NUM_PORTS),
 };
 
 const struct ar8xxx_chip ar8327_chip = {
@@ -1509,6 +1539,9 @@ const struct ar8xxx_chip ar8327_chip = {
 	.mib_func = AR8327_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8327_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8327_shadow_regs),
 };
 
 const struct ar8xxx_chip ar8337_chip = {
@@ -1547,4 +1580,7 @@ const struct ar8xxx_chip ar8337_chip = {
 	.mib_func = AR8327_REG_MIB_FUNC,
 	.mib_rxb_id = AR8236_MIB_RXB_ID,
 	.mib_txb_id = AR8236_MIB_TXB_ID,
+
+	.shadow_regs = ar8327_shadow_regs,
+	.num_shadow_regs = ARRAY_SIZE(ar8327_shadow_regs),
 };
@@ -209,6 +209,8 @@
 #define   AR8327_ATU_PORT6			BIT(22)
 #define AR8327_REG_ATU_DATA2			0x608
 #define   AR8327_ATU_STATUS			BITS(0, 4)
+#define   AR8327_ATU_VID			BITS(8, 12)
+#define   AR8327_ATU_VID_S			8
 
 #define AR8327_REG_ATU_FUNC			0x60c
 #define   AR8327_ATU_FUNC_OP			BITS(0, 4)
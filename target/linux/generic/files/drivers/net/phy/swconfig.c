@@ -25,10 +25,13 @@
 #include <linux/switch.h>
 #include <linux/of.h>
 #include <linux/version.h>
+#include <linux/debugfs.h>
 #include <uapi/linux/mii.h>
 
 #define SWCONFIG_DEVNAME	"switch%d"
 
+static struct dentry *swconfig_debugfs_root;
+
 #include "swconfig_leds.c"
 
 MODULE_AUTHOR("Felix Fietkau <nbd@nbd.name>");
@@ -280,6 +283,12 @@ static const struct nla_policy switch_policy[SWITCH_ATTR_MAX+1] = {
 	[SWITCH_ATTR_OP_VALUE_STR] = { .type = NLA_NUL_STRING },
 	[SWITCH_ATTR_OP_VALUE_PORTS] = { .type = NLA_NESTED },
 	[SWITCH_ATTR_TYPE] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP_LIST] = { .type = NLA_NESTED },
+	[SWITCH_ATTR_OP_APPLY] = { .type = NLA_FLAG },
+	[SWITCH_ATTR_MIB_SINCE] = { .type = NLA_U32 },
+	[SWITCH_ATTR_ARL_CURSOR] = { .type = NLA_BINARY,
+				     .len = sizeof(struct switch_arl_entry) },
+	[SWITCH_ATTR_ARL_LIMIT] = { .type = NLA_U32 },
 };
 
 static const struct nla_policy port_policy[SWITCH_PORT_ATTR_MAX+1] = {
@@ -306,16 +315,11 @@ swconfig_unlock(void)
 }
 
 static struct switch_dev *
-swconfig_get_dev(struct genl_info *info)
+swconfig_get_dev_by_id(int id)
 {
 	struct switch_dev *dev = NULL;
 	struct switch_dev *p;
-	int id;
-
-	if (!info->attrs[SWITCH_ATTR_ID])
-		goto done;
 
-	id = nla_get_u32(info->attrs[SWITCH_ATTR_ID]);
 	swconfig_lock();
 	list_for_each_entry(p, &swdevs, dev_list) {
 		if (id != p->id)
@@ -329,10 +333,19 @@ swconfig_get_dev(struct genl_info *info)
 	else
 		pr_debug("device %d not found\n", id);
 	swconfig_unlock();
-done:
+
 	return dev;
 }
 
+static struct switch_dev *
+swconfig_get_dev(struct genl_info *info)
+{
+	if (!info->attrs[SWITCH_ATTR_ID])
+		return NULL;
+
+	return swconfig_get_dev_by_id(nla_get_u32(info->attrs[SWITCH_ATTR_ID]));
+}
+
 static inline void
 swconfig_put_dev(struct switch_dev *dev)
 {
@@ -494,10 +507,9 @@ out:
 }
 
 static const struct switch_attr *
-swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
+swconfig_lookup_attr(struct switch_dev *dev, int cmd, struct nlattr **attrs,
 		struct switch_val *val)
 {
-	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
 	const struct switch_attrlist *alist;
 	const struct switch_attr *attr = NULL;
 	unsigned int attr_id;
@@ -507,10 +519,10 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	unsigned long *def_active;
 	int n_def;
 
-	if (!info->attrs[SWITCH_ATTR_OP_ID])
+	if (!attrs[SWITCH_ATTR_OP_ID])
 		goto done;
 
-	switch (hdr->cmd) {
+	switch (cmd) {
 	case SWITCH_CMD_SET_GLOBAL:
 	case SWITCH_CMD_GET_GLOBAL:
 		alist = &dev->ops->attr_global;
@@ -524,9 +536,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_vlan;
 		def_active = &dev->def_vlan;
 		n_def = ARRAY_SIZE(default_vlan);
-		if (!info->attrs[SWITCH_ATTR_OP_VLAN])
+		if (!attrs[SWITCH_ATTR_OP_VLAN])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_VLAN]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_VLAN]);
 		if (val->port_vlan >= dev->vlans)
 			goto done;
 		break;
@@ -536,9 +548,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_port;
 		def_active = &dev->def_port;
 		n_def = ARRAY_SIZE(default_port);
-		if (!info->attrs[SWITCH_ATTR_OP_PORT])
+		if (!attrs[SWITCH_ATTR_OP_PORT])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_PORT]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_PORT]);
 		if (val->port_vlan >= dev->ports)
 			goto done;
 		break;
@@ -550,7 +562,7 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	if (!alist)
 		goto done;
 
-	attr_id = nla_get_u32(info->attrs[SWITCH_ATTR_OP_ID]);
+	attr_id = nla_get_u32(attrs[SWITCH_ATTR_OP_ID]);
 	if (attr_id >= SWITCH_ATTR_DEFAULTS_OFFSET) {
 		attr_id -= SWITCH_ATTR_DEFAULTS_OFFSET;
 		if (attr_id >= n_def)
@@ -623,9 +635,60 @@ swconfig_parse_link(struct sk_buff *msg, struct nlattr *nla,
 	return 0;
 }
 
+static int
+swconfig_parse_val(struct sk_buff *skb, struct switch_dev *dev,
+		struct nlattr **attrs, struct switch_val *val)
+{
+	int err = 0;
+
+	switch (val->attr->type) {
+	case SWITCH_TYPE_NOVAL:
+		break;
+	case SWITCH_TYPE_INT:
+		if (!attrs[SWITCH_ATTR_OP_VALUE_INT])
+			return -EINVAL;
+		val->value.i = nla_get_u32(attrs[SWITCH_ATTR_OP_VALUE_INT]);
+		break;
+	case SWITCH_TYPE_STRING:
+		if (!attrs[SWITCH_ATTR_OP_VALUE_STR])
+			return -EINVAL;
+		val->value.s = nla_data(attrs[SWITCH_ATTR_OP_VALUE_STR]);
+		break;
+	case SWITCH_TYPE_PORTS:
+		val->value.ports = dev->portbuf;
+		memset(dev->portbuf, 0,
+			sizeof(struct switch_port) * dev->ports);
+
+		/* TODO: implement multipart? */
+		if (attrs[SWITCH_ATTR_OP_VALUE_PORTS])
+			err = swconfig_parse_ports(skb,
+				attrs[SWITCH_ATTR_OP_VALUE_PORTS],
+				val, dev->ports);
+		else
+			val->len = 0;
+		break;
+	case SWITCH_TYPE_LINK:
+		val->value.link = &dev->linkbuf;
+		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
+
+		if (attrs[SWITCH_ATTR_OP_VALUE_LINK])
+			err = swconfig_parse_link(skb,
+						  attrs[SWITCH_ATTR_OP_VALUE_LINK],
+						  val->value.link);
+		else
+			val->len = 0;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return err;
+}
+
 static int
 swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 {
+	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
 	const struct switch_attr *attr;
 	struct switch_dev *dev;
 	struct switch_val val;
@@ -639,63 +702,116 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 
 	memset(&val, 0, sizeof(val));
-	attr = swconfig_lookup_attr(dev, info, &val);
+	attr = swconfig_lookup_attr(dev, hdr->cmd, info->attrs, &val);
 	if (!attr || !attr->set)
 		goto error;
 
-	val.attr = attr;
-	switch (attr->type) {
-	case SWITCH_TYPE_NOVAL:
-		break;
-	case SWITCH_TYPE_INT:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_INT])
-			goto error;
-		val.value.i =
-			nla_get_u32(info->attrs[SWITCH_ATTR_OP_VALUE_INT]);
-		break;
-	case SWITCH_TYPE_STRING:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_STR])
-			goto error;
-		val.value.s =
-			nla_data(info->attrs[SWITCH_ATTR_OP_VALUE_STR]);
-		break;
-	case SWITCH_TYPE_PORTS:
-		val.value.ports = dev->portbuf;
+	err = swconfig_parse_val(skb, dev, info->attrs, &val);
+	if (err < 0)
+		goto error;
+
+	err = attr->set(dev, attr, &val);
+error:
+	swconfig_put_dev(dev);
+	return err;
+}
+
+/*
+ * Batched operations: SWITCH_ATTR_OP_LIST carries a list of SWITCH_ATTR_OP
+ * entries, each holding the same attributes as a single get/set request.
+ * The group of an entry is implied by SWITCH_ATTR_OP_PORT/SWITCH_ATTR_OP_VLAN.
+ */
+static int
+swconfig_parse_op(struct sk_buff *skb, struct switch_dev *dev,
+		struct nlattr *nla, struct switch_val *val, bool set)
+{
+	struct nlattr *tb[SWITCH_ATTR_MAX + 1];
+	const struct switch_attr *attr;
+	int cmd;
+
+	if (nla_type(nla) != SWITCH_ATTR_OP)
+		return -EINVAL;
+
+	if (nla_parse_nested_deprecated(tb, SWITCH_ATTR_MAX, nla,
+			switch_policy, NULL))
+		return -EINVAL;
+
+	if (tb[SWITCH_ATTR_OP_PORT])
+		cmd = set ? SWITCH_CMD_SET_PORT : SWITCH_CMD_GET_PORT;
+	else if (tb[SWITCH_ATTR_OP_VLAN])
+		cmd = set ? SWITCH_CMD_SET_VLAN : SWITCH_CMD_GET_VLAN;
+	else
+		cmd = set ? SWITCH_CMD_SET_GLOBAL : SWITCH_CMD_GET_GLOBAL;
+
+	memset(val, 0, sizeof(*val));
+	attr = swconfig_lookup_attr(dev, cmd, tb, val);
+	if (!attr)
+		return -EINVAL;
+
+	if (set) {
+		if (!attr->set)
+			return -EOPNOTSUPP;
+
+		return swconfig_parse_val(skb, dev, tb, val);
+	}
+
+	if (!attr->get)
+		return -EOPNOTSUPP;
+
+	if (attr->type == SWITCH_TYPE_PORTS) {
+		val->value.ports = dev->portbuf;
 		memset(dev->portbuf, 0,
 			sizeof(struct switch_port) * dev->ports);
-
-		/* TODO: implement multipart? */
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_PORTS]) {
-			err = swconfig_parse_ports(skb,
-				info->attrs[SWITCH_ATTR_OP_VALUE_PORTS],
-				&val, dev->ports);
-			if (err < 0)
-				goto error;
-		} else {
-			val.len = 0;
-			err = 0;
-		}
-		break;
-	case SWITCH_TYPE_LINK:
-		val.value.link = &dev->linkbuf;
+	} else if (attr->type == SWITCH_TYPE_LINK) {
+		val->value.link = &dev->linkbuf;
 		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
+	}
 
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_LINK]) {
-			err = swconfig_parse_link(skb,
-						  info->attrs[SWITCH_ATTR_OP_VALUE_LINK],
-						  val.value.link);
-			if (err < 0)
-				goto error;
-		} else {
-			val.len = 0;
-			err = 0;
+	return 0;
+}
+
+static int
+swconfig_set_multi(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr *list = info->attrs[SWITCH_ATTR_OP_LIST];
+	struct switch_dev *dev;
+	struct switch_val val;
+	struct nlattr *nla;
+	int err = 0;
+	int rem;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (!list)
+		return -EINVAL;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	/* reject the whole batch before touching the hardware */
+	nla_for_each_nested(nla, list, rem) {
+		err = swconfig_parse_op(skb, dev, nla, &val, true);
+		if (err < 0) {
+			GENL_SET_ERR_MSG(info, "invalid switch operation");
+			goto error;
 		}
-		break;
-	default:
-		goto error;
 	}
 
-	err = attr->set(dev, attr, &val);
+	nla_for_each_nested(nla, list, rem) {
+		err = swconfig_parse_op(skb, dev, nla, &val, true);
+		if (err < 0)
+			goto error;
+
+		err = val.attr->set(dev, val.attr, &val);
+		if (err < 0)
+			goto error;
+	}
+
+	if (info->attrs[SWITCH_ATTR_OP_APPLY] && dev->ops->apply_config)
+		err = dev->ops->apply_config(dev);
+
 error:
 	swconfig_put_dev(dev);
 	return err;
@@ -837,7 +953,7 @@ swconfig_get_attr(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 
 	memset(&val, 0, sizeof(val));
-	attr = swconfig_lookup_attr(dev, info, &val);
+	attr = swconfig_lookup_attr(dev, cmd, info->attrs, &val);
 	if (!attr || !attr->get)
 		goto error;
 
@@ -907,6 +1023,128 @@ error:
 	return err;
 }
 
+static int
+swconfig_send_op(struct swconfig_callback *cb, void *arg)
+{
+	const struct switch_val *val = arg;
+	struct genl_info *info = cb->info;
+	struct sk_buff *msg = cb->msg;
+	struct nlattr *n, *p;
+	void *hdr;
+	int i;
+
+	hdr = genlmsg_put(msg, info->snd_portid, info->snd_seq, &switch_fam,
+			NLM_F_MULTI, SWITCH_CMD_GET_MULTI);
+	if (IS_ERR(hdr))
+		return -1;
+
+	if (nla_put_u32(msg, SWITCH_ATTR_OP_INDEX, cb->args[0]))
+		goto nla_put_failure;
+
+	if (cb->args[1]) {
+		if (nla_put_u32(msg, SWITCH_ATTR_OP_ERROR, -cb->args[1]))
+			goto nla_put_failure;
+		goto done;
+	}
+
+	switch (val->attr->type) {
+	case SWITCH_TYPE_INT:
+		if (nla_put_u32(msg, SWITCH_ATTR_OP_VALUE_INT, val->value.i))
+			goto nla_put_failure;
+		break;
+	case SWITCH_TYPE_STRING:
+		if (nla_put_string(msg, SWITCH_ATTR_OP_VALUE_STR, val->value.s))
+			goto nla_put_failure;
+		break;
+	case SWITCH_TYPE_PORTS:
+		n = nla_nest_start(msg, SWITCH_ATTR_OP_VALUE_PORTS);
+		if (!n)
+			goto nla_put_failure;
+		for (i = 0; i < val->len; i++) {
+			const struct switch_port *port = &val->value.ports[i];
+
+			p = nla_nest_start(msg, SWITCH_ATTR_PORT);
+			if (!p)
+				goto nla_put_failure;
+			if (nla_put_u32(msg, SWITCH_PORT_ID, port->id))
+				goto nla_put_failure;
+			if (port->flags & (1 << SWITCH_PORT_FLAG_TAGGED)) {
+				if (nla_put_flag(msg, SWITCH_PORT_FLAG_TAGGED))
+					goto nla_put_failure;
+			}
+			nla_nest_end(msg, p);
+		}
+		nla_nest_end(msg, n);
+		break;
+	case SWITCH_TYPE_LINK:
+		if (swconfig_send_link(msg, info, SWITCH_ATTR_OP_VALUE_LINK,
+				       val->value.link) < 0)
+			goto nla_put_failure;
+		break;
+	default:
+		break;
+	}
+
+done:
+	genlmsg_end(msg, hdr);
+	return msg->len;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+static int
+swconfig_get_multi(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr *list = info->attrs[SWITCH_ATTR_OP_LIST];
+	struct swconfig_callback cb;
+	struct switch_dev *dev;
+	struct switch_val val;
+	struct nlattr *nla;
+	int idx = 0;
+	int err;
+	int rem;
+
+	if (!list)
+		return -EINVAL;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	memset(&cb, 0, sizeof(cb));
+	cb.info = info;
+	cb.fill = swconfig_send_op;
+	nla_for_each_nested(nla, list, rem) {
+		/* failures are reported per entry, like a series of single gets */
+		err = swconfig_parse_op(skb, dev, nla, &val, false);
+		if (!err)
+			err = val.attr->get(dev, val.attr, &val);
+
+		cb.args[0] = idx++;
+		cb.args[1] = err < 0 ? err : 0;
+		if (swconfig_send_multipart(&cb, &val) < 0) {
+			/*
+			 * The value does not fit into a single message (e.g.
+			 * a large ARL table), report it on its own so the
+			 * caller can fall back to a single get for it.
+			 */
+			cb.args[1] = -EMSGSIZE;
+			if (swconfig_send_multipart(&cb, &val) < 0) {
+				swconfig_put_dev(dev);
+				return -ENOMEM;
+			}
+		}
+	}
+	swconfig_put_dev(dev);
+
+	if (!cb.msg)
+		return 0;
+
+	return genlmsg_reply(cb.msg, info);
+}
+
 static int
 swconfig_send_switch(struct sk_buff *msg, u32 pid, u32 seq, int flags,
 		const struct switch_dev *dev)
@@ -982,6 +1220,298 @@ static int swconfig_dump_switches(struct sk_buff *skb,
 	return skb->len;
 }
 
+static int
+swconfig_send_mib_names(struct sk_buff *msg, struct netlink_callback *cb,
+		struct switch_dev *dev)
+{
+	struct nlattr *n;
+	void *hdr;
+	int i;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			&switch_fam, NLM_F_MULTI, SWITCH_CMD_GET_PORT_MIB);
+	if (IS_ERR(hdr))
+		return -1;
+
+	n = nla_nest_start(msg, SWITCH_ATTR_MIB_NAMES);
+	if (!n)
+		goto nla_put_failure;
+	for (i = 0; i < dev->mibs; i++) {
+		const char *name = dev->ops->get_mib_name(dev, i);
+
+		if (nla_put_string(msg, SWITCH_ATTR_OP_NAME, name ? name : ""))
+			goto nla_put_failure;
+	}
+	nla_nest_end(msg, n);
+
+	genlmsg_end(msg, hdr);
+	return msg->len;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+/*
+ * In delta mode only the counters that changed after the requested
+ * generation are sent, as a list of indexes plus the matching values.
+ * Drivers that do not track changes leave changed[] at U32_MAX.
+ */
+static int
+swconfig_send_port_mib(struct sk_buff *msg, struct netlink_callback *cb,
+		struct switch_dev *dev, int port, u64 *values, u32 *changed)
+{
+	bool delta = cb->args[2];
+	u32 since = cb->args[3];
+	u32 gen = 0;
+	void *hdr;
+	int i, n;
+
+	memset(values, 0, dev->mibs * sizeof(*values));
+	memset(changed, 0xff, dev->mibs * sizeof(*changed));
+	if (dev->ops->get_port_mib(dev, port, values, changed, &gen) < 0)
+		return 0;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			&switch_fam, NLM_F_MULTI, SWITCH_CMD_GET_PORT_MIB);
+	if (IS_ERR(hdr))
+		return -1;
+
+	if (nla_put_u32(msg, SWITCH_ATTR_OP_PORT, port))
+		goto nla_put_failure;
+	if (nla_put_u32(msg, SWITCH_ATTR_MIB_GENERATION, gen))
+		goto nla_put_failure;
+
+	n = dev->mibs;
+	if (delta) {
+		/* compact in place, changed[] turns into the index list */
+		for (i = 0, n = 0; i < dev->mibs; i++) {
+			if (changed[i] != U32_MAX &&
+			    (s32)(changed[i] - since) <= 0)
+				continue;
+			values[n] = values[i];
+			changed[n] = i;
+			n++;
+		}
+
+		if (nla_put(msg, SWITCH_ATTR_MIB_INDEX, n * sizeof(*changed),
+			    changed))
+			goto nla_put_failure;
+	}
+
+	if (nla_put_64bit(msg, SWITCH_ATTR_MIB_VALUES, n * sizeof(*values),
+			  values, SWITCH_ATTR_PAD))
+		goto nla_put_failure;
+
+	genlmsg_end(msg, hdr);
+	return msg->len;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+/*
+ * Dump the binary counters of all ports: one message with the counter
+ * names (skipped in delta mode), followed by one message per port.
+ */
+static int
+swconfig_dump_port_mib(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct nlattr *tb[SWITCH_ATTR_MAX + 1];
+	struct switch_dev *dev;
+	u64 *values = NULL;
+	u32 *changed = NULL;
+	int err;
+
+	if (!cb->args[0]) {
+		err = nlmsg_parse_deprecated(cb->nlh, GENL_HDRLEN, tb,
+				SWITCH_ATTR_MAX, switch_policy, NULL);
+		if (err < 0)
+			return err;
+
+		if (!tb[SWITCH_ATTR_ID])
+			return -EINVAL;
+
+		cb->args[0] = nla_get_u32(tb[SWITCH_ATTR_ID]);
+		if (tb[SWITCH_ATTR_MIB_SINCE]) {
+			cb->args[2] = 1;
+			cb->args[3] = nla_get_u32(tb[SWITCH_ATTR_MIB_SINCE]);
+			/* no names to send */
+			cb->args[1] = 1;
+		}
+	}
+
+	dev = swconfig_get_dev_by_id(cb->args[0]);
+	if (!dev)
+		return -ENODEV;
+
+	err = -EOPNOTSUPP;
+	if (!dev->mibs || !dev->ops->get_port_mib || !dev->ops->get_mib_name)
+		goto out;
+
+	err = -ENOMEM;
+	values = kcalloc(dev->mibs, sizeof(*values), GFP_KERNEL);
+	changed = kcalloc(dev->mibs, sizeof(*changed), GFP_KERNEL);
+	if (!values || !changed)
+		goto out;
+
+	/* args[1]: 0 for the names, port + 1 afterwards */
+	for (; cb->args[1] <= dev->ports; cb->args[1]++) {
+		if (!cb->args[1])
+			err = swconfig_send_mib_names(skb, cb, dev);
+		else
+			err = swconfig_send_port_mib(skb, cb, dev,
+					cb->args[1] - 1, values, changed);
+		if (err < 0)
+			break;
+	}
+
+	err = skb->len;
+	if (!err && cb->args[1] <= dev->ports)
+		err = -EMSGSIZE;
+
+out:
+	kfree(values);
+	kfree(changed);
+	swconfig_put_dev(dev);
+	return err;
+}
+
+/* dump state, kept in cb->args */
+#define SWCONFIG_ARL_ID		0
+#define SWCONFIG_ARL_BUDGET	1	/* 0: not started, -1: end of table */
+#define SWCONFIG_ARL_CURSOR	2
+
+#define SWCONFIG_ARL_BATCH	128
+
+static int
+swconfig_send_arl(struct sk_buff *msg, struct netlink_callback *cb,
+		struct switch_dev *dev, struct switch_arl_entry *entries)
+{
+	struct switch_arl_entry *cursor = (void *) &cb->args[SWCONFIG_ARL_CURSOR];
+	long budget = cb->args[SWCONFIG_ARL_BUDGET];
+	int room, n, max;
+	bool end;
+	void *hdr;
+
+	room = skb_tailroom(msg) - GENL_HDRLEN - NLMSG_HDRLEN -
+	       2 * nla_total_size(sizeof(*cursor)) - nla_total_size(0);
+	max = min_t(long, budget, SWCONFIG_ARL_BATCH);
+	max = min_t(int, max, room / (int) sizeof(*entries));
+	if (max <= 0)
+		return -EMSGSIZE;
+
+	n = dev->ops->get_arl_entries(dev, cursor, entries, max);
+	if (n < 0)
+		return n;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			&switch_fam, NLM_F_MULTI, SWITCH_CMD_GET_ARL);
+	if (IS_ERR(hdr))
+		return -EMSGSIZE;
+
+	end = n < max;
+	if (n && nla_put(msg, SWITCH_ATTR_ARL_ENTRIES, n * sizeof(*entries),
+			 entries))
+		goto nla_put_failure;
+	if (nla_put(msg, SWITCH_ATTR_ARL_CURSOR, sizeof(*cursor),
+		    n ? &entries[n - 1] : cursor))
+		goto nla_put_failure;
+	if (end && nla_put_flag(msg, SWITCH_ATTR_ARL_END))
+		goto nla_put_failure;
+
+	genlmsg_end(msg, hdr);
+
+	/* only advance once the entries made it into the message */
+	if (n)
+		memcpy(cursor, &entries[n - 1], sizeof(*cursor));
+	budget -= n;
+	cb->args[SWCONFIG_ARL_BUDGET] = (end || !budget) ? -1 : budget;
+
+	return msg->len;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+/*
+ * Walk the address table in batches, each message carrying the entries
+ * read and the cursor to resume from. The walk stops at the end of the
+ * table or after SWITCH_ATTR_ARL_LIMIT entries; only the message for the
+ * end of the table carries SWITCH_ATTR_ARL_END. The driver only needs to
+ * lock its registers for one batch at a time.
+ */
+static int
+swconfig_dump_arl(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct switch_arl_entry *cursor = (void *) &cb->args[SWCONFIG_ARL_CURSOR];
+	struct switch_arl_entry *entries;
+	struct nlattr *tb[SWITCH_ATTR_MAX + 1];
+	struct switch_dev *dev;
+	int err;
+
+	BUILD_BUG_ON(sizeof(*cursor) >
+		     sizeof(cb->args) - SWCONFIG_ARL_CURSOR * sizeof(long));
+
+	if (!cb->args[SWCONFIG_ARL_BUDGET]) {
+		err = nlmsg_parse_deprecated(cb->nlh, GENL_HDRLEN, tb,
+				SWITCH_ATTR_MAX, switch_policy, NULL);
+		if (err < 0)
+			return err;
+
+		if (!tb[SWITCH_ATTR_ID])
+			return -EINVAL;
+
+		cb->args[SWCONFIG_ARL_ID] = nla_get_u32(tb[SWITCH_ATTR_ID]);
+		cb->args[SWCONFIG_ARL_BUDGET] = LONG_MAX;
+		if (tb[SWITCH_ATTR_ARL_LIMIT] &&
+		    nla_get_u32(tb[SWITCH_ATTR_ARL_LIMIT]) &&
+		    nla_get_u32(tb[SWITCH_ATTR_ARL_LIMIT]) < LONG_MAX)
+			cb->args[SWCONFIG_ARL_BUDGET] =
+				nla_get_u32(tb[SWITCH_ATTR_ARL_LIMIT]);
+
+		if (tb[SWITCH_ATTR_ARL_CURSOR]) {
+			if (nla_len(tb[SWITCH_ATTR_ARL_CURSOR]) != sizeof(*cursor))
+				return -EINVAL;
+			nla_memcpy(cursor, tb[SWITCH_ATTR_ARL_CURSOR],
+				   sizeof(*cursor));
+		}
+	}
+
+	if (cb->args[SWCONFIG_ARL_BUDGET] < 0)
+		return 0;
+
+	dev = swconfig_get_dev_by_id(cb->args[SWCONFIG_ARL_ID]);
+	if (!dev)
+		return -ENODEV;
+
+	err = -EOPNOTSUPP;
+	if (!dev->ops->get_arl_entries)
+		goto out;
+
+	err = -ENOMEM;
+	entries = kmalloc_array(SWCONFIG_ARL_BATCH, sizeof(*entries),
+				GFP_KERNEL);
+	if (!entries)
+		goto out;
+
+	do {
+		err = swconfig_send_arl(skb, cb, dev, entries);
+	} while (err >= 0 && cb->args[SWCONFIG_ARL_BUDGET] > 0);
+
+	kfree(entries);
+
+	/* errors are reported once the messages queued so far are out */
+	if (err >= 0 || err == -EMSGSIZE || skb->len)
+		err = skb->len;
+
+out:
+	swconfig_put_dev(dev);
+	return err;
+}
+
 static int
 swconfig_done(struct netlink_callback *cb)
 {
@@ -1042,6 +1572,29 @@ static struct genl_ops swconfig_ops[] = {
 		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
 		.dumpit = swconfig_dump_switches,
 		.done = swconfig_done,
+	},
+	{
+		.cmd = SWITCH_CMD_GET_MULTI,
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.doit = swconfig_get_multi,
+	},
+	{
+		.cmd = SWITCH_CMD_SET_MULTI,
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.flags = GENL_ADMIN_PERM,
+		.doit = swconfig_set_multi,
+	},
+	{
+		.cmd = SWITCH_CMD_GET_PORT_MIB,
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.dumpit = swconfig_dump_port_mib,
+		.done = swconfig_done,
+	},
+	{
+		.cmd = SWITCH_CMD_GET_ARL,
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.dumpit = swconfig_dump_arl,
+		.done = swconfig_done,
 	}
 };
 
@@ -1224,10 +1777,19 @@ switch_generic_set_link(struct switch_dev *dev, int port,
 }
 EXPORT_SYMBOL_GPL(switch_generic_set_link);
 
+/* may be called from interrupt context */
+void
+switch_port_link_changed(struct switch_dev *dev)
+{
+	swconfig_led_link_changed(dev);
+}
+EXPORT_SYMBOL_GPL(switch_port_link_changed);
+
 static int __init
 swconfig_init(void)
 {
 	INIT_LIST_HEAD(&swdevs);
+	swconfig_debugfs_root = debugfs_create_dir("swconfig", NULL);
 
 	return genl_register_family(&switch_fam);
 }
@@ -1236,6 +1798,7 @@ static void __exit
 swconfig_exit(void)
 {
 	genl_unregister_family(&switch_fam);
+	debugfs_remove_recursive(swconfig_debugfs_root);
 }
 
 module_init(swconfig_init);
@@ -16,10 +16,22 @@
 #include <linux/ctype.h>
 #include <linux/device.h>
 #include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/rcupdate.h>
 
 #define SWCONFIG_LED_TIMER_INTERVAL	(HZ / 10)
 #define SWCONFIG_LED_NUM_PORTS		32
 
+/* idle ticks before the polling interval doubles, up to 8x */
+#define SWCONFIG_LED_IDLE_TICKS		10
+#define SWCONFIG_LED_MAX_BACKOFF	3
+
+/* safety net for drivers that report link changes themselves */
+#define SWCONFIG_LED_LINK_REFRESH	(10 * HZ)
+
+#define SWCONFIG_LED_LINK_DIRTY		0
+
 #define SWCONFIG_LED_PORT_SPEED_NA	0x01	/* unknown speed */
 #define SWCONFIG_LED_PORT_SPEED_10	0x02	/* 10 Mbps */
 #define SWCONFIG_LED_PORT_SPEED_100	0x04	/* 100 Mbps */
@@ -48,6 +60,19 @@ struct switch_led_trigger {
 	unsigned long long port_tx_traffic[SWCONFIG_LED_NUM_PORTS];
 	unsigned long long port_rx_traffic[SWCONFIG_LED_NUM_PORTS];
 	u8 link_speed[SWCONFIG_LED_NUM_PORTS];
+
+	unsigned long flags;
+	unsigned long link_refresh;
+	unsigned int idle_ticks;
+	unsigned int backoff;
+
+	/* driver calls that hit the switch bus, for debugfs */
+	struct dentry *debugfs;
+	u64 bus_calls;
+	unsigned int bus_calls_window;
+	unsigned int bus_calls_rate;
+	unsigned long window_start;
+	unsigned int link_events;
 };
 
 struct swconfig_trig_data {
@@ -101,6 +126,9 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 	read_unlock(&trigger->leddev_list_lock);
 
 	sw_trig->port_mask = port_mask;
+	sw_trig->idle_ticks = 0;
+	sw_trig->backoff = 0;
+	set_bit(SWCONFIG_LED_LINK_DIRTY, &sw_trig->flags);
 
 	if (port_mask)
 		schedule_delayed_work(&sw_trig->sw_led_work,
@@ -429,22 +457,15 @@ swconfig_trig_update_leds(struct switch_led_trigger *sw_trig)
 }
 
 static void
-swconfig_led_work_func(struct work_struct *work)
+swconfig_led_read_link(struct switch_led_trigger *sw_trig, u32 port_mask)
 {
-	struct switch_led_trigger *sw_trig;
-	struct switch_dev *swdev;
-	u32 port_mask;
+	struct switch_dev *swdev = sw_trig->swdev;
 	u32 link;
 	int i;
 
-	sw_trig = container_of(work, struct switch_led_trigger,
-			       sw_led_work.work);
-
-	port_mask = sw_trig->port_mask;
-	swdev = sw_trig->swdev;
-
 	link = 0;
 	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		struct switch_port_link port_link;
 		u32 port_bit;
 
 		sw_trig->link_speed[i] = 0;
@@ -453,53 +474,168 @@ swconfig_led_work_func(struct work_struct *work)
 		if ((port_mask & port_bit) == 0)
 			continue;
 
-		if (swdev->ops->get_port_link) {
-			struct switch_port_link port_link;
-
-			memset(&port_link, '\0', sizeof(port_link));
-			swdev->ops->get_port_link(swdev, i, &port_link);
-
-			if (port_link.link) {
-				link |= port_bit;
-				switch (port_link.speed) {
-				case SWITCH_PORT_SPEED_UNKNOWN:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_NA;
-					break;
-				case SWITCH_PORT_SPEED_10:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_10;
-					break;
-				case SWITCH_PORT_SPEED_100:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_100;
-					break;
-				case SWITCH_PORT_SPEED_1000:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_1000;
-					break;
-				}
-			}
-		}
+		memset(&port_link, '\0', sizeof(port_link));
+		swdev->ops->get_port_link(swdev, i, &port_link);
+		sw_trig->bus_calls_window++;
 
-		if (swdev->ops->get_port_stats) {
-			struct switch_port_stats port_stats;
+		if (!port_link.link)
+			continue;
 
-			memset(&port_stats, '\0', sizeof(port_stats));
-			swdev->ops->get_port_stats(swdev, i, &port_stats);
-			sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
-			sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
+		link |= port_bit;
+		switch (port_link.speed) {
+		case SWITCH_PORT_SPEED_UNKNOWN:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_NA;
+			break;
+		case SWITCH_PORT_SPEED_10:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_10;
+			break;
+		case SWITCH_PORT_SPEED_100:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_100;
+			break;
+		case SWITCH_PORT_SPEED_1000:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_1000;
+			break;
 		}
 	}
 
 	sw_trig->port_link = link;
+	sw_trig->link_refresh = jiffies + SWCONFIG_LED_LINK_REFRESH;
+}
+
+/* returns true if any port saw traffic since the last call */
+static bool
+swconfig_led_read_stats(struct switch_led_trigger *sw_trig, u32 port_mask)
+{
+	struct switch_dev *swdev = sw_trig->swdev;
+	bool active = false;
+	int i;
+
+	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		struct switch_port_stats port_stats;
+
+		if (!(port_mask & sw_trig->port_link & BIT(i)))
+			continue;
+
+		memset(&port_stats, '\0', sizeof(port_stats));
+		swdev->ops->get_port_stats(swdev, i, &port_stats);
+
+		/* drivers with a MIB snapshot answer without bus access */
+		if (!swdev->stats_snapshot)
+			sw_trig->bus_calls_window++;
+
+		if (sw_trig->port_tx_traffic[i] != port_stats.tx_bytes ||
+		    sw_trig->port_rx_traffic[i] != port_stats.rx_bytes)
+			active = true;
+
+		sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
+		sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
+	}
+
+	return active;
+}
+
+static void
+swconfig_led_work_func(struct work_struct *work)
+{
+	struct switch_led_trigger *sw_trig;
+	struct switch_dev *swdev;
+	unsigned long elapsed;
+	bool active = false;
+	u32 port_mask;
+	u32 link;
+
+	sw_trig = container_of(work, struct switch_led_trigger,
+			       sw_led_work.work);
+
+	port_mask = sw_trig->port_mask;
+	swdev = sw_trig->swdev;
+	link = sw_trig->port_link;
+
+	/*
+	 * Drivers with a link interrupt tell us about changes, everybody
+	 * else has to be polled on every tick.
+	 */
+	if (!swdev->link_notify ||
+	    test_and_clear_bit(SWCONFIG_LED_LINK_DIRTY, &sw_trig->flags) ||
+	    time_after(jiffies, sw_trig->link_refresh))
+		swconfig_led_read_link(sw_trig, port_mask);
+
+	if (swdev->ops->get_port_stats)
+		active = swconfig_led_read_stats(sw_trig, port_mask);
 
 	swconfig_trig_update_leds(sw_trig);
 
+	/* back off while the ports are idle */
+	if (active || link != sw_trig->port_link) {
+		sw_trig->idle_ticks = 0;
+		sw_trig->backoff = 0;
+	} else if (++sw_trig->idle_ticks >= SWCONFIG_LED_IDLE_TICKS &&
+		   sw_trig->backoff < SWCONFIG_LED_MAX_BACKOFF) {
+		sw_trig->idle_ticks = 0;
+		sw_trig->backoff++;
+	}
+
+	elapsed = jiffies - sw_trig->window_start;
+	if (elapsed >= HZ) {
+		sw_trig->bus_calls += sw_trig->bus_calls_window;
+		sw_trig->bus_calls_rate = sw_trig->bus_calls_window * HZ /
+					  elapsed;
+		sw_trig->bus_calls_window = 0;
+		sw_trig->window_start = jiffies;
+	}
+
 	schedule_delayed_work(&sw_trig->sw_led_work,
-			      SWCONFIG_LED_TIMER_INTERVAL);
+			      SWCONFIG_LED_TIMER_INTERVAL << sw_trig->backoff);
+}
+
+static void
+swconfig_led_link_changed(struct switch_dev *swdev)
+{
+	struct switch_led_trigger *sw_trig;
+
+	/* RCU keeps the trigger alive against swconfig_destroy_led_trigger */
+	rcu_read_lock();
+	sw_trig = READ_ONCE(swdev->led_trigger);
+	if (sw_trig) {
+		sw_trig->link_events++;
+		set_bit(SWCONFIG_LED_LINK_DIRTY, &sw_trig->flags);
+		if (sw_trig->port_mask)
+			mod_delayed_work(system_wq, &sw_trig->sw_led_work, 0);
+	}
+	rcu_read_unlock();
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int
+swconfig_led_debugfs_show(struct seq_file *m, void *unused)
+{
+	struct switch_led_trigger *sw_trig = m->private;
+
+	seq_printf(m, "interval_ms: %u\n",
+		   jiffies_to_msecs(SWCONFIG_LED_TIMER_INTERVAL <<
+				    sw_trig->backoff));
+	seq_printf(m, "bus_calls: %llu\n",
+		   sw_trig->bus_calls + sw_trig->bus_calls_window);
+	seq_printf(m, "bus_calls_per_sec: %u\n", sw_trig->bus_calls_rate);
+	seq_printf(m, "link_events: %u\n", sw_trig->link_events);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(swconfig_led_debugfs);
+
+static void
+swconfig_led_debugfs_init(struct switch_led_trigger *sw_trig)
+{
+	sw_trig->debugfs = debugfs_create_dir(sw_trig->swdev->devname,
+					      swconfig_debugfs_root);
+	debugfs_create_file("leds", 0444, sw_trig->debugfs, sw_trig,
+			    &swconfig_led_debugfs_fops);
+}
+#else
+static inline void
+swconfig_led_debugfs_init(struct switch_led_trigger *sw_trig) { }
+#endif
+
 static int
 swconfig_create_led_trigger(struct switch_dev *swdev)
 {
@@ -519,12 +655,14 @@ swconfig_create_led_trigger(struct switch_dev *swdev)
 	sw_trig->trig.deactivate = swconfig_trig_deactivate;
 
 	INIT_DELAYED_WORK(&sw_trig->sw_led_work, swconfig_led_work_func);
+	sw_trig->window_start = jiffies;
 
 	err = led_trigger_register(&sw_trig->trig);
 	if (err)
 		goto err_free;
 
-	swdev->led_trigger = sw_trig;
+	WRITE_ONCE(swdev->led_trigger, sw_trig);
+	swconfig_led_debugfs_init(sw_trig);
 
 	return 0;
 
@@ -540,8 +678,13 @@ swconfig_destroy_led_trigger(struct switch_dev *swdev)
 
 	sw_trig = swdev->led_trigger;
 	if (sw_trig) {
-		cancel_delayed_work_sync(&sw_trig->sw_led_work);
+		WRITE_ONCE(swdev->led_trigger, NULL);
+		/* wait for link events which may still requeue the work */
+		synchronize_rcu();
+		debugfs_remove_recursive(sw_trig->debugfs);
+		/* deactivating the LEDs may requeue the work too */
 		led_trigger_unregister(&sw_trig->trig);
+		cancel_delayed_work_sync(&sw_trig->sw_led_work);
 		kfree(sw_trig);
 	}
 }
@@ -552,4 +695,7 @@ swconfig_create_led_trigger(struct switch_dev *swdev) { return 0; }
 
 static inline void
 swconfig_destroy_led_trigger(struct switch_dev *swdev) { }
+
+static inline void
+swconfig_led_link_changed(struct switch_dev *swdev) { }
 #endif /* CONFIG_SWCONFIG_LEDS */
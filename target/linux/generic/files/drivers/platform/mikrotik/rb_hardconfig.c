@@ -16,7 +16,8 @@
  * This driver permanently allocates a chunk of RAM as large as the hard_config
  * MTD partition, although it is technically possible to operate entirely from
  * the MTD device without using a local buffer (except when requesting WLAN
- * calibration data), at the cost of a performance penalty.
+ * calibration data), at the cost of a performance penalty. Decoded WLAN
+ * calibration data is kept once it has been requested.
  *
  * Note: PAGE_SIZE is assumed to be >= 4K, hence the device attribute show
  * routines need not check for output overflow.
@@ -34,12 +35,13 @@
 #include <linux/bitops.h>
 #include <linux/string.h>
 #include <linux/mtd/mtd.h>
+#include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/lzo.h>
 
 #include "routerboot.h"
 
-#define RB_HARDCONFIG_VER		"0.07"
+#define RB_HARDCONFIG_VER		"0.08"
 #define RB_HC_PR_PFX			"[rb_hardconfig] "
 
 /* ID values for hardware settings */
@@ -90,6 +92,7 @@
 static struct kobject *hc_kobj;
 static u8 *hc_buf;		// ro buffer after init(): no locking required
 static size_t hc_buflen;
+static DEFINE_MUTEX(hc_wlan_lock);	// protects hc_wlan_attr data
 
 /*
  * For LZOR style WLAN data unpacking.
@@ -366,6 +369,8 @@ static struct hc_wlan_attr {
 	struct bin_attribute battr;
 	u16 pld_ofs;
 	u16 pld_len;
+	void *data;		// decoded payload, allocated on first read
+	size_t data_len;
 } hc_wd_multi_battrs[] = {
 	{
 		.erd_tag_id = RB_WLAN_ERD_ID_MULTI_8001,
@@ -627,24 +632,19 @@ static ssize_t hc_attr_show(struct kobject *kobj, struct kobj_attribute *attr,
 }
 
 /*
- * This function will allocate and free memory every time it is called. This
- * is not the fastest way to do this, but since the data is rarely read (mainly
- * at boot time to load wlan caldata), this makes it possible to save memory for
- * the system.
+ * Sysfs hands out binary attributes in PAGE_SIZE chunks, so a single read of
+ * the calibration data calls this function several times. The payload is
+ * decoded on the first call and kept, trimmed to its actual size, for the
+ * following ones. Must be called with hc_wlan_lock held.
  */
-static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
-				     struct bin_attribute *attr, char *buf,
-				     loff_t off, size_t count)
+static int hc_wlan_data_get(struct hc_wlan_attr *hc_wattr)
 {
-	struct hc_wlan_attr *hc_wattr;
 	size_t outlen;
-	void *outbuf;
+	void *outbuf, *tmp;
 	int ret;
 
-	hc_wattr = container_of(attr, typeof(*hc_wattr), battr);
-
-	if (!hc_wattr->pld_len)
-		return -ENOENT;
+	if (hc_wattr->data)
+		return 0;
 
 	outlen = RB_ART_SIZE;
 
@@ -662,18 +662,61 @@ static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
 		return ret;
 	}
 
-	if (off >= outlen) {
-		kfree(outbuf);
-		return 0;
+	tmp = krealloc(outbuf, outlen, GFP_KERNEL);
+	if (tmp)
+		outbuf = tmp;
+
+	hc_wattr->data = outbuf;
+	hc_wattr->data_len = outlen;
+
+	return 0;
+}
+
+static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
+				     struct bin_attribute *attr, char *buf,
+				     loff_t off, size_t count)
+{
+	struct hc_wlan_attr *hc_wattr;
+	int ret;
+
+	hc_wattr = container_of(attr, typeof(*hc_wattr), battr);
+
+	if (!hc_wattr->pld_len)
+		return -ENOENT;
+
+	mutex_lock(&hc_wlan_lock);
+
+	ret = hc_wlan_data_get(hc_wattr);
+	if (ret)
+		goto out;
+
+	if (off >= hc_wattr->data_len) {
+		ret = 0;
+		goto out;
 	}
 
-	if (off + count > outlen)
-		count = outlen - off;
+	if (off + count > hc_wattr->data_len)
+		count = hc_wattr->data_len - off;
+
+	memcpy(buf, hc_wattr->data + off, count);
+	ret = count;
+
+out:
+	mutex_unlock(&hc_wlan_lock);
+	return ret;
+}
+
+static void hc_wlan_data_free(void)
+{
+	int i;
 
-	memcpy(buf, outbuf + off, count);
+	for (i = 0; i < ARRAY_SIZE(hc_wd_multi_battrs); i++) {
+		kfree(hc_wd_multi_battrs[i].data);
+		hc_wd_multi_battrs[i].data = NULL;
+	}
 
-	kfree(outbuf);
-	return count;
+	kfree(hc_wd_solo_battr.data);
+	hc_wd_solo_battr.data = NULL;
 }
 
 int rb_hardconfig_init(struct kobject *rb_kobj, struct mtd_info *mtd)
@@ -820,6 +863,7 @@ void rb_hardconfig_exit(void)
 {
 	kobject_put(hc_kobj);
 	hc_kobj = NULL;
+	hc_wlan_data_free();
 	kfree(hc_buf);
 	hc_buf = NULL;
 }
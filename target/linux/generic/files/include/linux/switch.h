@@ -80,6 +80,15 @@ struct switch_port_stats {
  *
  * @apply_config: apply all changed settings to the switch
  * @reset_switch: resetting the switch
+ *
+ * @get_port_mib: copy the dev->mibs counters of a port from the last
+ *	snapshot, along with the snapshot generation and optionally the
+ *	generation in which each counter last changed
+ * @get_mib_name: name of a counter returned by @get_port_mib
+ *
+ * @get_arl_entries: read up to @max address table entries following
+ *	@cursor (all zero to start from the beginning), returns the number
+ *	of entries read, less than @max at the end of the table
  */
 struct switch_dev_ops {
 	struct switch_attrlist attr_global, attr_port, attr_vlan;
@@ -99,6 +108,13 @@ struct switch_dev_ops {
 			     struct switch_port_link *link);
 	int (*get_port_stats)(struct switch_dev *dev, int port,
 			      struct switch_port_stats *stats);
+	int (*get_port_mib)(struct switch_dev *dev, int port, u64 *values,
+			    u32 *changed, u32 *generation);
+	const char *(*get_mib_name)(struct switch_dev *dev, int idx);
+	int (*get_arl_entries)(struct switch_dev *dev,
+			       const struct switch_arl_entry *cursor,
+			       struct switch_arl_entry *entries,
+			       unsigned int max);
 
 	int (*phy_read16)(struct switch_dev *dev, int addr, u8 reg, u16 *value);
 	int (*phy_write16)(struct switch_dev *dev, int addr, u8 reg, u16 value);
@@ -118,6 +134,12 @@ struct switch_dev {
 	unsigned int ports;
 	unsigned int vlans;
 	unsigned int cpu_port;
+	unsigned int mibs;
+
+	/* link changes are reported through switch_port_link_changed() */
+	bool link_notify;
+	/* get_port_stats() is served from a MIB snapshot without bus access */
+	bool stats_snapshot;
 
 	/* the following fields are internal for swconfig */
 	unsigned int id;
@@ -175,5 +197,6 @@ struct switch_attr {
 
 int switch_generic_set_link(struct switch_dev *dev, int port,
 			    struct switch_port_link *link);
+void switch_port_link_changed(struct switch_dev *dev);
 
 #endif /* _LINUX_SWITCH_H */
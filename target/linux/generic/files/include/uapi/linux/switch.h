@@ -54,6 +54,24 @@ enum {
 	SWITCH_ATTR_OP_DESCRIPTION,
 	/* port lists */
 	SWITCH_ATTR_PORT,
+	/* batched operations */
+	SWITCH_ATTR_OP_LIST,
+	SWITCH_ATTR_OP,
+	SWITCH_ATTR_OP_APPLY,
+	SWITCH_ATTR_OP_INDEX,
+	SWITCH_ATTR_OP_ERROR,
+	/* port counters */
+	SWITCH_ATTR_PAD,
+	SWITCH_ATTR_MIB_NAMES,
+	SWITCH_ATTR_MIB_SINCE,
+	SWITCH_ATTR_MIB_GENERATION,
+	SWITCH_ATTR_MIB_INDEX,
+	SWITCH_ATTR_MIB_VALUES,
+	/* address table */
+	SWITCH_ATTR_ARL_CURSOR,
+	SWITCH_ATTR_ARL_LIMIT,
+	SWITCH_ATTR_ARL_ENTRIES,
+	SWITCH_ATTR_ARL_END,
 	SWITCH_ATTR_MAX
 };
 
@@ -78,7 +96,11 @@ enum {
 	SWITCH_CMD_SET_PORT,
 	SWITCH_CMD_LIST_VLAN,
 	SWITCH_CMD_GET_VLAN,
-	SWITCH_CMD_SET_VLAN
+	SWITCH_CMD_SET_VLAN,
+	SWITCH_CMD_GET_MULTI,
+	SWITCH_CMD_SET_MULTI,
+	SWITCH_CMD_GET_PORT_MIB,
+	SWITCH_CMD_GET_ARL,
 };
 
 /* data types */
@@ -115,5 +137,21 @@ enum {
 
 #define SWITCH_ATTR_DEFAULTS_OFFSET	0x1000
 
+/*
+ * address table entry, SWITCH_ATTR_ARL_ENTRIES carries an array of these.
+ * The last entry of a message doubles as SWITCH_ATTR_ARL_CURSOR: passing
+ * it back resumes the walk right after it.
+ */
+struct switch_arl_entry {
+	__u8 mac[6];
+	__u16 vid;		/* 0 if the table is not VLAN aware */
+	__u32 portmap;
+	__u8 age;		/* hardware aging counter */
+	__u8 flags;
+	__u8 pad[2];
+};
+
+#define SWITCH_ARL_F_STATIC	(1 << 0)
+
 
 #endif /* _UAPI_LINUX_SWITCH_H */
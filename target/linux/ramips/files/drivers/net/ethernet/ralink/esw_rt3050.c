@@ -776,6 +776,7 @@ static irqreturn_t esw_interrupt(int irq, void *_esw)
 			netif_carrier_on(esw->priv->netdev);
 		else
 			netif_carrier_off(esw->priv->netdev);
+		switch_port_link_changed(&esw->swdev);
 	}
 
 out:
@@ -1530,6 +1531,7 @@ int rt3050_esw_init(struct fe_priv *priv)
 	if (!ret) {
 		esw_w32(esw, RT305X_ESW_PORT_ST_CHG, RT305X_ESW_REG_ISR);
 		esw_w32(esw, ~RT305X_ESW_PORT_ST_CHG, RT305X_ESW_REG_IMR);
+		swdev->link_notify = true;
 	}
 
 	dev_info(&pdev->dev, "mediatek esw at 0x%08lx, irq %d initialized\n",
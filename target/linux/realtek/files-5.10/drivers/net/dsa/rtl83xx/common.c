@@ -1,11 +1,16 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include <linux/iopoll.h>
 #include <linux/of_mdio.h>
 #include <linux/of_platform.h>
 #include <net/arp.h>
+#include <net/ip6_fib.h>
+#include <net/ipv6.h>
+#include <net/ndisc.h>
 #include <net/nexthop.h>
 #include <net/neighbour.h>
 #include <net/netevent.h>
+#include <net/switchdev.h>
 #include <linux/inetdevice.h>
 #include <linux/rhashtable.h>
 #include <linux/of_net.h>
@@ -121,28 +126,114 @@ void rtl_table_release(struct table_reg *r)
 //	pr_info("Unlock done\n");
 }
 
+/*
+ * Returns the descriptor of table access register r without locking it, for statistics
+ */
+const struct table_reg *rtl_table_peek(rtl838x_tbl_reg_t r)
+{
+	if (r >= RTL_TBL_END)
+		return NULL;
+
+	return &rtl838x_tbl_regs[r];
+}
+
+/*
+ * Executes a table access command and waits for the execute bit to clear. Accesses
+ * usually complete within a microsecond, so the register is polled without sleeping
+ * for RTL_TBL_SPIN_US, then with sleeps in between until RTL_TBL_TIMEOUT_US.
+ * Called with the table lock held, which also protects the statistics
+ */
+#define RTL_TBL_SPIN_US		20
+#define RTL_TBL_POLL_US		10
+#define RTL_TBL_TIMEOUT_US	10000
+
+static int rtl_table_exec(struct table_reg *r, u32 cmd, bool write)
+{
+	u32 busy = BIT(r->c_bit + 1);
+	u64 t = ktime_get_ns();
+	u32 v;
+	int err;
+
+	sw_w32(cmd, r->addr);
+	err = readx_poll_timeout_atomic(sw_r32, r->addr, v, !(v & busy), 0, RTL_TBL_SPIN_US);
+	if (err) {
+		r->stats.slow++;
+		err = readx_poll_timeout(sw_r32, r->addr, v, !(v & busy),
+					 RTL_TBL_POLL_US, RTL_TBL_TIMEOUT_US);
+	}
+	t = ktime_get_ns() - t;
+
+	if (write)
+		r->stats.writes++;
+	else
+		r->stats.reads++;
+	if (t > r->stats.max_ns)
+		r->stats.max_ns = min_t(u64, t, U32_MAX);
+	r->stats.hist[min_t(int, fls64(t >> 8), RTL_TBL_HIST_BUCKETS - 1)]++;
+
+	if (err) {
+		r->stats.timeouts++;
+		pr_err("%s: table access %08x at %04x timed out\n", __func__, cmd, r->addr);
+	}
+
+	return err;
+}
+
 /*
  * Reads table index idx into the data registers of the table
  */
-void rtl_table_read(struct table_reg *r, int idx)
+int rtl_table_read(struct table_reg *r, int idx)
 {
 	u32 cmd = r->rmode ? BIT(r->c_bit) : 0;
 
 	cmd |= BIT(r->c_bit + 1) | (r->tbl << r->t_bit) | (idx & (BIT(r->t_bit) - 1));
-	sw_w32(cmd, r->addr);
-	do { } while (sw_r32(r->addr) & BIT(r->c_bit + 1));
+
+	return rtl_table_exec(r, cmd, false);
 }
 
 /*
  * Writes the content of the table data registers into the table at index idx
  */
-void rtl_table_write(struct table_reg *r, int idx)
+int rtl_table_write(struct table_reg *r, int idx)
 {
 	u32 cmd = r->rmode ? 0 : BIT(r->c_bit);
 
 	cmd |= BIT(r->c_bit + 1) | (r->tbl << r->t_bit) | (idx & (BIT(r->t_bit) - 1));
-	sw_w32(cmd, r->addr);
-	do { } while (sw_r32(r->addr) & BIT(r->c_bit + 1));
+
+	return rtl_table_exec(r, cmd, true);
+}
+
+/*
+ * Executes n reads and writes on table r, which needs to be held with rtl_table_get().
+ * Writes load the first n_data data registers from op->data, reads copy them into
+ * op->data afterwards. The CPU is given up between entries of large batches.
+ * Stops at the first access timing out and returns its error.
+ */
+#define RTL_TBL_BATCH_YIELD	32
+
+int rtl_table_batch(struct table_reg *r, struct table_op *ops, int n, int n_data)
+{
+	int i, j, err;
+
+	n_data = min_t(int, n_data, r->max_data);
+	for (i = 0; i < n; i++) {
+		if (ops[i].write) {
+			for (j = 0; j < n_data; j++)
+				sw_w32(ops[i].data[j], rtl_table_data(r, j));
+			err = rtl_table_write(r, ops[i].idx);
+		} else {
+			err = rtl_table_read(r, ops[i].idx);
+			for (j = 0; !err && j < n_data; j++)
+				ops[i].data[j] = sw_r32(rtl_table_data(r, j));
+		}
+		if (err)
+			return err;
+
+		if ((i + 1) % RTL_TBL_BATCH_YIELD == 0)
+			cond_resched();
+	}
+
+	return 0;
 }
 
 /*
@@ -521,7 +612,7 @@ int rtl83xx_lag_del(struct dsa_switch *ds, int group, int port)
 /*
  * Allocate a 64 bit octet counter located in the LOG HW table
  */
-static int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv)
+int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv)
 {
 	int idx;
 
@@ -574,39 +665,241 @@ int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv)
 	return idx;
 }
 
+static void rtl83xx_l2_shadow_fill(struct rtl83xx_l2_shadow *s, u64 entry,
+				   struct rtl838x_l2_entry *e)
+{
+	s->valid = e->valid;
+	s->seed = e->valid ? entry & 0x0fffffffffffffffULL : 0;
+	s->mac = ether_addr_to_u64(&e->mac[0]);
+	s->vid = e->vid;
+	s->port = e->port;
+	s->is_static = e->is_static;
+	s->next_hop = e->next_hop;
+	s->mc_portmask_index = e->mc_portmask_index;
+}
+
+/*
+ * Accessors for the L2 hash table and CAM which keep the shadow in priv->l2_shadow
+ * up to date. idx is the index into the hash table as returned by rtl83xx_l2_hash_idx()
+ * or the CAM slot. All are called with reg_mutex held.
+ */
+u64 rtl83xx_l2_read_hash(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e)
+{
+	u64 entry = priv->r->read_l2_entry_using_hash(idx >> 2, idx & 0x3, e);
+
+	if (idx < priv->fib_entries)
+		rtl83xx_l2_shadow_fill(&priv->l2_shadow[idx], entry, e);
+
+	return entry;
+}
+
+u64 rtl83xx_l2_read_cam(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e)
+{
+	u64 entry = priv->r->read_cam(idx, e);
+
+	rtl83xx_l2_shadow_fill(&priv->l2_shadow[priv->fib_entries + idx], entry, e);
+
+	return entry;
+}
+
+/*
+ * The entry is read back after writing it, the hardware returns the seed in its own
+ * format which is what lookups compare against
+ */
+void rtl83xx_l2_write_hash(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e)
+{
+	struct rtl838x_l2_entry r;
+
+	priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, e);
+	rtl83xx_l2_read_hash(priv, idx, &r);
+}
+
+void rtl83xx_l2_write_cam(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e)
+{
+	struct rtl838x_l2_entry r;
+
+	priv->r->write_cam(idx, e);
+	rtl83xx_l2_read_cam(priv, idx, &r);
+}
+
+/*
+ * Re-reads count slots of the shadow starting at idx from the hardware, indices
+ * beyond the hash table refer to the CAM
+ */
+static void rtl83xx_l2_shadow_sync_range(struct rtl838x_switch_priv *priv, int idx, int count)
+{
+	struct rtl838x_l2_entry e;
+	int end = min_t(int, idx + count, priv->fib_entries + L2_CAM_SIZE);
+
+	for (; idx < end; idx++) {
+		if (idx < priv->fib_entries)
+			rtl83xx_l2_read_hash(priv, idx, &e);
+		else
+			rtl83xx_l2_read_cam(priv, idx - priv->fib_entries, &e);
+		if (!(idx % RTL_TBL_BATCH_YIELD))
+			cond_resched();
+	}
+}
+
+void rtl83xx_l2_shadow_sync(struct rtl838x_switch_priv *priv)
+{
+	rtl83xx_l2_shadow_sync_range(priv, 0, priv->fib_entries + L2_CAM_SIZE);
+	priv->l2_shadow_synced = true;
+}
+
+/*
+ * Drops the entries of a port from the shadow after its entries were flushed from
+ * the hardware. Whatever the flush left in place is picked up again by the resync
+ * or by lookups, which fall back to reading the hardware when missing an entry.
+ */
+void rtl83xx_l2_shadow_flush_port(struct rtl838x_switch_priv *priv, int port)
+{
+	int i;
+
+	for (i = 0; i < priv->fib_entries + L2_CAM_SIZE; i++) {
+		if (priv->l2_shadow[i].port == port)
+			priv->l2_shadow[i].valid = false;
+	}
+}
+
+/*
+ * Periodically re-reads a chunk of the L2 table to catch entries learned or aged
+ * by the hardware, a full pass over the table takes L2_RESYNC_PERIOD
+ */
+static void rtl83xx_l2_resync_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(to_delayed_work(work), struct rtl838x_switch_priv, l2_resync_work);
+	int total = priv->fib_entries + L2_CAM_SIZE;
+
+	mutex_lock(&priv->reg_mutex);
+	rtl83xx_l2_shadow_sync_range(priv, priv->l2_resync_pos, L2_RESYNC_CHUNK);
+	priv->l2_resync_pos += L2_RESYNC_CHUNK;
+	if (priv->l2_resync_pos >= total)
+		priv->l2_resync_pos = 0;
+	mutex_unlock(&priv->reg_mutex);
+
+	schedule_delayed_work(&priv->l2_resync_work,
+			      L2_RESYNC_PERIOD / DIV_ROUND_UP(total, L2_RESYNC_CHUNK));
+}
+
+/*
+ * Re-reads the hash bucket of a MAC/FID the switch notified us about and the CAM
+ * slots where it may be stored
+ */
+static void rtl83xx_l2_shadow_update(struct rtl838x_switch_priv *priv, u64 mac, u16 fid, bool add)
+{
+	u64 seed = priv->r->l2_hash_seed(mac, fid);
+	u32 key = priv->r->l2_hash_key(priv, seed);
+	struct rtl838x_l2_entry e;
+	bool found = false;
+	int i;
+	u64 entry;
+
+	for (i = 0; i < priv->l2_bucket_size; i++) {
+		entry = rtl83xx_l2_read_hash(priv, rtl83xx_l2_hash_idx(key, i), &e);
+		if (e.valid && (entry & 0x0fffffffffffffffULL) == seed)
+			found = true;
+	}
+	if (found)
+		return;
+
+	for (i = 0; i < L2_CAM_SIZE; i++) {
+		struct rtl83xx_l2_shadow *s = &priv->l2_shadow[priv->fib_entries + i];
+
+		if (add || (s->valid && s->seed == seed))
+			rtl83xx_l2_read_cam(priv, i, &e);
+	}
+}
+
+static void rtl83xx_l2_event_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(work, struct rtl838x_switch_priv, l2_event_work);
+	u64 events[L2_MAX_EVENTS];
+	bool lost;
+	int i, n;
+
+	spin_lock_irq(&priv->l2_event_lock);
+	n = priv->l2_n_events;
+	memcpy(events, priv->l2_events, n * sizeof(u64));
+	lost = priv->l2_events_lost;
+	priv->l2_n_events = 0;
+	priv->l2_events_lost = false;
+	spin_unlock_irq(&priv->l2_event_lock);
+
+	mutex_lock(&priv->reg_mutex);
+	if (lost) {
+		rtl83xx_l2_shadow_sync(priv);
+	} else {
+		for (i = 0; i < n; i++)
+			rtl83xx_l2_shadow_update(priv, events[i] & 0xffffffffffffULL,
+						 (events[i] >> 48) & 0xfff, events[i] & BIT_ULL(63));
+	}
+	mutex_unlock(&priv->reg_mutex);
+}
+
+/*
+ * The ethernet driver forwards the L2 learning/aging notifications of the switch
+ * as FDB events on the master device. Called in atomic context, the shadow is
+ * updated from a work item.
+ */
+static int rtl83xx_switchdev_event(struct notifier_block *this,
+				   unsigned long event, void *ptr)
+{
+	struct net_device *dev = switchdev_notifier_info_to_dev(ptr);
+	struct switchdev_notifier_fdb_info *fdb_info;
+	struct rtl838x_switch_priv *priv;
+	struct dsa_port *cpu_dp;
+	unsigned long flags;
+	u64 ev;
+
+	if (event != SWITCHDEV_FDB_ADD_TO_BRIDGE && event != SWITCHDEV_FDB_DEL_TO_BRIDGE)
+		return NOTIFY_DONE;
+
+	priv = container_of(this, struct rtl838x_switch_priv, sd_nb);
+	cpu_dp = priv->ports[priv->cpu_port].dp;
+	if (!cpu_dp || dev != cpu_dp->master)
+		return NOTIFY_DONE;
+
+	fdb_info = container_of(ptr, struct switchdev_notifier_fdb_info, info);
+	ev = ether_addr_to_u64(fdb_info->addr) | ((u64)(fdb_info->vid & 0xfff) << 48);
+	if (event == SWITCHDEV_FDB_ADD_TO_BRIDGE)
+		ev |= BIT_ULL(63);
+
+	spin_lock_irqsave(&priv->l2_event_lock, flags);
+	if (priv->l2_n_events < L2_MAX_EVENTS)
+		priv->l2_events[priv->l2_n_events++] = ev;
+	else
+		priv->l2_events_lost = true;
+	spin_unlock_irqrestore(&priv->l2_event_lock, flags);
+
+	schedule_work(&priv->l2_event_work);
+
+	return NOTIFY_DONE;
+}
+
 /*
  * Add an L2 nexthop entry for the L3 routing system / PIE forwarding in the SoC
  * Use VID and MAC in rtl838x_l2_entry to identify either a free slot in the L2 hash table
  * or mark an existing entry as a nexthop by setting it's nexthop bit
- * Called from the L3 layer
+ * Called from the L3 layer with reg_mutex held
  * The index in the L2 hash table is filled into nh->l2_id;
  */
 int rtl83xx_l2_nexthop_add(struct rtl838x_switch_priv *priv, struct rtl83xx_nexthop *nh)
 {
 	struct rtl838x_l2_entry e;
 	u64 seed = priv->r->l2_hash_seed(nh->mac, nh->rvid);
-	u32 key = priv->r->l2_hash_key(priv, seed);
-	int i, idx = -1;
-	u64 entry;
+	int idx;
 
-	pr_debug("%s searching for %08llx vid %d with key %d, seed: %016llx\n",
-		__func__, nh->mac, nh->rvid, key, seed);
+	pr_debug("%s searching for %08llx vid %d, seed: %016llx\n",
+		__func__, nh->mac, nh->rvid, seed);
 
 	e.type = L2_UNICAST;
 	u64_to_ether_addr(nh->mac, &e.mac[0]);
 	e.port = nh->port;
 
-	// Loop over all entries in the hash-bucket and over the second block on 93xx SoCs
-	for (i = 0; i < priv->l2_bucket_size; i++) {
-		entry = priv->r->read_l2_entry_using_hash(key, i, &e);
-
-		if (!e.valid || ((entry & 0x0fffffffffffffffULL) == seed)) {
-			idx = i > 3 ? ((key >> 14) & 0xffff) | i >> 1
-					: ((key << 2) | i) & 0xffff;
-			break;
-		}
-	}
-
+	idx = rtl83xx_find_l2_hash_entry(priv, seed, false, &e);
 	if (idx < 0) {
 		pr_err("%s: No more L2 forwarding entries available\n", __func__);
 		return -1;
@@ -639,7 +932,7 @@ int rtl83xx_l2_nexthop_add(struct rtl838x_switch_priv *priv, struct rtl83xx_next
 	e.nh_route_id = nh->id;			// NH route ID takes place of VID
 	e.nh_vlan_target = false;
 
-	priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+	rtl83xx_l2_write_hash(priv, idx, &e);
 
 	return 0;
 }
@@ -648,15 +941,15 @@ int rtl83xx_l2_nexthop_add(struct rtl838x_switch_priv *priv, struct rtl83xx_next
  * Removes a Layer 2 next hop entry in the forwarding database
  * If it was static, the entire entry is removed, otherwise the nexthop bit is cleared
  * and we wait until the entry ages out
+ * Called with reg_mutex held
  */
 int rtl83xx_l2_nexthop_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_nexthop *nh)
 {
 	struct rtl838x_l2_entry e;
-	u32 key = nh->l2_id >> 2;
-	int i = nh->l2_id & 0x3;
-	u64 entry = entry = priv->r->read_l2_entry_using_hash(key, i, &e);
 
-	pr_debug("%s: id %d, key %d, index %d\n", __func__, nh->l2_id, key, i);
+	rtl83xx_l2_read_hash(priv, nh->l2_id, &e);
+
+	pr_debug("%s: id %d, key %d, index %d\n", __func__, nh->l2_id, nh->l2_id >> 2, nh->l2_id & 0x3);
 	if (!e.valid) {
 		dev_err(priv->dev, "unknown nexthop, id %x\n", nh->l2_id);
 		return -1;
@@ -668,7 +961,7 @@ int rtl83xx_l2_nexthop_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_nexth
 	e.vid = nh->vid;		// Restore VID
 	e.rvid = nh->rvid;
 
-	priv->r->write_l2_entry_using_hash(key, i, &e);
+	rtl83xx_l2_write_hash(priv, nh->l2_id, &e);
 
 	return 0;
 }
@@ -780,80 +1073,154 @@ const static struct rhashtable_params route_ht_params = {
 	.head_offset = offsetof(struct rtl83xx_route, linkage),
 };
 
+const static struct rhashtable_params route6_ht_params = {
+	.key_len     = sizeof(struct in6_addr),
+	.key_offset  = offsetof(struct rtl83xx_route, gw_ip6),
+	.head_offset = offsetof(struct rtl83xx_route, linkage),
+};
+
 /*
- * Updates an L3 next hop entry in the ROUTING table
+ * Sets up forwarding for a route to a gateway with the given MAC: the L2 next hop,
+ * the ROUTING table entry and the PIE rule matching the destination
  */
-static int rtl83xx_l3_nexthop_update(struct rtl838x_switch_priv *priv,  __be32 ip_addr, u64 mac)
+static void rtl83xx_l3_route_update(struct rtl838x_switch_priv *priv, struct rtl83xx_route *r,
+				    u64 mac)
 {
-	struct rtl83xx_route *r;
-	struct rhlist_head *tmp, *list;
-
-	rcu_read_lock();
-	list = rhltable_lookup(&priv->routes, &ip_addr, route_ht_params);
-	if (!list) {
-		rcu_read_unlock();
-		return -ENOENT;
-	}
+	bool is_ipv6 = r->attr.type == 2; // IPv6 unicast
 
-	rhl_for_each_entry_rcu(r, tmp, list, linkage) {
-		pr_info("%s: Setting up fwding: ip %pI4, GW mac %016llx\n",
-			__func__, &ip_addr, mac);
-
-		// Reads the ROUTING table entry associated with the route
+	// Reads the ROUTING table entry associated with an IPv4 route
+	if (!is_ipv6) {
 		priv->r->route_read(r->id, r);
+		r->attr.type = 0;
+	}
+	if (is_ipv6)
+		pr_info("Route with id %d to %pI6c / %d\n", r->id, &r->dst_ip6, r->prefix_len);
+	else
 		pr_info("Route with id %d to %pI4 / %d\n", r->id, &r->dst_ip, r->prefix_len);
 
-		r->nh.mac = r->nh.gw = mac;
-		r->nh.port = priv->port_ignore;
-		r->nh.id = r->id;
+	r->nh.mac = r->nh.gw = mac;
+	r->nh.port = priv->port_ignore;
+	r->nh.id = r->id;
 
-		// Do we need to explicitly add a DMAC entry with the route's nh index?
-		if (priv->r->set_l3_egress_mac)
-			priv->r->set_l3_egress_mac(r->id, mac);
+	// Do we need to explicitly add a DMAC entry with the route's nh index?
+	if (priv->r->set_l3_egress_mac)
+		priv->r->set_l3_egress_mac(r->id, mac);
 
-		// Update ROUTING table: map gateway-mac and switch-mac id to route id
-		rtl83xx_l2_nexthop_add(priv, &r->nh);
+	// Update ROUTING table: map gateway-mac and switch-mac id to route id
+	mutex_lock(&priv->reg_mutex);
+	rtl83xx_l2_nexthop_add(priv, &r->nh);
+	mutex_unlock(&priv->reg_mutex);
 
-		r->attr.valid = true;
-		r->attr.action = ROUTE_ACT_FORWARD;
-		r->attr.type = 0;
-		r->attr.hit = false; // Reset route-used indicator
+	r->attr.valid = true;
+	r->attr.action = ROUTE_ACT_FORWARD;
+	r->attr.hit = false; // Reset route-used indicator
+
+	// Add PIE entry with dst_ip and prefix_len
+	if (is_ipv6) {
+		struct in6_addr ones;
 
-		// Add PIE entry with dst_ip and prefix_len
+		memset(&ones, 0xff, sizeof(ones));
+		r->pr.is_ipv6 = true;
+		r->pr.dip6 = r->dst_ip6;
+		ipv6_addr_prefix(&r->pr.dip6_m, &ones, r->prefix_len);
+	} else {
 		r->pr.dip = r->dst_ip;
 		r->pr.dip_m = inet_make_mask(r->prefix_len);
+	}
 
-		if (r->is_host_route) {
-			int slot = priv->r->find_l3_slot(r, false);
+	if (r->is_host_route) {
+		int slot = priv->r->find_l3_slot(r, false);
 
-			pr_info("%s: Got slot for route: %d\n", __func__, slot);
+		pr_info("%s: Got slot for route: %d\n", __func__, slot);
+		if (slot >= 0)
 			priv->r->host_route_write(slot, r);
-		} else {
-			priv->r->route_write(r->id, r);
-			r->pr.fwd_sel = true;
-			r->pr.fwd_data = r->nh.l2_id;
-			r->pr.fwd_act = PIE_ACT_ROUTE_UC;
+	} else {
+		priv->r->route_write(r->id, r);
+		r->pr.fwd_sel = true;
+		r->pr.fwd_data = r->nh.l2_id;
+		r->pr.fwd_act = PIE_ACT_ROUTE_UC;
+	}
+
+	if (priv->r->set_l3_nexthop)
+		priv->r->set_l3_nexthop(r->nh.id, r->nh.l2_id, r->nh.if_id);
+
+	if (r->pr.id < 0) {
+		r->pr.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
+		if (r->pr.packet_cntr >= 0) {
+			pr_info("Using packet counter %d\n", r->pr.packet_cntr);
+			r->pr.log_sel = true;
+			r->pr.log_data = r->pr.packet_cntr;
 		}
+		priv->r->pie_rule_add(priv, &r->pr);
+	} else {
+		u32 pkts;
 
-		if (priv->r->set_l3_nexthop)
-			priv->r->set_l3_nexthop(r->nh.id, r->nh.l2_id, r->nh.if_id);
+		if (!priv->r->packet_cntr_read(r->pr.packet_cntr, &pkts))
+			pr_info("%s: total packets: %u\n", __func__, pkts);
 
-		if (r->pr.id < 0) {
-			r->pr.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
-			if (r->pr.packet_cntr >= 0) {
-				pr_info("Using packet counter %d\n", r->pr.packet_cntr);
-				r->pr.log_sel = true;
-				r->pr.log_data = r->pr.packet_cntr;
-			}
-			priv->r->pie_rule_add(priv, &r->pr);
-		} else {
-			int pkts = priv->r->packet_cntr_read(r->pr.packet_cntr);
-			pr_info("%s: total packets: %d\n", __func__, pkts);
+		priv->r->pie_rule_write(priv, r->pr.id, &r->pr);
+	}
+}
 
-			priv->r->pie_rule_write(priv, r->pr.id, &r->pr);
-		}
+/*
+ * Updates the L3 next hop entries of all routes via a gateway in the ROUTING table
+ * Called with RTNL held, which keeps the routes from being removed once they are
+ * collected, so they can be updated outside of the RCU read section under reg_mutex
+ */
+static int rtl83xx_l3_nexthop_update(struct rtl838x_switch_priv *priv,  __be32 ip_addr, u64 mac)
+{
+	struct rtl83xx_route *r, *n;
+	struct rhlist_head *tmp, *list;
+	LIST_HEAD(update);
+
+	ASSERT_RTNL();
+
+	rcu_read_lock();
+	list = rhltable_lookup(&priv->routes, &ip_addr, route_ht_params);
+	if (!list) {
+		rcu_read_unlock();
+		return -ENOENT;
 	}
+
+	rhl_for_each_entry_rcu(r, tmp, list, linkage)
+		list_add_tail(&r->update_list, &update);
+	rcu_read_unlock();
+
+	list_for_each_entry_safe(r, n, &update, update_list) {
+		list_del(&r->update_list);
+		pr_info("%s: Setting up fwding: ip %pI4, GW mac %016llx\n",
+			__func__, &ip_addr, mac);
+		rtl83xx_l3_route_update(priv, r, mac);
+	}
+	return 0;
+}
+
+static int rtl83xx_l3_nexthop6_update(struct rtl838x_switch_priv *priv,
+				      const struct in6_addr *ip6_addr, u64 mac)
+{
+	struct rtl83xx_route *r, *n;
+	struct rhlist_head *tmp, *list;
+	LIST_HEAD(update);
+
+	ASSERT_RTNL();
+
+	rcu_read_lock();
+	list = rhltable_lookup(&priv->routes6, ip6_addr, route6_ht_params);
+	if (!list) {
+		rcu_read_unlock();
+		return -ENOENT;
+	}
+
+	rhl_for_each_entry_rcu(r, tmp, list, linkage)
+		list_add_tail(&r->update_list, &update);
 	rcu_read_unlock();
+
+	list_for_each_entry_safe(r, n, &update, update_list) {
+		list_del(&r->update_list);
+		pr_info("%s: Setting up fwding: ip %pI6c, GW mac %016llx\n",
+			__func__, ip6_addr, mac);
+		rtl83xx_l3_route_update(priv, r, mac);
+	}
 	return 0;
 }
 
@@ -887,6 +1254,36 @@ static int rtl83xx_port_ipv4_resolve(struct rtl838x_switch_priv *priv,
 	return err;
 }
 
+static int rtl83xx_port_ipv6_resolve(struct rtl838x_switch_priv *priv,
+				     struct net_device *dev, const struct in6_addr *ip6_addr)
+{
+#if IS_ENABLED(CONFIG_IPV6)
+	struct neighbour *n = neigh_lookup(&nd_tbl, ip6_addr, dev);
+	u64 mac;
+
+	if (!n) {
+		n = neigh_create(&nd_tbl, ip6_addr, dev);
+		if (IS_ERR(n))
+			return PTR_ERR(n);
+	}
+
+	/* Same as for IPv4, install the entry if the neigh is resolved,
+	 * otherwise start neighbour discovery
+	 */
+	if (n->nud_state & NUD_VALID) {
+		mac = ether_addr_to_u64(n->ha);
+		pr_info("%s: resolved mac: %016llx\n", __func__, mac);
+		rtl83xx_l3_nexthop6_update(priv, ip6_addr, mac);
+	} else {
+		pr_info("%s: need to wait\n", __func__);
+		neigh_event_send(n, NULL);
+	}
+
+	neigh_release(n);
+#endif
+	return 0;
+}
+
 struct rtl83xx_walk_data {
 	struct rtl838x_switch_priv *priv;
 	int port;
@@ -923,7 +1320,19 @@ int rtl83xx_port_dev_lower_find(struct net_device *dev, struct rtl838x_switch_pr
 	return data.port;
 }
 
-static struct rtl83xx_route *rtl83xx_route_alloc(struct rtl838x_switch_priv *priv, u32 ip)
+static int rtl83xx_route_insert(struct rtl838x_switch_priv *priv, struct rtl83xx_route *r)
+{
+	if (r->attr.type == 2) // IPv6 unicast
+		return rhltable_insert(&priv->routes6, &r->linkage, route6_ht_params);
+
+	return rhltable_insert(&priv->routes, &r->linkage, route_ht_params);
+}
+
+/*
+ * Allocates a route via the IPv4 gateway ip, or the IPv6 gateway ip6 if not NULL
+ */
+static struct rtl83xx_route *rtl83xx_route_alloc(struct rtl838x_switch_priv *priv, u32 ip,
+						 const struct in6_addr *ip6)
 {
 	struct rtl83xx_route *r;
 	int idx = 0, err;
@@ -941,10 +1350,14 @@ static struct rtl83xx_route *rtl83xx_route_alloc(struct rtl838x_switch_priv *pri
 
 	r->id = idx;
 	r->gw_ip = ip;
+	if (ip6) {
+		r->gw_ip6 = *ip6;
+		r->attr.type = 2; // IPv6 unicast
+	}
 	r->pr.id = -1; // We still need to allocate a rule in HW
 	r->is_host_route = false;
 
-	err = rhltable_insert(&priv->routes, &r->linkage, route_ht_params);
+	err = rtl83xx_route_insert(priv, r);
 	if (err) {
 		pr_err("Could not insert new rule\n");
 		mutex_unlock(&priv->reg_mutex);
@@ -963,7 +1376,8 @@ out_free:
 }
 
 
-static struct rtl83xx_route *rtl83xx_host_route_alloc(struct rtl838x_switch_priv *priv, u32 ip)
+static struct rtl83xx_route *rtl83xx_host_route_alloc(struct rtl838x_switch_priv *priv, u32 ip,
+						      const struct in6_addr *ip6)
 {
 	struct rtl83xx_route *r;
 	int idx = 0, err;
@@ -984,10 +1398,14 @@ static struct rtl83xx_route *rtl83xx_host_route_alloc(struct rtl838x_switch_priv
 	r->id = idx + MAX_ROUTES;
 
 	r->gw_ip = ip;
+	if (ip6) {
+		r->gw_ip6 = *ip6;
+		r->attr.type = 2; // IPv6 unicast
+	}
 	r->pr.id = -1; // We still need to allocate a rule in HW
 	r->is_host_route = true;
 
-	err = rhltable_insert(&priv->routes, &r->linkage, route_ht_params);
+	err = rtl83xx_route_insert(priv, r);
 	if (err) {
 		pr_err("Could not insert new rule\n");
 		mutex_unlock(&priv->reg_mutex);
@@ -1009,16 +1427,21 @@ out_free:
 
 static void rtl83xx_route_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_route *r)
 {
-	int id;
+	int id, err;
 
-	if (rhltable_remove(&priv->routes, &r->linkage, route_ht_params))
+	if (r->attr.type == 2) // IPv6 unicast
+		err = rhltable_remove(&priv->routes6, &r->linkage, route6_ht_params);
+	else
+		err = rhltable_remove(&priv->routes, &r->linkage, route_ht_params);
+	if (err)
 		dev_warn(priv->dev, "Could not remove route\n");
 
 	if (r->is_host_route) {
-		id = priv->r->find_l3_slot(r, false);
+		id = priv->r->find_l3_slot(r, true);
 		pr_debug("%s: Got id for host route: %d\n", __func__, id);
 		r->attr.valid = false;
-		priv->r->host_route_write(id, r);
+		if (id >= 0)
+			priv->r->host_route_write(id, r);
 		clear_bit(r->id - MAX_ROUTES, priv->host_route_use_bm);
 	} else {
 		// If there is a HW representation of the route, delete it
@@ -1026,7 +1449,8 @@ static void rtl83xx_route_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_ro
 			id = priv->r->route_lookup_hw(r);
 			pr_info("%s: Got id for prefix route: %d\n", __func__, id);
 			r->attr.valid = false;
-			priv->r->route_write(id, r);
+			if (id >= 0)
+				priv->r->route_write(id, r);
 		}
 		clear_bit(r->id, priv->route_use_bm);
 	}
@@ -1058,7 +1482,9 @@ static int rtl83xx_fib4_del(struct rtl838x_switch_priv *priv,
 	}
 	rcu_read_unlock();
 
+	mutex_lock(&priv->reg_mutex);
 	rtl83xx_l2_nexthop_rm(priv, &r->nh);
+	mutex_unlock(&priv->reg_mutex);
 
 	pr_debug("%s: Releasing packet counter %d\n", __func__, r->pr.packet_cntr);
 	set_bit(r->pr.packet_cntr, priv->packet_cntr_use_bm);
@@ -1198,9 +1624,9 @@ static int rtl83xx_fib4_add(struct rtl838x_switch_priv *priv,
 
 	// Allocate route or host-route (entry if hardware supports this)
 	if (info->dst_len == 32 && priv->r->host_route_write)
-		r = rtl83xx_host_route_alloc(priv, nh->fib_nh_gw4);
+		r = rtl83xx_host_route_alloc(priv, nh->fib_nh_gw4, NULL);
 	else
-		r = rtl83xx_route_alloc(priv, nh->fib_nh_gw4);
+		r = rtl83xx_route_alloc(priv, nh->fib_nh_gw4, NULL);
 
 	if (!r) {
 		pr_err("%s: No more free route entries\n", __func__);
@@ -1236,7 +1662,8 @@ static int rtl83xx_fib4_add(struct rtl838x_switch_priv *priv,
 
 			slot = priv->r->find_l3_slot(r, false);
 			pr_debug("%s: Got slot for route: %d\n", __func__, slot);
-			priv->r->host_route_write(slot, r);
+			if (slot >= 0)
+				priv->r->host_route_write(slot, r);
 		}
 	}
 
@@ -1253,11 +1680,145 @@ out_free_rt:
 	return 0;
 }
 
+/*
+ * IPv6 unicast routes are offloaded like IPv4 routes: /128 routes go into the host
+ * route table, other prefixes into the prefix route table. This needs the L3 router
+ * MAC and egress interface tables of the RTL93xx.
+ */
 static int rtl83xx_fib6_add(struct rtl838x_switch_priv *priv,
 			    struct fib6_entry_notifier_info *info)
 {
-	pr_debug("In %s\n", __func__);
-//	nh->fib_nh_flags |= RTNH_F_OFFLOAD;
+	struct fib6_info *rt = info->rt;
+	int addr_type = ipv6_addr_type(&rt->fib6_dst.addr);
+	struct rtl83xx_route *r;
+	struct net_device *dev;
+	struct fib6_nh *nh;
+	bool to_localhost;
+	int vlan, port;
+
+	pr_debug("In %s, ip %pI6c, len %d\n", __func__, &rt->fib6_dst.addr, rt->fib6_dst.plen);
+
+	if (!priv->r->host_route_write || !priv->r->set_l3_router_mac)
+		return 0;
+
+	// Routes using nexthop objects and multipath routes are not offloaded
+	if (rt->nh || rt->fib6_nsiblings || rt->fib6_type != RTN_UNICAST)
+		return 0;
+
+	nh = rt->fib6_nh;
+	dev = nh->fib_nh_dev;
+	if (!dev)
+		return 0;
+
+	if (!rt->fib6_dst.plen) {
+		pr_info("Not offloading default route for now\n");
+		return 0;
+	}
+
+	// Do not offload link-local, multicast or loopback destinations
+	if (addr_type & (IPV6_ADDR_LINKLOCAL | IPV6_ADDR_MULTICAST | IPV6_ADDR_LOOPBACK))
+		return 0;
+
+	port = rtl83xx_port_dev_lower_find(dev, priv);
+	if (port < 0)
+		return -1;
+
+	vlan = is_vlan_dev(dev) ? vlan_dev_vlan_id(dev) : 0;
+	to_localhost = nh->fib_nh_gw_family != AF_INET6;
+
+	pr_debug("GW: %pI6c, interface name %s, mac %016llx, vlan %d\n", &nh->fib_nh_gw6,
+		 dev->name, ether_addr_to_u64(dev->dev_addr), vlan);
+
+	if (rt->fib6_dst.plen == 128)
+		r = rtl83xx_host_route_alloc(priv, 0, &nh->fib_nh_gw6);
+	else
+		r = rtl83xx_route_alloc(priv, 0, &nh->fib_nh_gw6);
+
+	if (!r) {
+		pr_err("%s: No more free route entries\n", __func__);
+		return -1;
+	}
+
+	r->dst_ip6 = rt->fib6_dst.addr;
+	r->prefix_len = rt->fib6_dst.plen;
+	r->nh.rvid = vlan;
+
+	if (rtl83xx_alloc_router_mac(priv, ether_addr_to_u64(dev->dev_addr)))
+		goto out_free_rt;
+
+	r->nh.if_id = rtl83xx_alloc_egress_intf(priv, ether_addr_to_u64(dev->dev_addr), vlan);
+	if (r->nh.if_id < 0)
+		goto out_free_rt;
+
+	if (to_localhost) {
+		int slot;
+
+		r->nh.mac = ether_addr_to_u64(dev->dev_addr);
+		r->nh.port = priv->port_ignore;
+		r->attr.valid = true;
+		r->attr.action = ROUTE_ACT_TRAP2CPU;
+
+		slot = priv->r->find_l3_slot(r, false);
+		pr_debug("%s: Got slot for route: %d\n", __func__, slot);
+		if (slot >= 0)
+			priv->r->host_route_write(slot, r);
+	} else {
+		// We need to resolve the mac address of the GW
+		rtl83xx_port_ipv6_resolve(priv, dev, &nh->fib_nh_gw6);
+	}
+
+	nh->fib_nh_flags |= RTNH_F_OFFLOAD;
+
+	return 0;
+
+out_free_rt:
+	rtl83xx_route_rm(priv, r);
+	return 0;
+}
+
+static int rtl83xx_fib6_del(struct rtl838x_switch_priv *priv,
+			    struct fib6_entry_notifier_info *info)
+{
+	struct fib6_info *rt = info->rt;
+	struct rtl83xx_route *r, *found = NULL;
+	struct rhlist_head *tmp, *list;
+	struct fib6_nh *nh;
+
+	pr_debug("In %s, ip %pI6c, len %d\n", __func__, &rt->fib6_dst.addr, rt->fib6_dst.plen);
+	if (rt->nh)
+		return -ENOENT;
+
+	nh = rt->fib6_nh;
+	rcu_read_lock();
+	list = rhltable_lookup(&priv->routes6, &nh->fib_nh_gw6, route6_ht_params);
+	rhl_for_each_entry_rcu(r, tmp, list, linkage) {
+		if (ipv6_addr_equal(&r->dst_ip6, &rt->fib6_dst.addr) &&
+		    r->prefix_len == rt->fib6_dst.plen) {
+			pr_info("%s: found a route with id %d, nh-id %d\n",
+				__func__, r->id, r->nh.id);
+			found = r;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	if (!found)
+		return -ENOENT;
+
+	// The next hop and PIE rule only exist once the gateway was resolved
+	if (found->pr.id >= 0) {
+		mutex_lock(&priv->reg_mutex);
+		rtl83xx_l2_nexthop_rm(priv, &found->nh);
+		mutex_unlock(&priv->reg_mutex);
+		if (found->pr.packet_cntr >= 0)
+			set_bit(found->pr.packet_cntr, priv->packet_cntr_use_bm);
+		priv->r->pie_rule_rm(priv, &found->pr);
+	}
+
+	rtl83xx_route_rm(priv, found);
+
+	nh->fib_nh_flags &= ~RTNH_F_OFFLOAD;
+
 	return 0;
 }
 
@@ -1266,6 +1827,8 @@ struct net_event_work {
 	struct rtl838x_switch_priv *priv;
 	u64 mac;
 	u32 gw_addr;
+	struct in6_addr gw_addr6;
+	bool is_ipv6;
 };
 
 static void rtl83xx_net_event_work_do(struct work_struct *work)
@@ -1274,7 +1837,14 @@ static void rtl83xx_net_event_work_do(struct work_struct *work)
 		container_of(work, struct net_event_work, work);
 	struct rtl838x_switch_priv *priv = net_work->priv;
 
-	rtl83xx_l3_nexthop_update(priv, net_work->gw_addr, net_work->mac);
+	// Serializes against route removal by the FIB event work
+	rtnl_lock();
+	if (net_work->is_ipv6)
+		rtl83xx_l3_nexthop6_update(priv, &net_work->gw_addr6, net_work->mac);
+	else
+		rtl83xx_l3_nexthop_update(priv, net_work->gw_addr, net_work->mac);
+	rtnl_unlock();
+	kfree(net_work);
 }
 
 static int rtl83xx_netevent_event(struct notifier_block *this,
@@ -1297,8 +1867,17 @@ static int rtl83xx_netevent_event(struct notifier_block *this,
 
 	switch (event) {
 	case NETEVENT_NEIGH_UPDATE:
-		if (n->tbl != &arp_tbl)
+		if (n->tbl == &arp_tbl) {
+			net_work->gw_addr = *(__be32 *) n->primary_key;
+#if IS_ENABLED(CONFIG_IPV6)
+		} else if (n->tbl == &nd_tbl) {
+			net_work->gw_addr6 = *(struct in6_addr *) n->primary_key;
+			net_work->is_ipv6 = true;
+#endif
+		} else {
+			kfree(net_work);
 			return NOTIFY_DONE;
+		}
 		dev = n->dev;
 		port = rtl83xx_port_dev_lower_find(dev, priv);
 		if (port < 0 || !(n->nud_state & NUD_VALID)) {
@@ -1308,7 +1887,6 @@ static int rtl83xx_netevent_event(struct notifier_block *this,
 		}
 
 		net_work->mac = ether_addr_to_u64(n->ha);
-		net_work->gw_addr = *(__be32 *) n->primary_key;
 
 		pr_debug("%s: updating neighbour on port %d, mac %016llx\n",
 			__func__, port, net_work->mac);
@@ -1316,6 +1894,8 @@ static int rtl83xx_netevent_event(struct notifier_block *this,
 		if (err)
 			netdev_warn(dev, "failed to handle neigh update (err %d)\n", err);
 		break;
+	default:
+		kfree(net_work);
 	}
 
 	return NOTIFY_DONE;
@@ -1350,16 +1930,22 @@ static void rtl83xx_fib_event_work_do(struct work_struct *work)
 	case FIB_EVENT_ENTRY_APPEND:
 		if (fib_work->is_fib6) {
 			err = rtl83xx_fib6_add(priv, &fib_work->fen6_info);
+			fib6_info_release(fib_work->fen6_info.rt);
 		} else {
 			err = rtl83xx_fib4_add(priv, &fib_work->fen_info);
 			fib_info_put(fib_work->fen_info.fi);
 		}
 		if (err)
-			pr_err("%s: FIB4 failed\n", __func__);
+			pr_err("%s: FIB%d failed\n", __func__, fib_work->is_fib6 ? 6 : 4);
 		break;
 	case FIB_EVENT_ENTRY_DEL:
-		rtl83xx_fib4_del(priv, &fib_work->fen_info);
-		fib_info_put(fib_work->fen_info.fi);
+		if (fib_work->is_fib6) {
+			rtl83xx_fib6_del(priv, &fib_work->fen6_info);
+			fib6_info_release(fib_work->fen6_info.rt);
+		} else {
+			rtl83xx_fib4_del(priv, &fib_work->fen_info);
+			fib_info_put(fib_work->fen_info.fi);
+		}
 		break;
 	case FIB_EVENT_RULE_ADD:
 	case FIB_EVENT_RULE_DEL:
@@ -1419,8 +2005,11 @@ static int rtl83xx_fib_event(struct notifier_block *this, unsigned long event, v
 			fib_info_hold(fib_work->fen_info.fi);
 
 		} else if (info->family == AF_INET6) {
-			struct fib6_entry_notifier_info *fen6_info = ptr;
-			pr_warn("%s: FIB_RULE ADD/DELL for IPv6 not supported\n", __func__);
+			memcpy(&fib_work->fen6_info, ptr, sizeof(fib_work->fen6_info));
+			fib_work->is_fib6 = true;
+			/* Same as for IPv4, hold the route while the work is queued */
+			fib6_info_hold(fib_work->fen6_info.rt);
+		} else {
 			kfree(fib_work);
 			return NOTIFY_DONE;
 		}
@@ -1545,9 +2134,22 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 		 */
 		return err;
 	}
+
+	priv->l2_shadow = kvcalloc(priv->fib_entries + L2_CAM_SIZE,
+				   sizeof(*priv->l2_shadow), GFP_KERNEL);
+	if (!priv->l2_shadow)
+		return -ENOMEM;
+	spin_lock_init(&priv->l2_event_lock);
+	INIT_WORK(&priv->l2_event_work, rtl83xx_l2_event_work_do);
+	INIT_DELAYED_WORK(&priv->l2_resync_work, rtl83xx_l2_resync_work_do);
+	mutex_init(&priv->tc_lock);
+	INIT_LIST_HEAD(&priv->tc_flows);
+	INIT_DELAYED_WORK(&priv->tc_stats_work, rtl83xx_tc_stats_work_do);
+
 	err = dsa_register_switch(priv->ds);
 	if (err) {
 		dev_err(dev, "Error registering switch: %d\n", err);
+		kvfree(priv->l2_shadow);
 		return err;
 	}
 
@@ -1608,7 +2210,8 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	 * Register netdevice event callback to catch changes in link aggregation groups
 	 */
 	priv->nb.notifier_call = rtl83xx_netdevice_event;
-	if (register_netdevice_notifier(&priv->nb)) {
+	err = register_netdevice_notifier(&priv->nb);
+	if (err) {
 		priv->nb.notifier_call = NULL;
 		dev_err(dev, "Failed to register LAG netdev notifier\n");
 		goto err_register_nb;
@@ -1616,13 +2219,15 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 
 	// Initialize hash table for L3 routing
 	rhltable_init(&priv->routes, &route_ht_params);
+	rhltable_init(&priv->routes6, &route6_ht_params);
 
 	/*
 	 * Register netevent notifier callback to catch notifications about neighboring
 	 * changes to update nexthop entries for L3 routing.
 	 */
 	priv->ne_nb.notifier_call = rtl83xx_netevent_event;
-	if (register_netevent_notifier(&priv->ne_nb)) {
+	err = register_netevent_notifier(&priv->ne_nb);
+	if (err) {
 		priv->ne_nb.notifier_call = NULL;
 		dev_err(dev, "Failed to register netevent notifier\n");
 		goto err_register_ne_nb;
@@ -1640,6 +2245,17 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	if (err)
 		goto err_register_fib_nb;
 
+	/*
+	 * Register switchdev notifier to update the L2 shadow from the learning
+	 * notifications the ethernet driver passes on for the master device
+	 */
+	priv->sd_nb.notifier_call = rtl83xx_switchdev_event;
+	err = register_switchdev_notifier(&priv->sd_nb);
+	if (err)
+		goto err_register_sd_nb;
+
+	schedule_delayed_work(&priv->l2_resync_work, 0);
+
 	// TODO: put this into l2_setup()
 	// Flood BPDUs to all ports including cpu-port
 	if (soc_info.family != RTL9300_FAMILY_ID) {
@@ -1656,11 +2272,15 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 
 	return 0;
 
+err_register_sd_nb:
+	unregister_fib_notifier(&init_net, &priv->fib_nb);
 err_register_fib_nb:
 	unregister_netevent_notifier(&priv->ne_nb);
 err_register_ne_nb:
 	unregister_netdevice_notifier(&priv->nb);
 err_register_nb:
+	dsa_unregister_switch(priv->ds);
+	kvfree(priv->l2_shadow);
 	return err;
 }
 
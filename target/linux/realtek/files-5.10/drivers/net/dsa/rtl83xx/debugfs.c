@@ -2,6 +2,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/kernel.h>
+#include <linux/seq_file.h>
 
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 #include "rtl83xx.h"
@@ -270,6 +271,41 @@ static const struct file_operations drop_counter_fops = {
 	.read = drop_counter_read,
 };
 
+static const char *rtl_table_names[RTL_TBL_END] = {
+	"rtl8380_l2", "rtl8380_0", "rtl8380_1",
+	"rtl8390_l2", "rtl8390_0", "rtl8390_1", "rtl8390_2",
+	"rtl9300_l2", "rtl9300_0", "rtl9300_1", "rtl9300_2", "rtl9300_hsb", "rtl9300_hsa",
+	"rtl9310_0", "rtl9310_1", "rtl9310_2", "rtl9310_3", "rtl9310_4", "rtl9310_5",
+};
+
+/*
+ * Access counters of the table access registers, the histogram buckets the
+ * completion latency of each access in powers of 2 starting at 256ns
+ */
+static int table_stats_show(struct seq_file *m, void *v)
+{
+	const struct table_reg *r;
+	struct table_stats st;
+	int i, j;
+
+	seq_puts(m, "table        reads      writes     slow       timeouts   max_ns     histogram\n");
+	for (i = 0; i < RTL_TBL_END; i++) {
+		r = rtl_table_peek(i);
+		// Counters are updated under the table lock, a torn snapshot is fine here
+		st = r->stats;
+		if (!st.reads && !st.writes)
+			continue;
+		seq_printf(m, "%-12s %-10u %-10u %-10u %-10u %-10u", rtl_table_names[i],
+			   st.reads, st.writes, st.slow, st.timeouts, st.max_ns);
+		for (j = 0; j < RTL_TBL_HIST_BUCKETS; j++)
+			seq_printf(m, " %u", st.hist[j]);
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(table_stats);
+
 static ssize_t age_out_read(struct file *filp, char __user *buffer, size_t count,
 			     loff_t *ppos)
 {
@@ -607,6 +643,7 @@ void rtl838x_dbgfs_init(struct rtl838x_switch_priv *priv)
 		goto err;
 
 	debugfs_create_file("drop_counters", 0400, rtl838x_dir, priv, &drop_counter_fops);
+	debugfs_create_file("table_stats", 0400, rtl838x_dir, NULL, &table_stats_fops);
 
 	return;
 err:
@@ -625,4 +662,5 @@ void rtl930x_dbgfs_init(struct rtl838x_switch_priv *priv)
 	priv->dbgfs_dir = dbg_dir;
 
 	debugfs_create_file("drop_counters", 0400, dbg_dir, priv, &drop_counter_fops);
+	debugfs_create_file("table_stats", 0400, dbg_dir, NULL, &table_stats_fops);
 }
@@ -138,8 +138,10 @@ static void rtl83xx_vlan_setup(struct rtl838x_switch_priv *priv)
 	}
 
 	// Initialize all vlans 0-4095
-	for (i = 0; i < MAX_VLANS; i ++)
+	for (i = 0; i < MAX_VLANS; i ++) {
 		priv->r->vlan_set_tagged(i, &info);
+		cond_resched();
+	}
 
 	// reset PVIDs; defaults to 1 on reset
 	for (i = 0; i <= priv->ds->num_ports; i++) {
@@ -1325,6 +1327,7 @@ void rtl83xx_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(1 << (26 + s) | 1 << (23 + s) | port << (5 + (s / 2)), priv->r->l2_tbl_flush_ctrl);
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(26 + s));
+	rtl83xx_l2_shadow_flush_port(priv, port);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1340,6 +1343,7 @@ void rtl931x_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(BIT(24) | BIT(28), RTL931X_L2_TBL_FLUSH_CTRL);
 
 	do { } while (sw_r32(RTL931X_L2_TBL_FLUSH_CTRL) & BIT (28));
+	rtl83xx_l2_shadow_flush_port(priv, port);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1358,6 +1362,7 @@ void rtl930x_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(BIT(26) | BIT(30), RTL930X_L2_TBL_FLUSH_CTRL);
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(30));
+	rtl83xx_l2_shadow_flush_port(priv, port);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1585,28 +1590,43 @@ static void rtl83xx_setup_l2_mc_entry(struct rtl838x_switch_priv *priv,
  * Returns the filled in rtl838x_l2_entry and the index in the bucket when an entry was found
  * when an empty slot was found and must exist is false, the index of the slot is returned
  * when no slots are available returns -1
+ * An entry found in the L2 shadow is confirmed with a single read of its slot, the
+ * bucket is only scanned when the entry is not in the shadow or the shadow is stale
  */
-static int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed,
-				     bool must_exist, struct rtl838x_l2_entry *e)
+int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed,
+			       bool must_exist, struct rtl838x_l2_entry *e)
 {
-	int i, idx = -1;
+	int i, idx;
 	u32 key = priv->r->l2_hash_key(priv, seed);
+	struct rtl83xx_l2_shadow *s;
 	u64 entry;
 
 	pr_debug("%s: using key %x, for seed %016llx\n", __func__, key, seed);
+	for (i = 0; i < priv->l2_bucket_size; i++) {
+		idx = rtl83xx_l2_hash_idx(key, i);
+		if (idx >= priv->fib_entries)
+			continue;
+		s = &priv->l2_shadow[idx];
+		if (!s->valid || s->seed != seed)
+			continue;
+		entry = rtl83xx_l2_read_hash(priv, idx, e);
+		if (e->valid && (entry & 0x0fffffffffffffffULL) == seed)
+			return idx;
+		break;
+	}
+
 	// Loop over all entries in the hash-bucket and over the second block on 93xx SoCs
 	for (i = 0; i < priv->l2_bucket_size; i++) {
-		entry = priv->r->read_l2_entry_using_hash(key, i, e);
+		idx = rtl83xx_l2_hash_idx(key, i);
+		entry = rtl83xx_l2_read_hash(priv, idx, e);
 		pr_debug("valid %d, mac %016llx\n", e->valid, ether_addr_to_u64(&e->mac[0]));
 		if (must_exist && !e->valid)
 			continue;
-		if (!e->valid || ((entry & 0x0fffffffffffffffULL) == seed)) {
-			idx = i > 3 ? ((key >> 14) & 0xffff) | i >> 1 : ((key << 2) | i) & 0xffff;
-			break;
-		}
+		if (!e->valid || ((entry & 0x0fffffffffffffffULL) == seed))
+			return idx;
 	}
 
-	return idx;
+	return -1;
 }
 
 /*
@@ -1615,14 +1635,24 @@ static int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed
  * when an empty slot was found the index of the slot is returned
  * when no slots are available returns -1
  */
-static int rtl83xx_find_l2_cam_entry(struct rtl838x_switch_priv *priv, u64 seed,
-				     bool must_exist, struct rtl838x_l2_entry *e)
+int rtl83xx_find_l2_cam_entry(struct rtl838x_switch_priv *priv, u64 seed,
+			      bool must_exist, struct rtl838x_l2_entry *e)
 {
+	struct rtl83xx_l2_shadow *s = &priv->l2_shadow[priv->fib_entries];
 	int i, idx = -1;
 	u64 entry;
 
-	for (i = 0; i < 64; i++) {
-		entry = priv->r->read_cam(i, e);
+	for (i = 0; i < L2_CAM_SIZE; i++) {
+		if (!s[i].valid || s[i].seed != seed)
+			continue;
+		entry = rtl83xx_l2_read_cam(priv, i, e);
+		if (e->valid && (entry & 0x0fffffffffffffffULL) == seed)
+			return i;
+		break;
+	}
+
+	for (i = 0; i < L2_CAM_SIZE; i++) {
+		entry = rtl83xx_l2_read_cam(priv, i, e);
 		if (!must_exist && !e->valid) {
 			if (idx < 0) /* First empty entry? */
 				idx = i;
@@ -1657,16 +1687,16 @@ static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
 	// Found an existing or empty entry
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
-		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_write_hash(priv, idx, &e);
 		goto out;
 	}
 
 	// Hash buckets full, try CAM
-	rtl83xx_find_l2_cam_entry(priv, seed, false, &e);
+	idx = rtl83xx_find_l2_cam_entry(priv, seed, false, &e);
 
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
-		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_write_cam(priv, idx, &e);
 		goto out;
 	}
 
@@ -1694,16 +1724,16 @@ static int rtl83xx_port_fdb_del(struct dsa_switch *ds, int port,
 		pr_info("Found entry index %d, key %d and bucket %d\n", idx, idx >> 2, idx & 3);
 		e.valid = false;
 		dump_l2_entry(&e);
-		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_write_hash(priv, idx, &e);
 		goto out;
 	}
 
 	/* Check CAM for spillover from hash buckets */
-	rtl83xx_find_l2_cam_entry(priv, seed, true, &e);
+	idx = rtl83xx_find_l2_cam_entry(priv, seed, true, &e);
 
 	if (idx >= 0) {
 		e.valid = false;
-		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_write_cam(priv, idx, &e);
 		goto out;
 	}
 	err = -ENOENT;
@@ -1715,56 +1745,28 @@ out:
 static int rtl83xx_port_fdb_dump(struct dsa_switch *ds, int port,
 				 dsa_fdb_dump_cb_t *cb, void *data)
 {
-	struct rtl838x_l2_entry e;
 	struct rtl838x_switch_priv *priv = ds->priv;
+	struct rtl83xx_l2_shadow *s;
+	u8 mac[ETH_ALEN];
 	int i;
-	u32 fid, pkey;
-	u64 mac;
 
 	mutex_lock(&priv->reg_mutex);
 
-	for (i = 0; i < priv->fib_entries; i++) {
-		priv->r->read_l2_entry_using_hash(i >> 2, i & 0x3, &e);
+	if (!priv->l2_shadow_synced)
+		rtl83xx_l2_shadow_sync(priv);
 
-		if (!e.valid)
+	// Hash table entries, followed by the CAM
+	for (i = 0; i < priv->fib_entries + L2_CAM_SIZE; i++) {
+		s = &priv->l2_shadow[i];
+		if (!s->valid)
 			continue;
 
-		if (e.port == port || e.port == RTL930X_PORT_IGNORE) {
-			u64 seed;
-			u32 key;
-
-			fid = ((i >> 2) & 0x3ff) | (e.rvid & ~0x3ff);
-			mac = ether_addr_to_u64(&e.mac[0]);
-			pkey = priv->r->l2_hash_key(priv, priv->r->l2_hash_seed(mac, fid));
-			fid = (pkey & 0x3ff) | (fid & ~0x3ff);
-			pr_info("-> index %d, key %x, bucket %d, dmac %016llx, fid: %x rvid: %x\n",
-				i, i >> 2, i & 0x3, mac, fid, e.rvid);
-			dump_l2_entry(&e);
-			seed = priv->r->l2_hash_seed(mac, e.rvid);
-			key = priv->r->l2_hash_key(priv, seed);
-			pr_info("seed: %016llx, key based on rvid: %08x\n", seed, key);
-			cb(e.mac, e.vid, e.is_static, data);
-		}
-		if (e.type == L2_MULTICAST) {
-			u64 portmask = priv->r->read_mcast_pmask(e.mc_portmask_index);
-
-			if (portmask & BIT_ULL(port)) {
-				dump_l2_entry(&e);
-				pr_info("  PM: %016llx\n", portmask);
-			}
+		if (s->port == port || (i < priv->fib_entries && s->port == RTL930X_PORT_IGNORE)) {
+			u64_to_ether_addr(s->mac, mac);
+			cb(mac, s->vid, s->is_static, data);
 		}
 	}
 
-	for (i = 0; i < 64; i++) {
-		priv->r->read_cam(i, &e);
-
-		if (!e.valid)
-			continue;
-
-		if (e.port == port)
-			cb(e.mac, e.vid, e.is_static, data);
-	}
-
 	mutex_unlock(&priv->reg_mutex);
 	return 0;
 }
@@ -1816,13 +1818,13 @@ static void rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 				goto out;
 			}
 			rtl83xx_setup_l2_mc_entry(priv, &e, vid, mac, mc_group);
-			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_write_hash(priv, idx, &e);
 		}
 		goto out;
 	}
 
 	// Hash buckets full, try CAM
-	rtl83xx_find_l2_cam_entry(priv, seed, false, &e);
+	idx = rtl83xx_find_l2_cam_entry(priv, seed, false, &e);
 
 	if (idx >= 0) {
 		if (e.valid) {
@@ -1837,7 +1839,7 @@ static void rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 				goto out;
 			}
 			rtl83xx_setup_l2_mc_entry(priv, &e, vid, mac, mc_group);
-			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_write_cam(priv, idx, &e);
 		}
 		goto out;
 	}
@@ -1877,20 +1879,20 @@ int rtl83xx_port_mdb_del(struct dsa_switch *ds, int port,
 		if (!portmask) {
 			e.valid = false;
 			// dump_l2_entry(&e);
-			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_write_hash(priv, idx, &e);
 		}
 		goto out;
 	}
 
 	/* Check CAM for spillover from hash buckets */
-	rtl83xx_find_l2_cam_entry(priv, seed, true, &e);
+	idx = rtl83xx_find_l2_cam_entry(priv, seed, true, &e);
 
 	if (idx >= 0) {
 		portmask = rtl83xx_mc_group_del_port(priv, e.mc_portmask_index, port);
 		if (!portmask) {
 			e.valid = false;
 			// dump_l2_entry(&e);
-			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_write_cam(priv, idx, &e);
 		}
 		goto out;
 	}
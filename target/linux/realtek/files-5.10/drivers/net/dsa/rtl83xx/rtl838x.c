@@ -1537,27 +1537,29 @@ static void rtl838x_pie_init(struct rtl838x_switch_priv *priv)
 	sw_w32(0b10101010101, RTL838X_ACL_BLK_GROUP_CTRL);
 }
 
-static u32 rtl838x_packet_cntr_read(int counter)
+static int rtl838x_packet_cntr_read(int counter, u32 *v)
 {
-	u32 v;
-
 	// Read LOG table (3) via register RTL8380_TBL_0
 	struct table_reg *r = rtl_table_get(RTL8380_TBL_0, 3);
+	int err;
 
 	pr_debug("In %s, id %d\n", __func__, counter);
-	rtl_table_read(r, counter / 2);
+	err = rtl_table_read(r, counter / 2);
+	if (err)
+		goto out;
 
 	pr_debug("Registers: %08x %08x\n",
 		sw_r32(rtl_table_data(r, 0)), sw_r32(rtl_table_data(r, 1)));
 	// The table has a size of 2 registers
 	if (counter % 2)
-		v = sw_r32(rtl_table_data(r, 0));
+		*v = sw_r32(rtl_table_data(r, 0));
 	else
-		v = sw_r32(rtl_table_data(r, 1));
+		*v = sw_r32(rtl_table_data(r, 1));
 
+out:
 	rtl_table_release(r);
 
-	return v;
+	return err;
 }
 
 static void rtl838x_packet_cntr_clear(int counter)
@@ -591,6 +591,10 @@ typedef enum {
 #define MAX_ROUTER_MACS 64
 #define L3_EGRESS_DMACS 2048
 #define MAX_SMACS 64
+#define L2_CAM_SIZE 64
+#define L2_RESYNC_CHUNK 256
+#define L2_RESYNC_PERIOD (10 * HZ)
+#define L2_MAX_EVENTS 64
 
 enum phy_type {
 	PHY_NONE = 0,
@@ -684,6 +688,22 @@ struct rtl838x_l2_entry {
 	int l2_tunnel_list_id;
 };
 
+/*
+ * Software copy of an L2 table slot, the hash table slots are followed by
+ * the L2_CAM_SIZE CAM slots. Used to find entries and dump the FDB without
+ * scanning the hardware table
+ */
+struct rtl83xx_l2_shadow {
+	u64 seed;
+	u64 mac;
+	u16 vid;
+	u16 mc_portmask_index;
+	u8 port;
+	bool valid;
+	bool is_static;
+	bool next_hop;
+};
+
 enum fwd_rule_action {
 	FWD_RULE_ACTION_NONE = 0,
 	FWD_RULE_ACTION_FWD = 1,
@@ -720,6 +740,7 @@ struct pie_rule {
 	// The following are requirements for the pie template
 	bool is_egress;
 	bool is_ipv6;		// This is a rule with IPv6 fields
+	bool is_cntr_rule;	// Counting-only rule, placed in the reserved counting blocks
 
 	// Fixed fields that are always matched against on RTL8380
 	u8 spmmask_fix;
@@ -909,9 +930,16 @@ struct rtl83xx_flow {
 	unsigned long cookie;
 	struct rhash_head node;
 	struct rcu_head rcu_head;
+	struct list_head list;		// In tc_flows, protected by tc_lock
 	struct rtl838x_switch_priv *priv;
 	struct pie_rule rule;
+	struct pie_rule cntr_rule;	// Same match as rule, logging octets only
 	u32 flags;
+	u64 packets;			// Totals accumulated from the HW counters
+	u64 bytes;
+	u64 reported_packets;		// Totals last passed to FLOW_CLS_STATS
+	u64 reported_bytes;
+	unsigned long lastused;
 };
 
 struct rtl93xx_route_attr {
@@ -929,11 +957,13 @@ struct rtl93xx_route_attr {
 struct rtl83xx_route {
 	u32 gw_ip;			// IP of the route's gateway
 	u32 dst_ip;			// IP of the destination net
+	struct in6_addr gw_ip6;		// IPv6 gateway, for attr.type 2 (IPv6 unicast)
 	struct in6_addr dst_ip6;
 	int prefix_len;			// Network prefix len of the destination net
 	bool is_host_route;
 	int id;				// ID number of this route
 	struct rhlist_head linkage;
+	struct list_head update_list;	// Next hop update in progress, under RTNL
 	u16 switch_mac_id;		// Index into switch's own MACs, RTL839X only
 	struct rtl83xx_nexthop nh;
 	struct pie_rule pr;
@@ -1019,8 +1049,10 @@ struct rtl838x_reg {
 	int (*pie_rule_add)(struct rtl838x_switch_priv *priv, struct pie_rule *rule);
 	void (*pie_rule_rm)(struct rtl838x_switch_priv *priv, struct pie_rule *rule);
 	void (*l2_learning_setup)(void);
-	u32 (*packet_cntr_read)(int counter);
+	int (*packet_cntr_read)(int counter, u32 *val);
 	void (*packet_cntr_clear)(int counter);
+	int (*octet_cntr_read)(int counter, u64 *val);
+	void (*octet_cntr_clear)(int counter);
 	void (*route_read)(int idx, struct rtl83xx_route *rt);
 	void (*route_write)(int idx, struct rtl83xx_route *rt);
 	void (*host_route_write)(int idx, struct rtl83xx_route *rt);
@@ -1060,6 +1092,16 @@ struct rtl838x_switch_priv {
 	u64 irq_mask;
 	u32 fib_entries;
 	int l2_bucket_size;
+	struct rtl83xx_l2_shadow *l2_shadow;
+	bool l2_shadow_synced;
+	int l2_resync_pos;
+	struct delayed_work l2_resync_work;
+	struct notifier_block sd_nb;
+	spinlock_t l2_event_lock;
+	u64 l2_events[L2_MAX_EVENTS];	// MAC | FID << 48 | add << 63
+	int l2_n_events;
+	bool l2_events_lost;
+	struct work_struct l2_event_work;
 	struct dentry *dbgfs_dir;
 	int n_lags;
 	u64 lags_port_members[MAX_LAGS];
@@ -1075,11 +1117,15 @@ struct rtl838x_switch_priv {
 	int mc_group_saves[MAX_MC_GROUPS];
 	int n_pie_blocks;
 	struct rhashtable tc_ht;
+	struct mutex tc_lock;
+	struct list_head tc_flows;
+	struct delayed_work tc_stats_work;
 	unsigned long int pie_use_bm[MAX_PIE_ENTRIES >> 5];
 	int n_counters;
 	unsigned long int octet_cntr_use_bm[MAX_COUNTERS >> 5];
 	unsigned long int packet_cntr_use_bm[MAX_COUNTERS >> 4];
 	struct rhltable routes;
+	struct rhltable routes6;
 	unsigned long int route_use_bm[MAX_ROUTES >> 5];
 	unsigned long int host_route_use_bm[MAX_HOST_ROUTES >> 5];
 	struct rtl838x_l3_intf *interfaces[MAX_INTERFACES];
@@ -72,6 +72,9 @@ enum template_field_id {
 	TEMPLATE_FIELD_DIP7 = 61,
 };
 
+// Blocks at the end of the ingress and egress halves which only hold counting rules
+#define RTL839X_PIE_CNTR_BLOCKS 2
+
 // Number of fixed templates predefined in the SoC
 #define N_FIXED_TEMPLATES 5
 static enum template_field_id fixed_templates[N_FIXED_TEMPLATES][N_FIXED_FIELDS] =
@@ -1541,6 +1544,11 @@ static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 		min_block = max_block;
 		max_block = priv->n_pie_blocks;
 	}
+	// Counting rules have blocks of their own, see rtl839x_pie_init()
+	if (pr->is_cntr_rule)
+		min_block = max_block - RTL839X_PIE_CNTR_BLOCKS;
+	else
+		max_block -= RTL839X_PIE_CNTR_BLOCKS;
 
 	mutex_lock(&priv->pie_mutex);
 
@@ -1555,7 +1563,7 @@ static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 			break;
 	}
 
-	if (block >= priv->n_pie_blocks) {
+	if (block >= max_block) {
 		mutex_unlock(&priv->pie_mutex);
 		return -EOPNOTSUPP;
 	}
@@ -1631,27 +1639,40 @@ static void rtl839x_pie_init(struct rtl838x_switch_priv *priv)
 	template_selectors = 2 | (3 << 3);
 	for (i = 15; i < 18; i++)
 		sw_w32(template_selectors, RTL839X_ACL_BLK_TMPLTE_CTRL(i));
+
+	/*
+	 * The last RTL839X_PIE_CNTR_BLOCKS blocks of each half take only the octet
+	 * counting rules of tc flows. Such a rule has no actions, so it must not share
+	 * a block with other rules which it would shadow. The first of them gets
+	 * templates 0, 1 so that a counting rule fits whichever templates its flow's
+	 * rule uses.
+	 */
+	template_selectors = 0 | (1 << 3);
+	sw_w32(template_selectors, RTL839X_ACL_BLK_TMPLTE_CTRL(9 - RTL839X_PIE_CNTR_BLOCKS));
+	sw_w32(template_selectors, RTL839X_ACL_BLK_TMPLTE_CTRL(18 - RTL839X_PIE_CNTR_BLOCKS));
 }
 
-static u32 rtl839x_packet_cntr_read(int counter)
+static int rtl839x_packet_cntr_read(int counter, u32 *v)
 {
-	u32 v;
-
 	// Read LOG table (4) via register RTL8390_TBL_0
 	struct table_reg *r = rtl_table_get(RTL8390_TBL_0, 4);
+	int err;
 
 	pr_debug("In %s, id %d\n", __func__, counter);
-	rtl_table_read(r, counter / 2);
+	err = rtl_table_read(r, counter / 2);
+	if (err)
+		goto out;
 
 	// The table has a size of 2 registers
 	if (counter % 2)
-		v = sw_r32(rtl_table_data(r, 0));
+		*v = sw_r32(rtl_table_data(r, 0));
 	else
-		v = sw_r32(rtl_table_data(r, 1));
+		*v = sw_r32(rtl_table_data(r, 1));
 
+out:
 	rtl_table_release(r);
 
-	return v;
+	return err;
 }
 
 static void rtl839x_packet_cntr_clear(int counter)
@@ -1671,6 +1692,41 @@ static void rtl839x_packet_cntr_clear(int counter)
 	rtl_table_release(r);
 }
 
+static int rtl839x_octet_cntr_read(int counter, u64 *v)
+{
+	// Read LOG table (4) via register RTL8390_TBL_0
+	struct table_reg *r = rtl_table_get(RTL8390_TBL_0, 4);
+	int err;
+
+	pr_debug("In %s, id %d\n", __func__, counter);
+	err = rtl_table_read(r, counter);
+	if (err)
+		goto out;
+
+	// An octet counter takes up both registers of the entry
+	*v = ((u64)sw_r32(rtl_table_data(r, 0))) << 32;
+	*v |= sw_r32(rtl_table_data(r, 1));
+
+out:
+	rtl_table_release(r);
+
+	return err;
+}
+
+static void rtl839x_octet_cntr_clear(int counter)
+{
+	// Access LOG table (4) via register RTL8390_TBL_0
+	struct table_reg *r = rtl_table_get(RTL8390_TBL_0, 4);
+
+	pr_debug("In %s, id %d\n", __func__, counter);
+	sw_w32(0, rtl_table_data(r, 0));
+	sw_w32(0, rtl_table_data(r, 1));
+
+	rtl_table_write(r, counter);
+
+	rtl_table_release(r);
+}
+
 static void rtl839x_route_read(int idx, struct rtl83xx_route *rt)
 {
 	u64 v;
@@ -1884,6 +1940,8 @@ const struct rtl838x_reg rtl839x_reg = {
 	.l2_learning_setup = rtl839x_l2_learning_setup,
 	.packet_cntr_read = rtl839x_packet_cntr_read,
 	.packet_cntr_clear = rtl839x_packet_cntr_clear,
+	.octet_cntr_read = rtl839x_octet_cntr_read,
+	.octet_cntr_clear = rtl839x_octet_cntr_clear,
 	.route_read = rtl839x_route_read,
 	.route_write = rtl839x_route_write,
 	.l3_setup = rtl839x_l3_setup,
@@ -25,6 +25,17 @@ struct rtl83xx_mib_desc {
 };
 
 /* API for switch table access */
+#define RTL_TBL_HIST_BUCKETS	12	// Latency buckets: < 256ns, < 512ns, ... , >= 262us
+
+struct table_stats {
+	u32 reads;
+	u32 writes;
+	u32 slow;		// Accesses which did not complete while spinning
+	u32 timeouts;
+	u32 max_ns;
+	u32 hist[RTL_TBL_HIST_BUCKETS];
+};
+
 struct table_reg {
 	u16 addr;
 	u16 data;
@@ -34,6 +45,14 @@ struct table_reg {
 	u8 rmode;
 	u8 tbl;
 	struct mutex lock;
+	struct table_stats stats;	// Protected by lock
+};
+
+/* A read or write of one entry in a batch of table accesses, see rtl_table_batch() */
+struct table_op {
+	int idx;
+	bool write;
+	u32 *data;		// Words read from or written to the data registers
 };
 
 #define TBL_DESC(_addr, _data, _max_data, _c_bit, _t_bit, _rmode) \
@@ -67,8 +86,10 @@ typedef enum {
 void rtl_table_init(void);
 struct table_reg *rtl_table_get(rtl838x_tbl_reg_t r, int t);
 void rtl_table_release(struct table_reg *r);
-void rtl_table_read(struct table_reg *r, int idx);
-void rtl_table_write(struct table_reg *r, int idx);
+int rtl_table_read(struct table_reg *r, int idx);
+int rtl_table_write(struct table_reg *r, int idx);
+int rtl_table_batch(struct table_reg *r, struct table_op *ops, int n, int n_data);
+const struct table_reg *rtl_table_peek(rtl838x_tbl_reg_t r);
 inline u16 rtl_table_data(struct table_reg *r, int i);
 inline u32 rtl_table_data_r(struct table_reg *r, int i);
 inline void rtl_table_data_w(struct table_reg *r, u32 v, int i);
@@ -76,6 +97,8 @@ inline void rtl_table_data_w(struct table_reg *r, u32 v, int i);
 void __init rtl83xx_setup_qos(struct rtl838x_switch_priv *priv);
 
 int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv);
+int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv);
+void rtl83xx_tc_stats_work_do(struct work_struct *work);
 
 int rtl83xx_port_is_under(const struct net_device * dev, struct rtl838x_switch_priv *priv);
 
@@ -130,6 +153,28 @@ int rtl931x_sds_cmu_band_get(int sds, phy_interface_t mode);
 int rtl931x_sds_cmu_band_set(int sds, bool enable, u32 band, phy_interface_t mode);
 void rtl931x_sds_init(u32 sds, phy_interface_t mode);
 
+int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed,
+			       bool must_exist, struct rtl838x_l2_entry *e);
+int rtl83xx_find_l2_cam_entry(struct rtl838x_switch_priv *priv, u64 seed,
+			      bool must_exist, struct rtl838x_l2_entry *e);
+u64 rtl83xx_l2_read_hash(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e);
+u64 rtl83xx_l2_read_cam(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e);
+void rtl83xx_l2_write_hash(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e);
+void rtl83xx_l2_write_cam(struct rtl838x_switch_priv *priv, int idx, struct rtl838x_l2_entry *e);
+void rtl83xx_l2_shadow_sync(struct rtl838x_switch_priv *priv);
+void rtl83xx_l2_shadow_flush_port(struct rtl838x_switch_priv *priv, int port);
+
+/*
+ * Returns the L2 table index of position pos in the hash bucket identified by key,
+ * on RTL93xx positions 4-7 are in the bucket of the second hash in key >> 16
+ */
+static inline int rtl83xx_l2_hash_idx(u32 key, int pos)
+{
+	if (pos > 3)
+		return (((key >> 16) << 2) | (pos - 4)) & 0xffff;
+	return ((key << 2) | pos) & 0xffff;
+}
+
 int rtl83xx_lag_add(struct dsa_switch *ds, int group, int port, struct netdev_lag_upper_info *info);
 int rtl83xx_lag_del(struct dsa_switch *ds, int group, int port);
 
@@ -1124,43 +1124,38 @@ static void rtl930x_net6_mask(int prefix_len, struct in6_addr *ip6_m)
 	// Define network mask
 	o = prefix_len >> 3;
 	b = prefix_len & 0x7;
+	memset(ip6_m->s6_addr, 0, sizeof(ip6_m->s6_addr));
 	memset(ip6_m->s6_addr, 0xff, o);
-	ip6_m->s6_addr[o] |= b ? 0xff00 >> b : 0x00;
+	if (o < 16)
+		ip6_m->s6_addr[o] |= b ? 0xff00 >> b : 0x00;
 }
 
 /*
  * Read a host route entry from the table using its index
  * We currently only support IPv4 and IPv6 unicast route
  */
-static void rtl930x_host_route_read(int idx, struct rtl83xx_route *rt)
+/*
+ * Decodes an L3_HOST_ROUTE_IPUC entry from the first 5 data registers of the table
+ */
+static void rtl930x_host_route_parse(const u32 *d, struct rtl83xx_route *rt)
 {
-	u32 v;
-	// Read L3_HOST_ROUTE_IPUC table (1) via register RTL9300_TBL_1
-	struct table_reg *r = rtl_table_get(RTL9300_TBL_1, 1);
+	u32 v = d[0];
 
-	idx = ((idx / 6) * 8) + (idx % 6);
-
-	pr_debug("In %s, physical index %d\n", __func__, idx);
-	rtl_table_read(r, idx);
-	// The table has a size of 5 (for UC, 11 for MC) registers
-	v = sw_r32(rtl_table_data(r, 0));
 	rt->attr.valid = !!(v & BIT(31));
 	if (!rt->attr.valid)
-		goto out;
+		return;
 	rt->attr.type = (v >> 29) & 0x3;
 	switch (rt->attr.type) {
 	case 0: // IPv4 Unicast route
-		rt->dst_ip = sw_r32(rtl_table_data(r, 4));
+		rt->dst_ip = d[4];
 		break;
 	case 2: // IPv6 Unicast route
-		ipv6_addr_set(&rt->dst_ip6,
-			      sw_r32(rtl_table_data(r, 3)), sw_r32(rtl_table_data(r, 2)),
-			      sw_r32(rtl_table_data(r, 1)), sw_r32(rtl_table_data(r, 0)));
+		ipv6_addr_set(&rt->dst_ip6, d[1], d[2], d[3], d[4]);
 		break;
 	case 1: // IPv4 Multicast route
 	case 3: // IPv6 Multicast route
 		pr_warn("%s: route type not supported\n", __func__);
-		goto out;
+		return;
 	}
 
 	rt->attr.hit = !!(v & BIT(20));
@@ -1171,14 +1166,28 @@ static void rtl930x_host_route_read(int idx, struct rtl83xx_route *rt)
 	rt->attr.ttl_check = !!(v & BIT(4));
 	rt->attr.qos_as = !!(v & BIT(3));
 	rt->attr.qos_prio =  v & 0x7;
-	pr_debug("%s: index %d is valid: %d\n", __func__, idx, rt->attr.valid);
 	pr_debug("%s: next_hop: %d, hit: %d, action :%d, ttl_dec %d, ttl_check %d, dst_null %d\n",
 		__func__, rt->nh.id, rt->attr.hit, rt->attr.action, rt->attr.ttl_dec, rt->attr.ttl_check,
 		rt->attr.dst_null);
 	pr_debug("%s: Destination: %pI4\n", __func__, &rt->dst_ip);
+}
 
-out:
+static void rtl930x_host_route_read(int idx, struct rtl83xx_route *rt)
+{
+	u32 d[5];
+	struct table_op op = { .data = d };
+	// Read L3_HOST_ROUTE_IPUC table (1) via register RTL9300_TBL_1
+	struct table_reg *r = rtl_table_get(RTL9300_TBL_1, 1);
+
+	op.idx = ((idx / 6) * 8) + (idx % 6);
+
+	pr_debug("In %s, physical index %d\n", __func__, op.idx);
+	// The table has a size of 5 (for UC, 11 for MC) registers
+	if (rtl_table_batch(r, &op, 1, ARRAY_SIZE(d)))
+		memset(d, 0, sizeof(d));
 	rtl_table_release(r);
+
+	rtl930x_host_route_parse(d, rt);
 }
 
 /*
@@ -1200,7 +1209,7 @@ static void rtl930x_host_route_write(int idx, struct rtl83xx_route *rt)
 		rt->attr.dst_null);
 	pr_debug("%s: GW: %pI4, prefix_len: %d\n", __func__, &rt->dst_ip, rt->prefix_len);
 
-	v = BIT(31); // Entry is valid
+	v = rt->attr.valid ? BIT(31) : 0;
 	v |= (rt->attr.type & 0x3) << 29;
 	v |= rt->attr.hit ? BIT(20) : 0;
 	v |= rt->attr.dst_null ? BIT(19) : 0;
@@ -1250,11 +1259,11 @@ static int rtl930x_route_lookup_hw(struct rtl83xx_route *rt)
 	if (rt->attr.type == 1 || rt->attr.type == 3) // Hardware only supports UC routes
 		return -1;
 
-	sw_w32_mask(0x3 << 19, rt->attr.type, RTL930X_L3_HW_LU_KEY_CTRL);
+	sw_w32_mask(0x3 << 19, rt->attr.type << 19, RTL930X_L3_HW_LU_KEY_CTRL);
 	if (rt->attr.type) { // IPv6
 		rtl930x_net6_mask(rt->prefix_len, &ip6_m);
 		for (i = 0; i < 4; i++)
-			sw_w32(rt->dst_ip6.s6_addr32[0] & ip6_m.s6_addr32[0],
+			sw_w32(rt->dst_ip6.s6_addr32[i] & ip6_m.s6_addr32[i],
 			       RTL930X_L3_HW_LU_KEY_IP_CTRL + (i << 2));
 	} else { // IPv4
 		ip4_m = inet_make_mask(rt->prefix_len);
@@ -1283,38 +1292,69 @@ static int rtl930x_route_lookup_hw(struct rtl83xx_route *rt)
 	return -1;
 }
 
+/*
+ * Find the slot of a host route in the L3_HOST_ROUTE_IPUC table. Returns the slot
+ * holding the route, or when must_exist is false and the route is not in the table,
+ * the first free slot. Returns -1 if neither was found
+ */
 static int rtl930x_find_l3_slot(struct rtl83xx_route *rt, bool must_exist)
 {
-	int t, s, slot_width, algorithm, addr, idx;
+	int t, s, i, n = 0, slot_width, algorithm, idx, free_idx = -1;
 	u32 hash;
+	u32 d[12][5];
+	struct table_op ops[12];
 	struct rtl83xx_route route_entry;
+	struct table_reg *r;
 
 	// IPv6 entries take up 3 slots
-	slot_width = (rt->attr.type == 0) || (rt->attr.type == 2) ? 1 : 3;
+	slot_width = rt->attr.type == 0 ? 1 : 3;
 
 	for (t = 0; t < 2; t++) {
 		algorithm = (sw_r32(RTL930X_L3_HOST_TBL_CTRL) >> (2 + t)) & 0x1;
-		hash = rtl930x_l3_hash4(rt->dst_ip, algorithm, false);
+		if (rt->attr.type == 2)
+			hash = rtl930x_l3_hash6(&rt->dst_ip6, algorithm, false);
+		else
+			hash = rtl930x_l3_hash4(rt->dst_ip, algorithm, false);
 
 		pr_debug("%s: table %d, algorithm %d, hash %04x\n", __func__, t, algorithm, hash);
 
 		for (s = 0; s < 6; s += slot_width) {
-			addr = (t << 12) | ((hash & 0x1ff) << 3) | s;
-			pr_debug("%s physical address %d\n", __func__, addr);
-			idx = ((addr / 8) * 6) + (addr % 8);
-			pr_debug("%s logical address %d\n", __func__, idx);
-
-			rtl930x_host_route_read(idx, &route_entry);
-			pr_debug("%s route valid %d, route dest: %pI4, hit %d\n", __func__,
-				rt->attr.valid, &rt->dst_ip, rt->attr.hit);
-			if (!must_exist && rt->attr.valid)
-				return idx;
-			if (must_exist && route_entry.dst_ip == rt->dst_ip)
-				return idx;
+			ops[n].idx = (t << 12) | ((hash & 0x1ff) << 3) | s;
+			ops[n].write = false;
+			ops[n].data = d[n];
+			n++;
 		}
 	}
 
-	return -1;
+	// Fetch all candidate slots of both hash tables under a single table lock
+	r = rtl_table_get(RTL9300_TBL_1, 1);
+	if (rtl_table_batch(r, ops, n, ARRAY_SIZE(d[0]))) {
+		rtl_table_release(r);
+		return -1;
+	}
+	rtl_table_release(r);
+
+	for (i = 0; i < n; i++) {
+		idx = ((ops[i].idx / 8) * 6) + (ops[i].idx % 8);
+		pr_debug("%s physical address %d, logical address %d\n", __func__, ops[i].idx, idx);
+
+		rtl930x_host_route_parse(d[i], &route_entry);
+		pr_debug("%s route valid %d, route dest: %pI4, hit %d\n", __func__,
+			route_entry.attr.valid, &route_entry.dst_ip, route_entry.attr.hit);
+		if (!route_entry.attr.valid) {
+			if (free_idx < 0)
+				free_idx = idx;
+			continue;
+		}
+		if (route_entry.attr.type != rt->attr.type)
+			continue;
+		if (rt->attr.type == 2 && ipv6_addr_equal(&route_entry.dst_ip6, &rt->dst_ip6))
+			return idx;
+		if (rt->attr.type == 0 && route_entry.dst_ip == rt->dst_ip)
+			return idx;
+	}
+
+	return must_exist ? -1 : free_idx;
 }
 
 /*
@@ -1971,7 +2011,7 @@ static int rtl930x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 			break;
 	}
 
-	if (block >= priv->n_pie_blocks) {
+	if (block >= max_block) {
 		mutex_unlock(&priv->pie_mutex);
 		return -EOPNOTSUPP;
 	}
@@ -2276,27 +2316,29 @@ int rtl930x_l3_setup(struct rtl838x_switch_priv *priv)
 	return 0;
 }
 
-static u32 rtl930x_packet_cntr_read(int counter)
+static int rtl930x_packet_cntr_read(int counter, u32 *v)
 {
-	u32 v;
-
 	// Read LOG table (3) via register RTL9300_TBL_0
 	struct table_reg *r = rtl_table_get(RTL9300_TBL_0, 3);
+	int err;
 
 	pr_debug("In %s, id %d\n", __func__, counter);
-	rtl_table_read(r, counter / 2);
+	err = rtl_table_read(r, counter / 2);
+	if (err)
+		goto out;
 
 	pr_debug("Registers: %08x %08x\n",
 		sw_r32(rtl_table_data(r, 0)), sw_r32(rtl_table_data(r, 1)));
 	// The table has a size of 2 registers
 	if (counter % 2)
-		v = sw_r32(rtl_table_data(r, 0));
+		*v = sw_r32(rtl_table_data(r, 0));
 	else
-		v = sw_r32(rtl_table_data(r, 1));
+		*v = sw_r32(rtl_table_data(r, 1));
 
+out:
 	rtl_table_release(r);
 
-	return v;
+	return err;
 }
 
 static void rtl930x_packet_cntr_clear(int counter)
@@ -5,6 +5,8 @@
 #include <linux/netdevice.h>
 #include <net/flow_offload.h>
 #include <linux/rhashtable.h>
+#include <linux/etherdevice.h>
+#include <net/ipv6.h>
 
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 #include "rtl83xx.h"
@@ -14,7 +16,7 @@
  * Parse the flow rule for the matching conditions
  */
 static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
-			      struct flow_rule *rule, struct rtl83xx_flow *flow)
+			      struct flow_rule *rule, struct pie_rule *pr)
 {
 	struct flow_dissector *dissector = rule->match.dissector;
 
@@ -32,25 +34,25 @@ static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
 		pr_debug("%s: BASIC\n", __func__);
 		flow_rule_match_basic(rule, &match);
 		if (match.key->n_proto == htons(ETH_P_ARP))
-			flow->rule.frame_type = 0;
+			pr->frame_type = 0;
 		if (match.key->n_proto == htons(ETH_P_IP))
-			flow->rule.frame_type = 2;
+			pr->frame_type = 2;
 		if (match.key->n_proto == htons(ETH_P_IPV6))
-			flow->rule.frame_type = 3;
-		if ((match.key->n_proto == htons(ETH_P_ARP)) || flow->rule.frame_type)
-			flow->rule.frame_type_m = 3;
-		if (flow->rule.frame_type >= 2) {
+			pr->frame_type = 3;
+		if ((match.key->n_proto == htons(ETH_P_ARP)) || pr->frame_type)
+			pr->frame_type_m = 3;
+		if (pr->frame_type >= 2) {
 			if (match.key->ip_proto == IPPROTO_UDP)
-				flow->rule.frame_type_l4 = 0;
+				pr->frame_type_l4 = 0;
 			if (match.key->ip_proto == IPPROTO_TCP)
-				flow->rule.frame_type_l4 = 1;
+				pr->frame_type_l4 = 1;
 			if (match.key->ip_proto == IPPROTO_ICMP
 				|| match.key->ip_proto ==IPPROTO_ICMPV6)
-				flow->rule.frame_type_l4 = 2;
+				pr->frame_type_l4 = 2;
 			if (match.key->ip_proto == IPPROTO_TCP)
-				flow->rule.frame_type_l4 = 3;
-			if ((match.key->ip_proto == IPPROTO_UDP) || flow->rule.frame_type_l4)
-				flow->rule.frame_type_l4_m = 7;
+				pr->frame_type_l4 = 3;
+			if ((match.key->ip_proto == IPPROTO_UDP) || pr->frame_type_l4)
+				pr->frame_type_l4_m = 7;
 		}
 	}
 
@@ -59,10 +61,10 @@ static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
 
 		pr_debug("%s: ETH_ADDR\n", __func__);
 		flow_rule_match_eth_addrs(rule, &match);
-		ether_addr_copy(flow->rule.dmac, match.key->dst);
-		ether_addr_copy(flow->rule.dmac_m, match.mask->dst);
-		ether_addr_copy(flow->rule.smac, match.key->src);
-		ether_addr_copy(flow->rule.smac_m, match.mask->src);
+		ether_addr_copy(pr->dmac, match.key->dst);
+		ether_addr_copy(pr->dmac_m, match.mask->dst);
+		ether_addr_copy(pr->smac, match.key->src);
+		ether_addr_copy(pr->smac_m, match.mask->src);
 	}
 
 	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_VLAN)) {
@@ -70,8 +72,8 @@ static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
 
 		pr_debug("%s: VLAN\n", __func__);
 		flow_rule_match_vlan(rule, &match);
-		flow->rule.itag = match.key->vlan_id;
-		flow->rule.itag_m = match.mask->vlan_id;
+		pr->itag = match.key->vlan_id;
+		pr->itag_m = match.mask->vlan_id;
 		// TODO: What about match.key->vlan_priority ?
 	}
 
@@ -80,21 +82,21 @@ static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
 
 		pr_debug("%s: IPV4\n", __func__);
 		flow_rule_match_ipv4_addrs(rule, &match);
-		flow->rule.is_ipv6 = false;
-		flow->rule.dip = match.key->dst;
-		flow->rule.dip_m = match.mask->dst;
-		flow->rule.sip = match.key->src;
-		flow->rule.sip_m = match.mask->src;
+		pr->is_ipv6 = false;
+		pr->dip = match.key->dst;
+		pr->dip_m = match.mask->dst;
+		pr->sip = match.key->src;
+		pr->sip_m = match.mask->src;
 	} else if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_IPV6_ADDRS)) {
 		struct flow_match_ipv6_addrs match;
 
 		pr_debug("%s: IPV6\n", __func__);
-		flow->rule.is_ipv6 = true;
+		pr->is_ipv6 = true;
 		flow_rule_match_ipv6_addrs(rule, &match);
-		flow->rule.dip6 = match.key->dst;
-		flow->rule.dip6_m = match.mask->dst;
-		flow->rule.sip6 = match.key->src;
-		flow->rule.sip6_m = match.mask->src;
+		pr->dip6 = match.key->dst;
+		pr->dip6_m = match.mask->dst;
+		pr->sip6 = match.key->src;
+		pr->sip6_m = match.mask->src;
 	}
 
 	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_PORTS)) {
@@ -102,26 +104,26 @@ static int rtl83xx_parse_flow_rule(struct rtl838x_switch_priv *priv,
 
 		pr_debug("%s: PORTS\n", __func__);
 		flow_rule_match_ports(rule, &match);
-		flow->rule.dport = match.key->dst;
-		flow->rule.dport_m = match.mask->dst;
-		flow->rule.sport = match.key->src;
-		flow->rule.sport_m = match.mask->src;
+		pr->dport = match.key->dst;
+		pr->dport_m = match.mask->dst;
+		pr->sport = match.key->src;
+		pr->sport_m = match.mask->src;
 	}
 
 	// TODO: ICMP
 	return 0;
 }
 
-static void rtl83xx_flow_bypass_all(struct rtl83xx_flow *flow)
+static void rtl83xx_flow_bypass_all(struct pie_rule *pr)
 {
-	flow->rule.bypass_sel = true;
-	flow->rule.bypass_all = true;
-	flow->rule.bypass_igr_stp = true;
-	flow->rule.bypass_ibc_sc = true;
+	pr->bypass_sel = true;
+	pr->bypass_all = true;
+	pr->bypass_igr_stp = true;
+	pr->bypass_ibc_sc = true;
 }
 
 static int rtl83xx_parse_fwd(struct rtl838x_switch_priv *priv,
-			     const struct flow_action_entry *act, struct rtl83xx_flow *flow)
+			     const struct flow_action_entry *act, struct pie_rule *pr)
 {
 	struct net_device *dev = act->dev;
 	int port;
@@ -132,16 +134,16 @@ static int rtl83xx_parse_fwd(struct rtl838x_switch_priv *priv,
 		return -EINVAL;
 	}
 
-	flow->rule.fwd_sel = true;
-	flow->rule.fwd_data = port;
+	pr->fwd_sel = true;
+	pr->fwd_data = port;
 	pr_debug("Using port index: %d\n", port);
-	rtl83xx_flow_bypass_all(flow);
+	rtl83xx_flow_bypass_all(pr);
 
 	return 0;
 }
 
 static int rtl83xx_add_flow(struct rtl838x_switch_priv *priv, struct flow_cls_offload *f,
-			    struct rtl83xx_flow *flow)
+			    struct pie_rule *pr)
 {
 	struct flow_rule *rule = flow_cls_offload_flow_rule(f);
 	const struct flow_action_entry *act;
@@ -149,21 +151,23 @@ static int rtl83xx_add_flow(struct rtl838x_switch_priv *priv, struct flow_cls_of
 
 	pr_debug("%s\n", __func__);
 
-	rtl83xx_parse_flow_rule(priv, rule, flow);
-	
+	err = rtl83xx_parse_flow_rule(priv, rule, pr);
+	if (err)
+		return err;
+
 	flow_action_for_each(i, act, &rule->action) {
 		switch (act->id) {
 		case FLOW_ACTION_DROP:
 			pr_debug("%s: DROP\n", __func__);
-			flow->rule.drop = true;
-			rtl83xx_flow_bypass_all(flow);
+			pr->drop = true;
+			rtl83xx_flow_bypass_all(pr);
 			return 0;
 
 		case FLOW_ACTION_TRAP:
 			pr_debug("%s: TRAP\n", __func__);
-			flow->rule.fwd_data = priv->cpu_port;
-			flow->rule.fwd_act = PIE_ACT_REDIRECT_TO_PORT;
-			rtl83xx_flow_bypass_all(flow);
+			pr->fwd_data = priv->cpu_port;
+			pr->fwd_act = PIE_ACT_REDIRECT_TO_PORT;
+			rtl83xx_flow_bypass_all(pr);
 			break;
 
 		case FLOW_ACTION_MANGLE:
@@ -177,24 +181,24 @@ static int rtl83xx_add_flow(struct rtl838x_switch_priv *priv, struct flow_cls_of
 		case FLOW_ACTION_VLAN_PUSH:
 			pr_debug("%s: VLAN_PUSH\n", __func__);
 //			TODO: act->vlan.proto
-			flow->rule.ivid_act = PIE_ACT_VID_ASSIGN;
-			flow->rule.ivid_sel = true;
-			flow->rule.ivid_data = htons(act->vlan.vid);
-			flow->rule.ovid_act = PIE_ACT_VID_ASSIGN;
-			flow->rule.ovid_sel = true;
-			flow->rule.ovid_data = htons(act->vlan.vid);
-			flow->rule.fwd_mod_to_cpu = true;
+			pr->ivid_act = PIE_ACT_VID_ASSIGN;
+			pr->ivid_sel = true;
+			pr->ivid_data = htons(act->vlan.vid);
+			pr->ovid_act = PIE_ACT_VID_ASSIGN;
+			pr->ovid_sel = true;
+			pr->ovid_data = htons(act->vlan.vid);
+			pr->fwd_mod_to_cpu = true;
 			break;
 
 		case FLOW_ACTION_VLAN_POP:
 			pr_debug("%s: VLAN_POP\n", __func__);
-			flow->rule.ivid_act = PIE_ACT_VID_ASSIGN;
-			flow->rule.ivid_data = 0;
-			flow->rule.ivid_sel = true;
-			flow->rule.ovid_act = PIE_ACT_VID_ASSIGN;
-			flow->rule.ovid_data = 0;
-			flow->rule.ovid_sel = true;
-			flow->rule.fwd_mod_to_cpu = true;
+			pr->ivid_act = PIE_ACT_VID_ASSIGN;
+			pr->ivid_data = 0;
+			pr->ivid_sel = true;
+			pr->ovid_act = PIE_ACT_VID_ASSIGN;
+			pr->ovid_data = 0;
+			pr->ovid_sel = true;
+			pr->fwd_mod_to_cpu = true;
 			break;
 
 		case FLOW_ACTION_CSUM:
@@ -203,18 +207,18 @@ static int rtl83xx_add_flow(struct rtl838x_switch_priv *priv, struct flow_cls_of
 
 		case FLOW_ACTION_REDIRECT:
 			pr_debug("%s: REDIRECT\n", __func__);
-			err = rtl83xx_parse_fwd(priv, act, flow);
+			err = rtl83xx_parse_fwd(priv, act, pr);
 			if (err)
 				return err;
-			flow->rule.fwd_act = PIE_ACT_REDIRECT_TO_PORT;
+			pr->fwd_act = PIE_ACT_REDIRECT_TO_PORT;
 			break;
 
 		case FLOW_ACTION_MIRRED:
 			pr_debug("%s: MIRRED\n", __func__);
-			err = rtl83xx_parse_fwd(priv, act, flow);
+			err = rtl83xx_parse_fwd(priv, act, pr);
 			if (err)
 				return err;
-			flow->rule.fwd_act = PIE_ACT_COPY_TO_PORT;
+			pr->fwd_act = PIE_ACT_COPY_TO_PORT;
 			break;
 
 		default:
@@ -233,6 +237,224 @@ static const struct rhashtable_params tc_ht_params = {
 	.automatic_shrinking = true,
 };
 
+/*
+ * The matching conditions set by rtl83xx_parse_flow_rule(), a replaced rule with
+ * the same match can be rewritten in place
+ */
+static bool rtl83xx_flow_match_equal(const struct pie_rule *a, const struct pie_rule *b)
+{
+	return a->is_egress == b->is_egress && a->is_ipv6 == b->is_ipv6
+		&& a->frame_type == b->frame_type && a->frame_type_m == b->frame_type_m
+		&& a->frame_type_l4 == b->frame_type_l4
+		&& a->frame_type_l4_m == b->frame_type_l4_m
+		&& ether_addr_equal(a->dmac, b->dmac) && ether_addr_equal(a->dmac_m, b->dmac_m)
+		&& ether_addr_equal(a->smac, b->smac) && ether_addr_equal(a->smac_m, b->smac_m)
+		&& a->itag == b->itag && a->itag_m == b->itag_m
+		&& a->sip == b->sip && a->sip_m == b->sip_m
+		&& a->dip == b->dip && a->dip_m == b->dip_m
+		&& ipv6_addr_equal(&a->sip6, &b->sip6) && ipv6_addr_equal(&a->sip6_m, &b->sip6_m)
+		&& ipv6_addr_equal(&a->dip6, &b->dip6) && ipv6_addr_equal(&a->dip6_m, &b->dip6_m)
+		&& a->sport == b->sport && a->sport_m == b->sport_m
+		&& a->dport == b->dport && a->dport_m == b->dport_m;
+}
+
+/*
+ * Attach a packet counter to the flow's rule and, on SoCs which can log octets,
+ * reserve an octet counter for the flow's byte count
+ */
+static void rtl83xx_flow_cntr_alloc(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	struct pie_rule *pr = &flow->rule;
+
+	pr->packet_cntr = rtl83xx_packet_cntr_alloc(priv);
+	if (pr->packet_cntr >= 0) {
+		pr_debug("Using packet counter %d\n", pr->packet_cntr);
+		priv->r->packet_cntr_clear(pr->packet_cntr);
+		pr->log_sel = true;
+		pr->log_data = pr->packet_cntr;
+	}
+
+	pr->octet_cntr = -1;
+	if (!priv->r->octet_cntr_read)
+		return;
+
+	pr->octet_cntr = rtl83xx_octet_cntr_alloc(priv);
+	if (pr->octet_cntr >= 0)
+		priv->r->octet_cntr_clear(pr->octet_cntr);
+}
+
+static void rtl83xx_flow_cntr_free(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	// A set bit marks a free packet counter, see rtl83xx_packet_cntr_alloc()
+	if (flow->rule.packet_cntr >= 0)
+		set_bit(flow->rule.packet_cntr, priv->packet_cntr_use_bm);
+	if (flow->rule.octet_cntr >= 0)
+		clear_bit(flow->rule.octet_cntr, priv->octet_cntr_use_bm);
+}
+
+/*
+ * A rule can only log either packets or octets. Bytes are counted by a second rule
+ * with the same match which only logs octets. Only one rule per block can hit, so
+ * it goes into the blocks the SoC reserves for counting rules, where it cannot
+ * shadow the actions of other flows. Of two flows with overlapping matches only the
+ * first one's bytes are counted there. Without room for it the flow is offloaded
+ * with packet counts only.
+ */
+static void rtl83xx_flow_cntr_rule_add(struct rtl838x_switch_priv *priv,
+				       struct rtl83xx_flow *flow, struct flow_rule *rule)
+{
+	struct pie_rule *cr = &flow->cntr_rule;
+
+	memset(cr, 0, sizeof(*cr));
+	if (flow->rule.octet_cntr < 0)
+		return;
+
+	rtl83xx_parse_flow_rule(priv, rule, cr);
+	cr->packet_cntr = -1;
+	cr->octet_cntr = -1;
+	cr->log_sel = true;
+	cr->log_octets = true;
+	cr->log_data = flow->rule.octet_cntr;
+	cr->is_cntr_rule = true;
+
+	if (priv->r->pie_rule_add(priv, cr)) {
+		pr_info("%s: no room for octet counting rule\n", __func__);
+		cr->valid = false;
+	}
+}
+
+static void rtl83xx_flow_rule_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	if (flow->cntr_rule.valid)
+		priv->r->pie_rule_rm(priv, &flow->cntr_rule);
+	priv->r->pie_rule_rm(priv, &flow->rule);
+}
+
+/*
+ * Accumulate the HW counters of a flow, called with tc_lock held. The packet
+ * counters are 32 bits wide, which at line rate wrap within minutes, so they are
+ * also read periodically by rtl83xx_tc_stats_work_do()
+ */
+static void rtl83xx_flow_stats_sync(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	struct pie_rule *pr = &flow->rule;
+	bool used = false;
+	u32 pkts;
+	u64 octets;
+
+	// A counter which can't be read is retried on the next sync
+	if (pr->packet_cntr >= 0 && !priv->r->packet_cntr_read(pr->packet_cntr, &pkts)) {
+		if (pkts != pr->last_packet_cnt) {
+			flow->packets += (u32)(pkts - pr->last_packet_cnt);
+			pr->last_packet_cnt = pkts;
+			used = true;
+		}
+	}
+
+	if (pr->octet_cntr >= 0 && flow->cntr_rule.valid &&
+	    !priv->r->octet_cntr_read(pr->octet_cntr, &octets)) {
+		if (octets != pr->last_octet_cnt) {
+			flow->bytes += octets - pr->last_octet_cnt;
+			pr->last_octet_cnt = octets;
+			used = true;
+		}
+	}
+
+	if (used)
+		flow->lastused = jiffies;
+}
+
+#define RTL83XX_TC_STATS_PERIOD	(2 * HZ)
+
+/*
+ * Reads the counters of all offloaded flows in one go, re-arms itself as long
+ * as there are flows
+ */
+void rtl83xx_tc_stats_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(to_delayed_work(work), struct rtl838x_switch_priv, tc_stats_work);
+	struct rtl83xx_flow *flow;
+
+	mutex_lock(&priv->tc_lock);
+
+	list_for_each_entry(flow, &priv->tc_flows, list) {
+		rtl83xx_flow_stats_sync(priv, flow);
+		cond_resched();
+	}
+
+	if (!list_empty(&priv->tc_flows))
+		schedule_delayed_work(&priv->tc_stats_work, RTL83XX_TC_STATS_PERIOD);
+
+	mutex_unlock(&priv->tc_lock);
+}
+
+/*
+ * Update an offloaded flow with a replacement rule. If the match did not change,
+ * the actions are rewritten in place, keeping the PIE entry. Otherwise the new
+ * rule is installed before the old one is removed. Counters are carried over.
+ */
+static int rtl83xx_replace_flower(struct rtl838x_switch_priv *priv,
+				  struct flow_cls_offload *f, struct rtl83xx_flow *flow)
+{
+	struct pie_rule *pr;
+	int err;
+
+	pr = kzalloc(sizeof(*pr), GFP_KERNEL);
+	if (!pr)
+		return -ENOMEM;
+
+	err = rtl83xx_add_flow(priv, f, pr);
+	if (err)
+		goto out;
+
+	pr->packet_cntr = flow->rule.packet_cntr;
+	pr->octet_cntr = flow->rule.octet_cntr;
+	pr->last_packet_cnt = flow->rule.last_packet_cnt;
+	pr->last_octet_cnt = flow->rule.last_octet_cnt;
+	pr->log_sel = flow->rule.log_sel;
+	pr->log_data = flow->rule.log_data;
+
+	if (rtl83xx_flow_match_equal(pr, &flow->rule)) {
+		pr_debug("%s: updating rule %d in place\n", __func__, flow->rule.id);
+		pr->valid = true;
+		pr->id = flow->rule.id;
+		pr->tid = flow->rule.tid;
+		pr->tid_m = flow->rule.tid_m;
+
+		mutex_lock(&priv->pie_mutex);
+		err = priv->r->pie_rule_write(priv, pr->id, pr);
+		mutex_unlock(&priv->pie_mutex);
+		if (!err)
+			flow->rule = *pr;
+		goto out;
+	}
+
+	// Both rules would count the same packets until the old one is removed
+	pr->log_sel = false;
+	err = priv->r->pie_rule_add(priv, pr);
+	if (err)
+		goto out;
+
+	rtl83xx_flow_rule_rm(priv, flow);
+
+	if (flow->rule.log_sel) {
+		pr->log_sel = true;
+		mutex_lock(&priv->pie_mutex);
+		if (priv->r->pie_rule_write(priv, pr->id, pr)) {
+			pr_warn("%s: could not attach counter to rule %d\n", __func__, pr->id);
+			pr->log_sel = false;
+		}
+		mutex_unlock(&priv->pie_mutex);
+	}
+	flow->rule = *pr;
+	rtl83xx_flow_cntr_rule_add(priv, flow, flow_cls_offload_flow_rule(f));
+
+out:
+	kfree(pr);
+	return err;
+}
+
 static int rtl83xx_configure_flower(struct rtl838x_switch_priv *priv,
 				    struct flow_cls_offload *f)
 {
@@ -241,19 +463,15 @@ static int rtl83xx_configure_flower(struct rtl838x_switch_priv *priv,
 
 	pr_debug("In %s\n", __func__);
 
-	rcu_read_lock();
+	mutex_lock(&priv->tc_lock);
+
 	pr_debug("Cookie %08lx\n", f->cookie);
-	flow = rhashtable_lookup(&priv->tc_ht, &f->cookie, tc_ht_params);
+	flow = rhashtable_lookup_fast(&priv->tc_ht, &f->cookie, tc_ht_params);
 	if (flow) {
-		pr_info("%s: Got flow\n", __func__);
-		err = -EEXIST;
-		goto rcu_unlock;
+		err = rtl83xx_replace_flower(priv, f, flow);
+		goto out;
 	}
 
-rcu_unlock:
-	rcu_read_unlock();
-	if (flow)
-		goto out;
 	pr_debug("%s: New flow\n", __func__);
 
 	flow = kzalloc(sizeof(*flow), GFP_KERNEL);
@@ -265,29 +483,41 @@ rcu_unlock:
 	flow->cookie = f->cookie;
 	flow->priv = priv;
 
+	err = rtl83xx_add_flow(priv, f, &flow->rule);
+	if (err)
+		goto out_free;
+
+	// Add log action to flow
+	rtl83xx_flow_cntr_alloc(priv, flow);
+
+	err = priv->r->pie_rule_add(priv, &flow->rule);
+	if (err)
+		goto out_cntr;
+
+	rtl83xx_flow_cntr_rule_add(priv, flow, flow_cls_offload_flow_rule(f));
+
 	err = rhashtable_insert_fast(&priv->tc_ht, &flow->node, tc_ht_params);
 	if (err) {
 		pr_err("Could not insert add new rule\n");
-		goto out_free;
+		goto out_rule;
 	}
 
-	rtl83xx_add_flow(priv, f, flow); // TODO: check error
-
-	// Add log action to flow
-	flow->rule.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
-	if (flow->rule.packet_cntr >= 0) {
-		pr_debug("Using packet counter %d\n", flow->rule.packet_cntr);
-		flow->rule.log_sel = true;
-		flow->rule.log_data = flow->rule.packet_cntr;
-	}
+	list_add_tail(&flow->list, &priv->tc_flows);
+	schedule_delayed_work(&priv->tc_stats_work, RTL83XX_TC_STATS_PERIOD);
 
-	err = priv->r->pie_rule_add(priv, &flow->rule);
-	return err;
+	mutex_unlock(&priv->tc_lock);
+	return 0;
 
+out_rule:
+	rtl83xx_flow_rule_rm(priv, flow);
+out_cntr:
+	rtl83xx_flow_cntr_free(priv, flow);
 out_free:
 	kfree(flow);
 out:
-	pr_err("%s: error %d\n", __func__, err);
+	mutex_unlock(&priv->tc_lock);
+	if (err)
+		pr_err("%s: error %d\n", __func__, err);
 	return err;
 }
 
@@ -297,45 +527,51 @@ static int rtl83xx_delete_flower(struct rtl838x_switch_priv *priv,
 	struct rtl83xx_flow *flow;
 
 	pr_debug("In %s\n", __func__);
-	rcu_read_lock();
+	mutex_lock(&priv->tc_lock);
 	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
 	if (!flow) {
-		rcu_read_unlock();
+		mutex_unlock(&priv->tc_lock);
 		return -EINVAL;
 	}
 
-	priv->r->pie_rule_rm(priv, &flow->rule);
+	rtl83xx_flow_rule_rm(priv, flow);
+	rtl83xx_flow_cntr_free(priv, flow);
 
 	rhashtable_remove_fast(&priv->tc_ht, &flow->node, tc_ht_params);
+	list_del(&flow->list);
 
-	kfree_rcu(flow, rcu_head);
+	mutex_unlock(&priv->tc_lock);
 
-	rcu_read_unlock();
+	kfree_rcu(flow, rcu_head);
 	return 0;
 }
 
+/*
+ * Reports the packets and bytes counted since the last call
+ */
 static int rtl83xx_stats_flower(struct rtl838x_switch_priv *priv,
 				struct flow_cls_offload * cls_flower)
 {
 	struct rtl83xx_flow *flow;
-	unsigned long lastused = 0;
-	int total_packets, new_packets;
 
 	pr_debug("%s: \n", __func__);
+	mutex_lock(&priv->tc_lock);
 	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
-	if (!flow)
-		return -1;
-
-	if (flow->rule.packet_cntr >= 0) {
-		total_packets = priv->r->packet_cntr_read(flow->rule.packet_cntr);
-		pr_debug("Total packets: %d\n", total_packets);
-		new_packets = total_packets - flow->rule.last_packet_cnt;
-		flow->rule.last_packet_cnt = total_packets;
+	if (!flow) {
+		mutex_unlock(&priv->tc_lock);
+		return -EINVAL;
 	}
 
-	// TODO: We need a second PIE rule to count the bytes
-	flow_stats_update(&cls_flower->stats, 100 * new_packets, new_packets, 0, lastused,
+	rtl83xx_flow_stats_sync(priv, flow);
+	pr_debug("Total packets: %llu, bytes: %llu\n", flow->packets, flow->bytes);
+
+	flow_stats_update(&cls_flower->stats, flow->bytes - flow->reported_bytes,
+			  flow->packets - flow->reported_packets, 0, flow->lastused,
 			  FLOW_ACTION_HW_STATS_IMMEDIATE);
+	flow->reported_packets = flow->packets;
+	flow->reported_bytes = flow->bytes;
+
+	mutex_unlock(&priv->tc_lock);
 	return 0;
 }
 
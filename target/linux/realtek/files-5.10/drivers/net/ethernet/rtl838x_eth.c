@@ -52,6 +52,14 @@ extern struct rtl83xx_soc_info soc_info;
 
 #define RING_BUFFER	1600
 
+/*
+ * RX buffers are page fragments turned into skbs with build_skb(), the ASIC
+ * writes the frame after RX_HEADROOM bytes, leaving the IP header aligned
+ */
+#define RX_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+#define RX_BUF_SIZE	(SKB_DATA_ALIGN(RX_HEADROOM + RING_BUFFER) \
+			 + SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
 struct p_hdr {
 	uint8_t		*buf;
 	uint16_t	reserved;
@@ -78,8 +86,6 @@ struct ring_b {
 	struct	p_hdr	tx_header[TXRINGS][TXRINGLEN];
 	uint32_t	c_rx[MAX_RXRINGS];
 	uint32_t	c_tx[TXRINGS];
-	uint8_t		tx_space[TXRINGS * TXRINGLEN * RING_BUFFER];
-	uint8_t		*rx_space;
 };
 
 struct notify_block {
@@ -170,10 +176,33 @@ static void rtl93xx_header_vlan_set(struct p_hdr *h, int vlan)
 	h->cpu_tag[3] |= (vlan & 0xff) << 8;
 }
 
+struct rtl838x_ring_stats {
+	u64 packets;
+	u64 bytes;
+	u64 dropped;
+	struct u64_stats_sync syncp;
+};
+
+struct rtl838x_rx_buf {
+	void *data;		// Page fragment, becomes the head of the skb
+	dma_addr_t dma;		// Mapping of data + RX_HEADROOM
+};
+
+struct rtl838x_tx_buf {
+	struct sk_buff *skb;	// Sent directly from the skb, freed on TX done
+	dma_addr_t dma;
+	int len;
+};
+
+/*
+ * An RX ring is only ever accessed from its NAPI poll function
+ */
 struct rtl838x_rx_q {
 	int id;
 	struct rtl838x_eth_priv *priv;
 	struct napi_struct napi;
+	struct rtl838x_rx_buf *bufs;
+	struct rtl838x_ring_stats stats;
 };
 
 struct rtl838x_eth_priv {
@@ -183,6 +212,10 @@ struct rtl838x_eth_priv {
 	spinlock_t	lock;
 	struct mii_bus	*mii_bus;
 	struct rtl838x_rx_q rx_qs[MAX_RXRINGS];
+	spinlock_t	tx_lock[TXRINGS];	// Protects the TX ring and its buffers
+	struct rtl838x_tx_buf tx_bufs[TXRINGS][TXRINGLEN];
+	u32		dirty_tx[TXRINGS];	// Oldest entry not yet reclaimed
+	struct rtl838x_ring_stats tx_stats[TXRINGS];
 	struct phylink *phylink;
 	struct phylink_config phylink_config;
 	u16 id;
@@ -330,36 +363,40 @@ bool rtl931x_decode_tag(struct p_hdr *h, struct dsa_tag *t)
 }
 
 /*
- * Discard the RX ring-buffers, called as part of the net-ISR
- * when the buffer runs over
+ * Reclaim the buffers of frames the ASIC is done sending, called with the
+ * lock of TX ring q held
  */
-static void rtl838x_rb_cleanup(struct rtl838x_eth_priv *priv, int status)
+static void rtl838x_tx_reclaim(struct rtl838x_eth_priv *priv, int q)
 {
-	int r;
-	u32	*last;
-	struct p_hdr *h;
 	struct ring_b *ring = priv->membase;
+	struct rtl838x_tx_buf *b;
+	u32 d = priv->dirty_tx[q];
 
-	for (r = 0; r < priv->rxrings; r++) {
-		pr_debug("In %s working on r: %d\n", __func__, r);
-		last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
-		do {
-			if ((ring->rx_r[r][ring->c_rx[r]] & 0x1))
-				break;
-			pr_debug("Got something: %d\n", ring->c_rx[r]);
-			h = &ring->rx_header[r][ring->c_rx[r]];
-			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space
-					+ r * priv->rxringlen * RING_BUFFER
-					+ ring->c_rx[r] * RING_BUFFER);
-			h->size = RING_BUFFER;
-			/* make sure the header is visible to the ASIC */
-			mb();
+	while ((b = &priv->tx_bufs[q][d])->skb && !(ring->tx_r[q][d] & 0x1)) {
+		dma_unmap_single(&priv->pdev->dev, b->dma, b->len, DMA_TO_DEVICE);
+		dev_consume_skb_any(b->skb);
+		b->skb = NULL;
+		d = (d + 1) % TXRINGLEN;
+	}
+	priv->dirty_tx[q] = d;
+}
 
-			ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1
-				| (ring->c_rx[r] == (priv->rxringlen - 1) ? WRAP : 0x1);
-			ring->c_rx[r] = (ring->c_rx[r] + 1) % priv->rxringlen;
-		} while (&ring->rx_r[r][ring->c_rx[r]] != last);
+/*
+ * Called from the net-ISR on TX done, restarts TX queues which were stopped
+ * for lack of free descriptors
+ */
+static void rtl838x_tx_done(struct rtl838x_eth_priv *priv)
+{
+	struct ring_b *ring = priv->membase;
+	int q;
+
+	for (q = 0; q < TXRINGS; q++) {
+		spin_lock(&priv->tx_lock[q]);
+		rtl838x_tx_reclaim(priv, q);
+		if (__netif_subqueue_stopped(priv->netdev, q)
+		    && !priv->tx_bufs[q][ring->c_tx[q]].skb)
+			netif_wake_subqueue(priv->netdev, q);
+		spin_unlock(&priv->tx_lock[q]);
 	}
 }
 
@@ -383,7 +420,7 @@ void rtl838x_fdb_sync(struct work_struct *work)
 				: SWITCHDEV_FDB_DEL_TO_BRIDGE;
 		u64_to_ether_addr(uw->macs[i] & 0xffffffffffffULL, addr);
 		info.addr = &addr[0];
-		info.vid = 0;
+		info.vid = (uw->macs[i] >> 48) & 0xfff;
 		info.offloaded = 1;
 		pr_debug("FDB entry %d: %llx, action %d\n", i, uw->macs[0], action);
 		call_switchdev_notifiers(action, uw->ndev, &info.info, NULL);
@@ -413,7 +450,7 @@ static void rtl839x_l2_notification_handler(struct rtl838x_eth_priv *priv)
 			event = &nb->blocks[e].events[i];
 			if (!event->valid)
 				continue;
-			mac = event->mac;
+			mac = event->mac | ((u64)event->fidVid << 48);
 			if (event->type)
 				mac |= 1ULL << 63;
 			w->ndev = priv->netdev;
@@ -439,10 +476,11 @@ static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
 
 	pr_debug("IRQ: %08x\n", status);
 
-	/*  Ignore TX interrupt */
+	/* TX done */
 	if ((status & 0xf0000)) {
 		/* Clear ISR */
 		sw_w32(0x000f0000, priv->r->dma_if_intr_sts);
+		rtl838x_tx_done(priv);
 	}
 
 	/* RX interrupt */
@@ -458,12 +496,19 @@ static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
 		}
 	}
 
-	/* RX buffer overrun */
+	/*
+	 * RX buffer overrun: let NAPI empty the ring, the overrun interrupt of the
+	 * ring is re-enabled together with its RX interrupt when polling is done
+	 */
 	if (status & 0x000ff) {
 		pr_debug("RX buffer overrun: status %x, mask: %x\n",
 			 status, sw_r32(priv->r->dma_if_intr_msk));
-		sw_w32(status, priv->r->dma_if_intr_sts);
-		rtl838x_rb_cleanup(priv, status & 0xff);
+		sw_w32_mask(0xff & status, 0, priv->r->dma_if_intr_msk);
+		sw_w32(0x000000ff & status, priv->r->dma_if_intr_sts);
+		for (i = 0; i < priv->rxrings; i++) {
+			if (status & BIT(i))
+				napi_schedule(&priv->rx_qs[i].napi);
+		}
 	}
 
 	if (priv->family_id == RTL8390_FAMILY_ID && status & 0x00100000) {
@@ -496,11 +541,12 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 	pr_debug("In %s, status_tx: %08x, status_rx: %08x, status_rx_r: %08x\n",
 		__func__, status_tx, status_rx, status_rx_r);
 
-	/*  Ignore TX interrupt */
+	/* TX done */
 	if (status_tx) {
 		/* Clear ISR */
 		pr_debug("TX done\n");
 		sw_w32(status_tx, priv->r->dma_if_intr_tx_done_sts);
+		rtl838x_tx_done(priv);
 	}
 
 	/* RX interrupt */
@@ -517,12 +563,16 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 		}
 	}
 
-	/* RX buffer overrun */
+	/* RX buffer overrun: let NAPI empty the ring */
 	if (status_rx_r) {
 		pr_debug("RX buffer overrun: status %x, mask: %x\n",
 			 status_rx_r, sw_r32(priv->r->dma_if_intr_rx_runout_msk));
 		sw_w32(status_rx_r, priv->r->dma_if_intr_rx_runout_sts);
-		rtl838x_rb_cleanup(priv, status_rx_r);
+		sw_w32_mask(status_rx_r, 0, priv->r->dma_if_intr_rx_runout_msk);
+		for (i = 0; i < priv->rxrings; i++) {
+			if (status_rx_r & BIT(i))
+				napi_schedule(&priv->rx_qs[i].napi);
+		}
 	}
 
 	return IRQ_HANDLED;
@@ -818,6 +868,71 @@ static void rtl93xx_hw_en_rxtx(struct rtl838x_eth_priv *priv)
 		sw_w32(0x2a1d, priv->r->mac_force_mode_ctrl + priv->cpu_port * 4);
 }
 
+static int rtl838x_rx_buf_alloc(struct rtl838x_eth_priv *priv, struct rtl838x_rx_buf *b,
+				bool napi)
+{
+	void *data = napi ? napi_alloc_frag(RX_BUF_SIZE) : netdev_alloc_frag(RX_BUF_SIZE);
+	dma_addr_t dma;
+
+	if (!data)
+		return -ENOMEM;
+
+	dma = dma_map_single(&priv->pdev->dev, data + RX_HEADROOM, RING_BUFFER, DMA_FROM_DEVICE);
+	if (dma_mapping_error(&priv->pdev->dev, dma)) {
+		skb_free_frag(data);
+		return -ENOMEM;
+	}
+	b->data = data;
+	b->dma = dma;
+
+	return 0;
+}
+
+static void rtl838x_free_ring_buffers(struct rtl838x_eth_priv *priv)
+{
+	struct rtl838x_rx_buf *rb;
+	struct rtl838x_tx_buf *tb;
+	int i, j;
+
+	for (i = 0; i < priv->rxrings; i++) {
+		for (j = 0; j < priv->rxringlen; j++) {
+			rb = &priv->rx_qs[i].bufs[j];
+			if (!rb->data)
+				continue;
+			dma_unmap_single(&priv->pdev->dev, rb->dma, RING_BUFFER, DMA_FROM_DEVICE);
+			skb_free_frag(rb->data);
+			rb->data = NULL;
+		}
+	}
+
+	for (i = 0; i < TXRINGS; i++) {
+		for (j = 0; j < TXRINGLEN; j++) {
+			tb = &priv->tx_bufs[i][j];
+			if (!tb->skb)
+				continue;
+			dma_unmap_single(&priv->pdev->dev, tb->dma, tb->len, DMA_TO_DEVICE);
+			dev_kfree_skb_any(tb->skb);
+			tb->skb = NULL;
+		}
+	}
+}
+
+static int rtl838x_alloc_ring_buffers(struct rtl838x_eth_priv *priv)
+{
+	int i, j;
+
+	for (i = 0; i < priv->rxrings; i++) {
+		for (j = 0; j < priv->rxringlen; j++) {
+			if (rtl838x_rx_buf_alloc(priv, &priv->rx_qs[i].bufs[j], false)) {
+				rtl838x_free_ring_buffers(priv);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring_b *ring)
 {
 	int i, j;
@@ -828,9 +943,7 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		for (j = 0; j < priv->rxringlen; j++) {
 			h = &ring->rx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space
-					+ i * priv->rxringlen * RING_BUFFER
-					+ j * RING_BUFFER);
+			h->buf = (u8 *)KSEG1ADDR(priv->rx_qs[i].bufs[j].dma);
 			h->size = RING_BUFFER;
 			/* All rings owned by switch, last one wraps */
 			ring->rx_r[i][j] = KSEG1ADDR(h) | 1 
@@ -843,15 +956,12 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		for (j = 0; j < TXRINGLEN; j++) {
 			h = &ring->tx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->tx_space
-					+ i * TXRINGLEN * RING_BUFFER
-					+ j * RING_BUFFER);
-			h->size = RING_BUFFER;
 			ring->tx_r[i][j] = KSEG1ADDR(&ring->tx_header[i][j]);
 		}
 		/* Last header is wrapping around */
 		ring->tx_r[i][j-1] |= WRAP;
 		ring->c_tx[i] = 0;
+		priv->dirty_tx[i] = 0;
 	}
 }
 
@@ -885,6 +995,11 @@ static int rtl838x_eth_open(struct net_device *ndev)
 	pr_debug("%s called: RX rings %d(length %d), TX rings %d(length %d)\n",
 		__func__, priv->rxrings, priv->rxringlen, TXRINGS, TXRINGLEN);
 
+	if (rtl838x_alloc_ring_buffers(priv)) {
+		netdev_err(ndev, "cannot allocate RX buffers\n");
+		return -ENOMEM;
+	}
+
 	spin_lock_irqsave(&priv->lock, flags);
 	rtl838x_hw_reset(priv);
 	rtl838x_setup_ring_buffer(priv, ring);
@@ -1027,6 +1142,9 @@ static int rtl838x_eth_stop(struct net_device *ndev)
 
 	netif_tx_stop_all_queues(ndev);
 
+	synchronize_irq(ndev->irq);
+	rtl838x_free_ring_buffers(priv);
+
 	return 0;
 }
 
@@ -1108,6 +1226,36 @@ static void rtl931x_eth_set_multicast_list(struct net_device *ndev)
 	}
 }
 
+/*
+ * Drop all frames still queued for TX and hand the descriptors back to the
+ * CPU, as set up by rtl838x_setup_ring_buffer(). Called with DMA stopped
+ * and interrupts disabled.
+ */
+static void rtl838x_tx_ring_reset(struct rtl838x_eth_priv *priv)
+{
+	struct ring_b *ring = priv->membase;
+	struct rtl838x_tx_buf *tb;
+	int i, j;
+
+	for (i = 0; i < TXRINGS; i++) {
+		spin_lock(&priv->tx_lock[i]);
+		for (j = 0; j < TXRINGLEN; j++) {
+			tb = &priv->tx_bufs[i][j];
+			if (tb->skb) {
+				dma_unmap_single(&priv->pdev->dev, tb->dma, tb->len, DMA_TO_DEVICE);
+				dev_kfree_skb_any(tb->skb);
+				tb->skb = NULL;
+			}
+			memset(&ring->tx_header[i][j], 0, sizeof(struct p_hdr));
+			ring->tx_r[i][j] = KSEG1ADDR(&ring->tx_header[i][j]);
+		}
+		ring->tx_r[i][TXRINGLEN - 1] |= WRAP;
+		ring->c_tx[i] = 0;
+		priv->dirty_tx[i] = 0;
+		spin_unlock(&priv->tx_lock[i]);
+	}
+}
+
 static void rtl838x_eth_tx_timeout(struct net_device *ndev, unsigned int txqueue)
 {
 	unsigned long flags;
@@ -1116,29 +1264,32 @@ static void rtl838x_eth_tx_timeout(struct net_device *ndev, unsigned int txqueue
 	pr_warn("%s\n", __func__);
 	spin_lock_irqsave(&priv->lock, flags);
 	rtl838x_hw_stop(priv);
+	rtl838x_tx_ring_reset(priv);
 	rtl838x_hw_ring_setup(priv);
 	rtl838x_hw_en_rxtx(priv);
 	netif_trans_update(ndev);
-	netif_start_queue(ndev);
+	netif_tx_wake_all_queues(ndev);
 	spin_unlock_irqrestore(&priv->lock, flags);
 }
 
 static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 {
-	int len, i;
+	int len, i, c;
 	struct rtl838x_eth_priv *priv = netdev_priv(dev);
 	struct ring_b *ring = priv->membase;
+	struct rtl838x_ring_stats *stats;
 	uint32_t val;
 	int ret;
 	unsigned long flags;
 	struct p_hdr *h;
+	dma_addr_t dma;
 	int dest_port = -1;
 	int q = skb_get_queue_mapping(skb) % TXRINGS;
 
 	if (q) // Check for high prio queue
 		pr_debug("SKB priority: %d\n", skb->priority);
 
-	spin_lock_irqsave(&priv->lock, flags);
+	stats = &priv->tx_stats[q];
 	len = skb->len;
 
 	/* Check for DSA tagging at the end of the buffer */
@@ -1154,70 +1305,130 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 
 	len += 4; // Add space for CRC
 
-	if (skb_padto(skb, len)) {
+	if (skb_padto(skb, len))
+		return NETDEV_TX_OK;
+
+	spin_lock_irqsave(&priv->tx_lock[q], flags);
+	c = ring->c_tx[q];
+
+	/* We can send this packet if CPU owns the descriptor */
+	if ((ring->tx_r[q][c] & 0x1) || priv->tx_bufs[q][c].skb) {
+		dev_warn(&priv->pdev->dev, "Data is owned by switch\n");
+		netif_stop_subqueue(dev, q);
+		ret = NETDEV_TX_BUSY;
+		goto txdone;
+	}
+
+	/* The ASIC reads the frame, including the CRC space, directly from the skb */
+	dma = dma_map_single(&priv->pdev->dev, skb->data, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(&priv->pdev->dev, dma)) {
+		dev_kfree_skb_any(skb);
+		u64_stats_update_begin(&stats->syncp);
+		stats->dropped++;
+		u64_stats_update_end(&stats->syncp);
 		ret = NETDEV_TX_OK;
 		goto txdone;
 	}
 
-	/* We can send this packet if CPU owns the descriptor */
-	if (!(ring->tx_r[q][ring->c_tx[q]] & 0x1)) {
-
-		/* Set descriptor for tx */
-		h = &ring->tx_header[q][ring->c_tx[q]];
-		h->size = len;
-		h->len = len;
-		// On RTL8380 SoCs, small packet lengths being sent need adjustments
-		if (priv->family_id == RTL8380_FAMILY_ID) {
-			if (len < ETH_ZLEN - 4)
-				h->len -= 4;
-		}
+	/* Set descriptor for tx */
+	h = &ring->tx_header[q][c];
+	memset(h, 0, sizeof(struct p_hdr));
+	h->buf = (u8 *)KSEG1ADDR(dma);
+	h->size = len;
+	h->len = len;
+	// On RTL8380 SoCs, small packet lengths being sent need adjustments
+	if (priv->family_id == RTL8380_FAMILY_ID) {
+		if (len < ETH_ZLEN - 4)
+			h->len -= 4;
+	}
 
-		if (dest_port >= 0)
-			priv->r->create_tx_header(h, dest_port, skb->priority >> 1);
+	if (dest_port >= 0)
+		priv->r->create_tx_header(h, dest_port, skb->priority >> 1);
 
-		/* Copy packet data to tx buffer */
-		memcpy((void *)KSEG1ADDR(h->buf), skb->data, len);
-		/* Make sure packet data is visible to ASIC */
-		wmb();
+	priv->tx_bufs[q][c].skb = skb;
+	priv->tx_bufs[q][c].dma = dma;
+	priv->tx_bufs[q][c].len = len;
 
-		/* Hand over to switch */
-		ring->tx_r[q][ring->c_tx[q]] |= 1;
+	/* Make sure the descriptor is visible to ASIC */
+	wmb();
 
-		// Before starting TX, prevent a Lextra bus bug on RTL8380 SoCs
-		if (priv->family_id == RTL8380_FAMILY_ID) {
-			for (i = 0; i < 10; i++) {
-				val = sw_r32(priv->r->dma_if_ctrl);
-				if ((val & 0xc) == 0xc)
-					break;
-			}
-		}
+	/* Hand over to switch */
+	ring->tx_r[q][c] |= 1;
 
-		/* Tell switch to send data */
-		if (priv->family_id == RTL9310_FAMILY_ID
-			|| priv->family_id == RTL9300_FAMILY_ID) {
-			// Ring ID q == 0: Low priority, Ring ID = 1: High prio queue
-			if (!q)
-				sw_w32_mask(0, BIT(2), priv->r->dma_if_ctrl);
-			else
-				sw_w32_mask(0, BIT(3), priv->r->dma_if_ctrl);
-		} else {
-			sw_w32_mask(0, TX_DO, priv->r->dma_if_ctrl);
+	// Before starting TX, prevent a Lextra bus bug on RTL8380 SoCs
+	if (priv->family_id == RTL8380_FAMILY_ID) {
+		for (i = 0; i < 10; i++) {
+			val = sw_r32(priv->r->dma_if_ctrl);
+			if ((val & 0xc) == 0xc)
+				break;
 		}
+	}
 
-		dev->stats.tx_packets++;
-		dev->stats.tx_bytes += len;
-		dev_kfree_skb(skb);
-		ring->c_tx[q] = (ring->c_tx[q] + 1) % TXRINGLEN;
-		ret = NETDEV_TX_OK;
+	/* Tell switch to send data */
+	if (priv->family_id == RTL9310_FAMILY_ID
+		|| priv->family_id == RTL9300_FAMILY_ID) {
+		// Ring ID q == 0: Low priority, Ring ID = 1: High prio queue
+		if (!q)
+			sw_w32_mask(0, BIT(2), priv->r->dma_if_ctrl);
+		else
+			sw_w32_mask(0, BIT(3), priv->r->dma_if_ctrl);
 	} else {
-		dev_warn(&priv->pdev->dev, "Data is owned by switch\n");
-		ret = NETDEV_TX_BUSY;
+		sw_w32_mask(0, TX_DO, priv->r->dma_if_ctrl);
 	}
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->packets++;
+	stats->bytes += len;
+	u64_stats_update_end(&stats->syncp);
+
+	c = (c + 1) % TXRINGLEN;
+	ring->c_tx[q] = c;
+
+	/* Stop the queue while the next descriptor has not been reclaimed */
+	rtl838x_tx_reclaim(priv, q);
+	if (priv->tx_bufs[q][c].skb)
+		netif_stop_subqueue(dev, q);
+
+	ret = NETDEV_TX_OK;
 txdone:
-	spin_unlock_irqrestore(&priv->lock, flags);
+	spin_unlock_irqrestore(&priv->tx_lock[q], flags);
 	return ret;
 }
 
+static void rtl838x_ring_stats_add(struct rtl838x_ring_stats *rs, u64 *packets, u64 *bytes,
+				   u64 *dropped)
+{
+	unsigned int start;
+	u64 p, b, d;
+
+	do {
+		start = u64_stats_fetch_begin_irq(&rs->syncp);
+		p = rs->packets;
+		b = rs->bytes;
+		d = rs->dropped;
+	} while (u64_stats_fetch_retry_irq(&rs->syncp, start));
+
+	*packets += p;
+	*bytes += b;
+	*dropped += d;
+}
+
+static void rtl838x_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(dev);
+	int i;
+
+	netdev_stats_to_stats64(stats, &dev->stats);
+
+	for (i = 0; i < priv->rxrings; i++)
+		rtl838x_ring_stats_add(&priv->rx_qs[i].stats, &stats->rx_packets,
+				       &stats->rx_bytes, &stats->rx_dropped);
+
+	for (i = 0; i < TXRINGS; i++)
+		rtl838x_ring_stats_add(&priv->tx_stats[i], &stats->tx_packets,
+				       &stats->tx_bytes, &stats->tx_dropped);
+}
+
 /*
  * Return queue number for TX. On the RTL83XX, these queues have equal priority
  * so we do round-robin
@@ -1245,11 +1456,11 @@ u16 rtl93xx_pick_tx_queue(struct net_device *dev, struct sk_buff *skb,
 static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 {
 	struct rtl838x_eth_priv *priv = netdev_priv(dev);
+	struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
 	struct ring_b *ring = priv->membase;
+	struct rtl838x_rx_buf *b, nb;
 	struct sk_buff *skb;
-	unsigned long flags;
 	int i, len, work_done = 0;
-	u8 *data, *skb_data;
 	unsigned int val;
 	u32	*last;
 	struct p_hdr *h;
@@ -1257,7 +1468,6 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 	struct dsa_tag tag;
 
 	pr_debug("---------------------------------------------------------- RX - %d\n", r);
-	spin_lock_irqsave(&priv->lock, flags);
 	last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
 
 	do {
@@ -1270,7 +1480,7 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 		}
 
 		h = &ring->rx_header[r][ring->c_rx[r]];
-		data = (u8 *)KSEG1ADDR(h->buf);
+		b = &rx_q->bufs[ring->c_rx[r]];
 		len = h->len;
 		if (!len)
 			break;
@@ -1281,8 +1491,19 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 		if (dsa)
 			len += 4;
 
-		skb = netdev_alloc_skb(dev, len + 4);
-		skb_reserve(skb, NET_IP_ALIGN);
+		/*
+		 * The skb is built around the buffer the frame was received in, which
+		 * is replaced in the ring. Without a replacement the frame is dropped
+		 * and the buffer given back to the ASIC
+		 */
+		skb = NULL;
+		if (likely(!rtl838x_rx_buf_alloc(priv, &nb, true))) {
+			dma_unmap_single(&priv->pdev->dev, b->dma, RING_BUFFER, DMA_FROM_DEVICE);
+			skb = build_skb(b->data, RX_BUF_SIZE);
+			if (unlikely(!skb))
+				skb_free_frag(b->data);
+			*b = nb;
+		}
 
 		if (likely(skb)) {
 			/* BUG: Prevent bug on RTL838x SoCs*/
@@ -1295,10 +1516,8 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 				}
 			}
 
-			skb_data = skb_put(skb, len);
-			/* Make sure data is visible */
-			mb();
-			memcpy(skb->data, (u8 *)KSEG1ADDR(data), len);
+			skb_reserve(skb, RX_HEADROOM);
+			skb_put(skb, len);
 			/* Overwrite CRC with cpu_tag */
 			if (dsa) {
 				priv->r->decode_tag(h, &tag);
@@ -1321,20 +1540,26 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 				else
 					skb->ip_summed = CHECKSUM_UNNECESSARY;
 			}
-			dev->stats.rx_packets++;
-			dev->stats.rx_bytes += len;
+			u64_stats_update_begin(&rx_q->stats.syncp);
+			rx_q->stats.packets++;
+			rx_q->stats.bytes += len;
+			u64_stats_update_end(&rx_q->stats.syncp);
 
 			netif_receive_skb(skb);
 		} else {
 			if (net_ratelimit())
 				dev_warn(&dev->dev, "low on memory - packet dropped\n");
-			dev->stats.rx_dropped++;
+			u64_stats_update_begin(&rx_q->stats.syncp);
+			rx_q->stats.dropped++;
+			u64_stats_update_end(&rx_q->stats.syncp);
 		}
 
 		/* Reset header structure */
 		memset(h, 0, sizeof(struct p_hdr));
-		h->buf = data;
+		h->buf = (u8 *)KSEG1ADDR(b->dma);
 		h->size = RING_BUFFER;
+		/* make sure the header is visible to the ASIC */
+		wmb();
 
 		ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1 
 			| (ring->c_rx[r] == (priv->rxringlen - 1) ? WRAP : 0x1);
@@ -1345,8 +1570,6 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 	// Update counters
 	priv->r->update_cntr(r, 0);
 
-	spin_unlock_irqrestore(&priv->lock, flags);
-
 	return work_done;
 }
 
@@ -1368,11 +1591,13 @@ static int rtl838x_poll_rx(struct napi_struct *napi, int budget)
 	if (work_done < budget) {
 		napi_complete_done(napi, work_done);
 
-		/* Enable RX interrupt */
-		if (priv->family_id == RTL9300_FAMILY_ID || priv->family_id == RTL9310_FAMILY_ID)
+		/* Enable RX and RX overrun interrupts */
+		if (priv->family_id == RTL9300_FAMILY_ID || priv->family_id == RTL9310_FAMILY_ID) {
 			sw_w32(0xffffffff, priv->r->dma_if_intr_rx_done_msk);
-		else
+			sw_w32(0xffffffff, priv->r->dma_if_intr_rx_runout_msk);
+		} else {
 			sw_w32_mask(0, 0xf00ff | BIT(r + 8), priv->r->dma_if_intr_msk);
+		}
 	}
 	return work_done;
 }
@@ -2266,6 +2491,7 @@ static const struct net_device_ops rtl838x_eth_netdev_ops = {
 	.ndo_open = rtl838x_eth_open,
 	.ndo_stop = rtl838x_eth_stop,
 	.ndo_start_xmit = rtl838x_eth_tx,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_select_queue = rtl83xx_pick_tx_queue,
 	.ndo_set_mac_address = rtl838x_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
@@ -2280,6 +2506,7 @@ static const struct net_device_ops rtl839x_eth_netdev_ops = {
 	.ndo_open = rtl838x_eth_open,
 	.ndo_stop = rtl838x_eth_stop,
 	.ndo_start_xmit = rtl838x_eth_tx,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_select_queue = rtl83xx_pick_tx_queue,
 	.ndo_set_mac_address = rtl838x_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
@@ -2294,6 +2521,7 @@ static const struct net_device_ops rtl930x_eth_netdev_ops = {
 	.ndo_open = rtl838x_eth_open,
 	.ndo_stop = rtl838x_eth_stop,
 	.ndo_start_xmit = rtl838x_eth_tx,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_select_queue = rtl93xx_pick_tx_queue,
 	.ndo_set_mac_address = rtl838x_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
@@ -2308,6 +2536,7 @@ static const struct net_device_ops rtl931x_eth_netdev_ops = {
 	.ndo_open = rtl838x_eth_open,
 	.ndo_stop = rtl838x_eth_stop,
 	.ndo_start_xmit = rtl838x_eth_tx,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_select_queue = rtl93xx_pick_tx_queue,
 	.ndo_set_mac_address = rtl838x_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
@@ -2340,7 +2569,6 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 	phy_interface_t phy_mode;
 	struct phylink *phylink;
 	int err = 0, i, rxrings, rxringlen;
-	struct ring_b *ring;
 
 	pr_info("Probing RTL838X eth device pdev: %x, dev: %x\n",
 		(u32)pdev, (u32)(&(pdev->dev)));
@@ -2383,9 +2611,12 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 		goto err_free;
 	}
 
-	/* Allocate buffer memory */
-	priv->membase = dmam_alloc_coherent(&pdev->dev, rxrings * rxringlen * RING_BUFFER
-				+ sizeof(struct ring_b) + sizeof(struct notify_b),
+	/*
+	 * Allocate memory for the descriptor rings, packet buffers are mapped
+	 * for streaming DMA when the device is opened
+	 */
+	priv->membase = dmam_alloc_coherent(&pdev->dev,
+				sizeof(struct ring_b) + sizeof(struct notify_b),
 				(void *)&dev->mem_start, GFP_KERNEL);
 	if (!priv->membase) {
 		dev_err(&pdev->dev, "cannot allocate DMA buffer\n");
@@ -2393,9 +2624,20 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 		goto err_free;
 	}
 
-	// Allocate ring-buffer space at the end of the allocated memory
-	ring = priv->membase;
-	ring->rx_space = priv->membase + sizeof(struct ring_b) + sizeof(struct notify_b);
+	for (i = 0; i < rxrings; i++) {
+		priv->rx_qs[i].bufs = devm_kcalloc(&pdev->dev, rxringlen,
+						   sizeof(struct rtl838x_rx_buf), GFP_KERNEL);
+		if (!priv->rx_qs[i].bufs) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+		u64_stats_init(&priv->rx_qs[i].stats.syncp);
+	}
+
+	for (i = 0; i < TXRINGS; i++) {
+		spin_lock_init(&priv->tx_lock[i]);
+		u64_stats_init(&priv->tx_stats[i].syncp);
+	}
 
 	spin_lock_init(&priv->lock);
 
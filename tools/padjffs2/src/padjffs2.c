@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 static char *progname;
 static unsigned int xtra_offset;
@@ -41,19 +42,25 @@ static bool pad_to_stdout = false;
 			progname, ## __VA_ARGS__, strerror(save)); \
 } while (0)
 
-#define BUF_SIZE	(64 * 1024)
 #define ALIGN(_x,_y)	(((_x) + ((_y) - 1)) & ~((_y) - 1))
 
 static int pad_image(char *name, uint32_t pad_mask)
 {
 	char *buf;
+	size_t buf_size;
 	int fd;
 	int outfd;
 	ssize_t in_len;
 	ssize_t out_len;
 	int ret = -1;
 
-	buf = malloc(BUF_SIZE);
+	/*
+	 * Padding to a boundary never takes more than the largest requested
+	 * alignment, so with a buffer that large every step can be written
+	 * together with its marker in a single call.
+	 */
+	buf_size = 1UL << (31 - __builtin_clz(pad_mask));
+	buf = malloc(buf_size);
 	if (!buf) {
 		ERR("No memory for buffer");
 		goto out;
@@ -74,14 +81,15 @@ static int pad_image(char *name, uint32_t pad_mask)
 	else
 		outfd = STDOUT_FILENO;
 
-	memset(buf, '\xff', BUF_SIZE);
+	memset(buf, '\xff', buf_size);
 
 	in_len += xtra_offset;
 
 	out_len = in_len;
 	while (pad_mask) {
+		struct iovec iov[2];
 		uint32_t mask;
-		ssize_t t;
+		ssize_t t, len;
 		int i;
 
 		for (i = 10; i < 32; i++) {
@@ -100,29 +108,19 @@ static int pad_image(char *name, uint32_t pad_mask)
 
 		fprintf(stderr, "padding image to %08x\n", (unsigned int) in_len - xtra_offset);
 
-		while (out_len < in_len) {
-			ssize_t len;
+		/* write out the fill and the JFFS end-of-filesystem marker */
+		iov[0].iov_base = buf;
+		iov[0].iov_len = in_len - out_len;
+		iov[1].iov_base = pad;
+		iov[1].iov_len = pad_len;
 
-			len = in_len - out_len;
-			if (len > BUF_SIZE)
-				len = BUF_SIZE;
-
-			t = write(outfd, buf, len);
-			if (t != len) {
-				ERRS("Unable to write to %s", name);
-				goto close;
-			}
-
-			out_len += len;
-		}
-
-		/* write out the JFFS end-of-filesystem marker */
-		t = write(outfd, pad, pad_len);
-		if (t != pad_len) {
+		len = iov[0].iov_len + iov[1].iov_len;
+		t = writev(outfd, iov, 2);
+		if (t != len) {
 			ERRS("Unable to write to %s", name);
 			goto close;
 		}
-		out_len += pad_len;
+		out_len += len;
 	}
 
 	ret = 0;